@@ -0,0 +1,347 @@
+#include <bl/algebra/soa.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BL_SOA_SIMD
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BL_SOA_SIMD
+#endif
+
+namespace bl
+{
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// lane abstraction: AVX processes 8 floats per step, SSE 4, component loads are aligned (see soa_storage::reserve)
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(__AVX__)
+	typedef __m256 lanes;
+	static const int s_width = 8;
+	static inline lanes load(const float* p)          { return _mm256_load_ps(p); }
+	static inline void  store(float* p, lanes a)      { _mm256_store_ps(p, a); }
+	static inline void  storeu(float* p, lanes a)     { _mm256_storeu_ps(p, a); }
+	static inline lanes broadcast(float s)            { return _mm256_set1_ps(s); }
+	static inline lanes add(lanes a, lanes b)         { return _mm256_add_ps(a, b); }
+	static inline lanes sub(lanes a, lanes b)         { return _mm256_sub_ps(a, b); }
+	static inline lanes mul(lanes a, lanes b)         { return _mm256_mul_ps(a, b); }
+	static inline lanes div(lanes a, lanes b)         { return _mm256_div_ps(a, b); }
+	static inline lanes sqrt(lanes a)                 { return _mm256_sqrt_ps(a); }
+	static inline lanes mask_positive(lanes value, lanes test) { return _mm256_and_ps(value, _mm256_cmp_ps(test, _mm256_setzero_ps(), _CMP_GT_OQ)); }
+#elif defined(BL_SOA_SIMD)
+	typedef __m128 lanes;
+	static const int s_width = 4;
+	static inline lanes load(const float* p)          { return _mm_load_ps(p); }
+	static inline void  store(float* p, lanes a)      { _mm_store_ps(p, a); }
+	static inline void  storeu(float* p, lanes a)     { _mm_storeu_ps(p, a); }
+	static inline lanes broadcast(float s)            { return _mm_set1_ps(s); }
+	static inline lanes add(lanes a, lanes b)         { return _mm_add_ps(a, b); }
+	static inline lanes sub(lanes a, lanes b)         { return _mm_sub_ps(a, b); }
+	static inline lanes mul(lanes a, lanes b)         { return _mm_mul_ps(a, b); }
+	static inline lanes div(lanes a, lanes b)         { return _mm_div_ps(a, b); }
+	static inline lanes sqrt(lanes a)                 { return _mm_sqrt_ps(a); }
+	static inline lanes mask_positive(lanes value, lanes test) { return _mm_and_ps(value, _mm_cmpgt_ps(test, _mm_setzero_ps())); }
+#endif
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// per component kernels
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	static void add_n(const float* a, const float* b, float* out, const int n)
+	{
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		for(; i + s_width <= n; i += s_width)
+		{
+			store(out+i, add(load(a+i), load(b+i)));
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			out[i] = a[i] + b[i];
+		}
+	}
+
+	static void sub_n(const float* a, const float* b, float* out, const int n)
+	{
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		for(; i + s_width <= n; i += s_width)
+		{
+			store(out+i, sub(load(a+i), load(b+i)));
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			out[i] = a[i] - b[i];
+		}
+	}
+
+	static void scale_n(const float* a, const float s, float* out, const int n)
+	{
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		const lanes vs = broadcast(s);
+		for(; i + s_width <= n; i += s_width)
+		{
+			store(out+i, mul(load(a+i), vs));
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			out[i] = a[i] * s;
+		}
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// generic helpers over N components
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<int t_components>
+	static void add_components(const soa_storage<t_components>& a, const soa_storage<t_components>& b, soa_storage<t_components>& out)
+	{
+		out.resize(a.size());
+		for(int c = 0; c < t_components; ++c)
+		{
+			add_n(a.component(c), b.component(c), out.component(c), a.size());
+		}
+	}
+
+	template<int t_components>
+	static void sub_components(const soa_storage<t_components>& a, const soa_storage<t_components>& b, soa_storage<t_components>& out)
+	{
+		out.resize(a.size());
+		for(int c = 0; c < t_components; ++c)
+		{
+			sub_n(a.component(c), b.component(c), out.component(c), a.size());
+		}
+	}
+
+	template<int t_components>
+	static void scale_components(const soa_storage<t_components>& a, const float s, soa_storage<t_components>& out)
+	{
+		out.resize(a.size());
+		for(int c = 0; c < t_components; ++c)
+		{
+			scale_n(a.component(c), s, out.component(c), a.size());
+		}
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// vec3
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	void add(const soa_buffer<vec3>& a, const soa_buffer<vec3>& b, soa_buffer<vec3>& out)
+	{
+		add_components(a, b, out);
+	}
+
+	void sub(const soa_buffer<vec3>& a, const soa_buffer<vec3>& b, soa_buffer<vec3>& out)
+	{
+		sub_components(a, b, out);
+	}
+
+	void scale(const soa_buffer<vec3>& a, const float s, soa_buffer<vec3>& out)
+	{
+		scale_components(a, s, out);
+	}
+
+	void cross(const soa_buffer<vec3>& a, const soa_buffer<vec3>& b, soa_buffer<vec3>& out)
+	{
+		const int n = a.size();
+		out.resize(n);
+
+		const float* ax = a.xs(); const float* ay = a.ys(); const float* az = a.zs();
+		const float* bx = b.xs(); const float* by = b.ys(); const float* bz = b.zs();
+		float* ox = out.xs(); float* oy = out.ys(); float* oz = out.zs();
+
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		for(; i + s_width <= n; i += s_width)
+		{
+			const lanes vax = load(ax+i), vay = load(ay+i), vaz = load(az+i);
+			const lanes vbx = load(bx+i), vby = load(by+i), vbz = load(bz+i);
+			store(ox+i, sub(mul(vay, vbz), mul(vaz, vby)));
+			store(oy+i, sub(mul(vaz, vbx), mul(vax, vbz)));
+			store(oz+i, sub(mul(vax, vby), mul(vay, vbx)));
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			const vec3 c = vec3(ax[i], ay[i], az[i]).cross(vec3(bx[i], by[i], bz[i]));
+			ox[i] = c.x;
+			oy[i] = c.y;
+			oz[i] = c.z;
+		}
+	}
+
+	void normalize(const soa_buffer<vec3>& a, soa_buffer<vec3>& out)
+	{
+		const int n = a.size();
+		out.resize(n);
+
+		const float* ax = a.xs(); const float* ay = a.ys(); const float* az = a.zs();
+		float* ox = out.xs(); float* oy = out.ys(); float* oz = out.zs();
+
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		const lanes one = broadcast(1.0f);
+		for(; i + s_width <= n; i += s_width)
+		{
+			const lanes vx = load(ax+i), vy = load(ay+i), vz = load(az+i);
+			const lanes len_sqr = add(add(mul(vx, vx), mul(vy, vy)), mul(vz, vz));
+			// zero length vectors normalize to zero, as in vec3::normalized
+			const lanes inv_len = mask_positive(div(one, sqrt(len_sqr)), len_sqr);
+			store(ox+i, mul(vx, inv_len));
+			store(oy+i, mul(vy, inv_len));
+			store(oz+i, mul(vz, inv_len));
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			const float len_sqr = ax[i]*ax[i] + ay[i]*ay[i] + az[i]*az[i];
+			const float inv_len = len_sqr > 0.0f ? 1.0f / std::sqrt(len_sqr) : 0.0f;
+			ox[i] = ax[i] * inv_len;
+			oy[i] = ay[i] * inv_len;
+			oz[i] = az[i] * inv_len;
+		}
+	}
+
+	void length(const soa_buffer<vec3>& a, float* out)
+	{
+		const int n = a.size();
+		const float* ax = a.xs(); const float* ay = a.ys(); const float* az = a.zs();
+
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		for(; i + s_width <= n; i += s_width)
+		{
+			const lanes vx = load(ax+i), vy = load(ay+i), vz = load(az+i);
+			const lanes len = sqrt(add(add(mul(vx, vx), mul(vy, vy)), mul(vz, vz)));
+			storeu(out+i, len);
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			out[i] = std::sqrt(ax[i]*ax[i] + ay[i]*ay[i] + az[i]*az[i]);
+		}
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// vec4
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	void add(const soa_buffer<vec4>& a, const soa_buffer<vec4>& b, soa_buffer<vec4>& out)
+	{
+		add_components(a, b, out);
+	}
+
+	void sub(const soa_buffer<vec4>& a, const soa_buffer<vec4>& b, soa_buffer<vec4>& out)
+	{
+		sub_components(a, b, out);
+	}
+
+	void scale(const soa_buffer<vec4>& a, const float s, soa_buffer<vec4>& out)
+	{
+		scale_components(a, s, out);
+	}
+
+	// shared by vec4 and quat, both store 4 components
+	static void normalize4(const soa_storage<4>& a, soa_storage<4>& out)
+	{
+		const int n = a.size();
+		out.resize(n);
+
+		const float* ax = a.component(0); const float* ay = a.component(1); const float* az = a.component(2); const float* aw = a.component(3);
+		float* ox = out.component(0); float* oy = out.component(1); float* oz = out.component(2); float* ow = out.component(3);
+
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		const lanes one = broadcast(1.0f);
+		for(; i + s_width <= n; i += s_width)
+		{
+			const lanes vx = load(ax+i), vy = load(ay+i), vz = load(az+i), vw = load(aw+i);
+			const lanes len_sqr = add(add(mul(vx, vx), mul(vy, vy)), add(mul(vz, vz), mul(vw, vw)));
+			const lanes inv_len = mask_positive(div(one, sqrt(len_sqr)), len_sqr);
+			store(ox+i, mul(vx, inv_len));
+			store(oy+i, mul(vy, inv_len));
+			store(oz+i, mul(vz, inv_len));
+			store(ow+i, mul(vw, inv_len));
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			const float len_sqr = (ax[i]*ax[i] + ay[i]*ay[i]) + (az[i]*az[i] + aw[i]*aw[i]);
+			const float inv_len = len_sqr > 0.0f ? 1.0f / std::sqrt(len_sqr) : 0.0f;
+			ox[i] = ax[i] * inv_len;
+			oy[i] = ay[i] * inv_len;
+			oz[i] = az[i] * inv_len;
+			ow[i] = aw[i] * inv_len;
+		}
+	}
+
+	void normalize(const soa_buffer<vec4>& a, soa_buffer<vec4>& out)
+	{
+		normalize4(a, out);
+	}
+
+	void length(const soa_buffer<vec4>& a, float* out)
+	{
+		const int n = a.size();
+		const float* ax = a.xs(); const float* ay = a.ys(); const float* az = a.zs(); const float* aw = a.ws();
+
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		for(; i + s_width <= n; i += s_width)
+		{
+			const lanes vx = load(ax+i), vy = load(ay+i), vz = load(az+i), vw = load(aw+i);
+			const lanes len = sqrt(add(add(mul(vx, vx), mul(vy, vy)), add(mul(vz, vz), mul(vw, vw))));
+			storeu(out+i, len);
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			out[i] = std::sqrt((ax[i]*ax[i] + ay[i]*ay[i]) + (az[i]*az[i] + aw[i]*aw[i]));
+		}
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// quat
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	void mul(const soa_buffer<quat>& a, const soa_buffer<quat>& b, soa_buffer<quat>& out)
+	{
+		const int n = a.size();
+		out.resize(n);
+
+		const float* ax = a.xs(); const float* ay = a.ys(); const float* az = a.zs(); const float* aw = a.ws();
+		const float* bx = b.xs(); const float* by = b.ys(); const float* bz = b.zs(); const float* bw = b.ws();
+		float* ox = out.xs(); float* oy = out.ys(); float* oz = out.zs(); float* ow = out.ws();
+
+		int i = 0;
+	#ifdef BL_SOA_SIMD
+		for(; i + s_width <= n; i += s_width)
+		{
+			const lanes x = load(ax+i), y = load(ay+i), z = load(az+i), w = load(aw+i);
+			const lanes qx = load(bx+i), qy = load(by+i), qz = load(bz+i), qw = load(bw+i);
+			// same expansion as quat::mul
+			store(ox+i, sub(add(add(mul(w, qx), mul(x, qw)), mul(y, qz)), mul(z, qy)));
+			store(oy+i, add(add(sub(mul(w, qy), mul(x, qz)), mul(y, qw)), mul(z, qx)));
+			store(oz+i, add(sub(add(mul(w, qz), mul(x, qy)), mul(y, qx)), mul(z, qw)));
+			store(ow+i, sub(sub(sub(mul(w, qw), mul(x, qx)), mul(y, qy)), mul(z, qz)));
+		}
+	#endif
+		for(; i < n; ++i)
+		{
+			const quat q = quat(ax[i], ay[i], az[i], aw[i]).mul(quat(bx[i], by[i], bz[i], bw[i]));
+			ox[i] = q.x;
+			oy[i] = q.y;
+			oz[i] = q.z;
+			ow[i] = q.w;
+		}
+	}
+
+	void normalize(const soa_buffer<quat>& a, soa_buffer<quat>& out)
+	{
+		normalize4(a, out);
+	}
+} // namespace bl
@@ -0,0 +1,563 @@
+#pragma once
+#include <bl/algebra/quat.h>
+#include <bl/algebra/vec3.h>
+#include <bl/algebra/vec4.h>
+#include <bl/util/memory.h>
+#include <algorithm>
+#include <new>
+
+namespace bl
+{
+	// structure-of-arrays storage: each component lives in its own 32-byte aligned float array
+	template<int t_components>
+	class soa_storage
+	{
+	public:
+		typedef int size_type;
+
+		static const size_type alignment = 32;
+		static const size_type lane_floats = alignment / sizeof(float);
+
+		soa_storage();
+		explicit soa_storage(size_type initial_capacity);
+		~soa_storage();
+
+		soa_storage(const soa_storage&) = delete;
+		soa_storage& operator=(const soa_storage&) = delete;
+
+		soa_storage(soa_storage&& other);
+		soa_storage& operator=(soa_storage&& other);
+
+		void reserve(size_type new_capacity);
+		void resize(size_type new_size);
+		void clear();
+
+		bool empty() const;
+		size_type size() const;
+		size_type capacity() const;
+
+		float* component(int c);
+		const float* component(int c) const;
+
+	protected:
+		size_type _grow();
+
+	private:
+		float* _memory;
+		size_type _size;
+		size_type _capacity;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	class soa_buffer;
+
+	template<>
+	class soa_buffer<vec3> : public soa_storage<3>
+	{
+	public:
+		class reference
+		{
+		public:
+			inline reference(float& rx, float& ry, float& rz);
+			inline reference& operator=(const reference& other);
+			inline reference& operator=(const vec3& v);
+			inline operator vec3() const;
+
+			float& x;
+			float& y;
+			float& z;
+		};
+
+		soa_buffer() = default;
+		inline explicit soa_buffer(size_type initial_capacity);
+
+		inline void add(const vec3& v);
+
+		inline reference operator[](size_type index);
+		inline vec3 operator[](size_type index) const;
+
+		inline float* xs();
+		inline const float* xs() const;
+		inline float* ys();
+		inline const float* ys() const;
+		inline float* zs();
+		inline const float* zs() const;
+	};
+
+	template<>
+	class soa_buffer<vec4> : public soa_storage<4>
+	{
+	public:
+		class reference
+		{
+		public:
+			inline reference(float& rx, float& ry, float& rz, float& rw);
+			inline reference& operator=(const reference& other);
+			inline reference& operator=(const vec4& v);
+			inline operator vec4() const;
+
+			float& x;
+			float& y;
+			float& z;
+			float& w;
+		};
+
+		soa_buffer() = default;
+		inline explicit soa_buffer(size_type initial_capacity);
+
+		inline void add(const vec4& v);
+
+		inline reference operator[](size_type index);
+		inline vec4 operator[](size_type index) const;
+
+		inline float* xs();
+		inline const float* xs() const;
+		inline float* ys();
+		inline const float* ys() const;
+		inline float* zs();
+		inline const float* zs() const;
+		inline float* ws();
+		inline const float* ws() const;
+	};
+
+	template<>
+	class soa_buffer<quat> : public soa_storage<4>
+	{
+	public:
+		class reference
+		{
+		public:
+			inline reference(float& rx, float& ry, float& rz, float& rw);
+			inline reference& operator=(const reference& other);
+			inline reference& operator=(const quat& q);
+			inline operator quat() const;
+
+			float& x;
+			float& y;
+			float& z;
+			float& w;
+		};
+
+		soa_buffer() = default;
+		inline explicit soa_buffer(size_type initial_capacity);
+
+		inline void add(const quat& q);
+
+		inline reference operator[](size_type index);
+		inline quat operator[](size_type index) const;
+
+		inline float* xs();
+		inline const float* xs() const;
+		inline float* ys();
+		inline const float* ys() const;
+		inline float* zs();
+		inline const float* zs() const;
+		inline float* ws();
+		inline const float* ws() const;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// bulk kernels: inputs must have the same size, out is resized to match and may alias any input
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	void add(const soa_buffer<vec3>& a, const soa_buffer<vec3>& b, soa_buffer<vec3>& out);
+	void sub(const soa_buffer<vec3>& a, const soa_buffer<vec3>& b, soa_buffer<vec3>& out);
+	void scale(const soa_buffer<vec3>& a, const float s, soa_buffer<vec3>& out);
+	void cross(const soa_buffer<vec3>& a, const soa_buffer<vec3>& b, soa_buffer<vec3>& out);
+	void normalize(const soa_buffer<vec3>& a, soa_buffer<vec3>& out);
+	void length(const soa_buffer<vec3>& a, float* out);
+
+	void add(const soa_buffer<vec4>& a, const soa_buffer<vec4>& b, soa_buffer<vec4>& out);
+	void sub(const soa_buffer<vec4>& a, const soa_buffer<vec4>& b, soa_buffer<vec4>& out);
+	void scale(const soa_buffer<vec4>& a, const float s, soa_buffer<vec4>& out);
+	void normalize(const soa_buffer<vec4>& a, soa_buffer<vec4>& out);
+	void length(const soa_buffer<vec4>& a, float* out);
+
+	void mul(const soa_buffer<quat>& a, const soa_buffer<quat>& b, soa_buffer<quat>& out);
+	void normalize(const soa_buffer<quat>& a, soa_buffer<quat>& out);
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<int t_components>
+	const typename soa_storage<t_components>::size_type soa_storage<t_components>::alignment;
+
+	template<int t_components>
+	const typename soa_storage<t_components>::size_type soa_storage<t_components>::lane_floats;
+
+	template<int t_components>
+	soa_storage<t_components>::soa_storage()
+		: _memory(nullptr), _size(0), _capacity(0)
+	{
+	}
+
+	template<int t_components>
+	soa_storage<t_components>::soa_storage(size_type initial_capacity)
+		: _memory(nullptr), _size(0), _capacity(0)
+	{
+		reserve(initial_capacity);
+	}
+
+	template<int t_components>
+	soa_storage<t_components>::~soa_storage()
+	{
+		aligned_free(_memory);
+	}
+
+	template<int t_components>
+	soa_storage<t_components>::soa_storage(soa_storage&& other)
+		: _memory(other._memory), _size(other._size), _capacity(other._capacity)
+	{
+		other._memory = nullptr;
+		other._size = 0;
+		other._capacity = 0;
+	}
+
+	template<int t_components>
+	soa_storage<t_components>& soa_storage<t_components>::operator=(soa_storage&& other)
+	{
+		std::swap(_memory, other._memory);
+		std::swap(_size, other._size);
+		std::swap(_capacity, other._capacity);
+		return *this;
+	}
+
+	template<int t_components>
+	void soa_storage<t_components>::reserve(size_type new_capacity)
+	{
+		if(new_capacity <= _capacity)
+		{
+			return;
+		}
+
+		// keep every component array aligned by padding capacity to a whole number of lanes
+		new_capacity = (new_capacity + lane_floats - 1) / lane_floats * lane_floats;
+
+		float* memory = static_cast<float*>(aligned_malloc(sizeof(float) * new_capacity * t_components, alignment));
+		if(memory == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+
+		for(int c = 0; c < t_components; ++c)
+		{
+			std::copy_n(_memory + c*_capacity, _size, memory + c*new_capacity);
+		}
+
+		aligned_free(_memory);
+		_memory = memory;
+		_capacity = new_capacity;
+	}
+
+	template<int t_components>
+	void soa_storage<t_components>::resize(size_type new_size)
+	{
+		reserve(new_size);
+		_size = new_size;
+	}
+
+	template<int t_components>
+	void soa_storage<t_components>::clear()
+	{
+		_size = 0;
+	}
+
+	template<int t_components>
+	bool soa_storage<t_components>::empty() const
+	{
+		return _size == 0;
+	}
+
+	template<int t_components>
+	typename soa_storage<t_components>::size_type soa_storage<t_components>::size() const
+	{
+		return _size;
+	}
+
+	template<int t_components>
+	typename soa_storage<t_components>::size_type soa_storage<t_components>::capacity() const
+	{
+		return _capacity;
+	}
+
+	template<int t_components>
+	float* soa_storage<t_components>::component(int c)
+	{
+		return _memory + c*_capacity;
+	}
+
+	template<int t_components>
+	const float* soa_storage<t_components>::component(int c) const
+	{
+		return _memory + c*_capacity;
+	}
+
+	template<int t_components>
+	typename soa_storage<t_components>::size_type soa_storage<t_components>::_grow()
+	{
+		if(_size == _capacity)
+		{
+			reserve(std::max(_capacity * 2, lane_floats));
+		}
+		return _size++;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	soa_buffer<vec3>::reference::reference(float& rx, float& ry, float& rz)
+		: x(rx), y(ry), z(rz)
+	{
+	}
+
+	soa_buffer<vec3>::reference& soa_buffer<vec3>::reference::operator=(const reference& other)
+	{
+		return *this = static_cast<vec3>(other);
+	}
+
+	soa_buffer<vec3>::reference& soa_buffer<vec3>::reference::operator=(const vec3& v)
+	{
+		x = v.x;
+		y = v.y;
+		z = v.z;
+		return *this;
+	}
+
+	soa_buffer<vec3>::reference::operator vec3() const
+	{
+		return vec3(x, y, z);
+	}
+
+	soa_buffer<vec3>::soa_buffer(size_type initial_capacity)
+		: soa_storage<3>(initial_capacity)
+	{
+	}
+
+	void soa_buffer<vec3>::add(const vec3& v)
+	{
+		const size_type i = _grow();
+		xs()[i] = v.x;
+		ys()[i] = v.y;
+		zs()[i] = v.z;
+	}
+
+	soa_buffer<vec3>::reference soa_buffer<vec3>::operator[](size_type index)
+	{
+		return reference(xs()[index], ys()[index], zs()[index]);
+	}
+
+	vec3 soa_buffer<vec3>::operator[](size_type index) const
+	{
+		return vec3(xs()[index], ys()[index], zs()[index]);
+	}
+
+	float* soa_buffer<vec3>::xs()
+	{
+		return component(0);
+	}
+
+	const float* soa_buffer<vec3>::xs() const
+	{
+		return component(0);
+	}
+
+	float* soa_buffer<vec3>::ys()
+	{
+		return component(1);
+	}
+
+	const float* soa_buffer<vec3>::ys() const
+	{
+		return component(1);
+	}
+
+	float* soa_buffer<vec3>::zs()
+	{
+		return component(2);
+	}
+
+	const float* soa_buffer<vec3>::zs() const
+	{
+		return component(2);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	soa_buffer<vec4>::reference::reference(float& rx, float& ry, float& rz, float& rw)
+		: x(rx), y(ry), z(rz), w(rw)
+	{
+	}
+
+	soa_buffer<vec4>::reference& soa_buffer<vec4>::reference::operator=(const reference& other)
+	{
+		return *this = static_cast<vec4>(other);
+	}
+
+	soa_buffer<vec4>::reference& soa_buffer<vec4>::reference::operator=(const vec4& v)
+	{
+		x = v.x;
+		y = v.y;
+		z = v.z;
+		w = v.w;
+		return *this;
+	}
+
+	soa_buffer<vec4>::reference::operator vec4() const
+	{
+		return vec4(x, y, z, w);
+	}
+
+	soa_buffer<vec4>::soa_buffer(size_type initial_capacity)
+		: soa_storage<4>(initial_capacity)
+	{
+	}
+
+	void soa_buffer<vec4>::add(const vec4& v)
+	{
+		const size_type i = _grow();
+		xs()[i] = v.x;
+		ys()[i] = v.y;
+		zs()[i] = v.z;
+		ws()[i] = v.w;
+	}
+
+	soa_buffer<vec4>::reference soa_buffer<vec4>::operator[](size_type index)
+	{
+		return reference(xs()[index], ys()[index], zs()[index], ws()[index]);
+	}
+
+	vec4 soa_buffer<vec4>::operator[](size_type index) const
+	{
+		return vec4(xs()[index], ys()[index], zs()[index], ws()[index]);
+	}
+
+	float* soa_buffer<vec4>::xs()
+	{
+		return component(0);
+	}
+
+	const float* soa_buffer<vec4>::xs() const
+	{
+		return component(0);
+	}
+
+	float* soa_buffer<vec4>::ys()
+	{
+		return component(1);
+	}
+
+	const float* soa_buffer<vec4>::ys() const
+	{
+		return component(1);
+	}
+
+	float* soa_buffer<vec4>::zs()
+	{
+		return component(2);
+	}
+
+	const float* soa_buffer<vec4>::zs() const
+	{
+		return component(2);
+	}
+
+	float* soa_buffer<vec4>::ws()
+	{
+		return component(3);
+	}
+
+	const float* soa_buffer<vec4>::ws() const
+	{
+		return component(3);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	soa_buffer<quat>::reference::reference(float& rx, float& ry, float& rz, float& rw)
+		: x(rx), y(ry), z(rz), w(rw)
+	{
+	}
+
+	soa_buffer<quat>::reference& soa_buffer<quat>::reference::operator=(const reference& other)
+	{
+		return *this = static_cast<quat>(other);
+	}
+
+	soa_buffer<quat>::reference& soa_buffer<quat>::reference::operator=(const quat& q)
+	{
+		x = q.x;
+		y = q.y;
+		z = q.z;
+		w = q.w;
+		return *this;
+	}
+
+	soa_buffer<quat>::reference::operator quat() const
+	{
+		return quat(x, y, z, w);
+	}
+
+	soa_buffer<quat>::soa_buffer(size_type initial_capacity)
+		: soa_storage<4>(initial_capacity)
+	{
+	}
+
+	void soa_buffer<quat>::add(const quat& q)
+	{
+		const size_type i = _grow();
+		xs()[i] = q.x;
+		ys()[i] = q.y;
+		zs()[i] = q.z;
+		ws()[i] = q.w;
+	}
+
+	soa_buffer<quat>::reference soa_buffer<quat>::operator[](size_type index)
+	{
+		return reference(xs()[index], ys()[index], zs()[index], ws()[index]);
+	}
+
+	quat soa_buffer<quat>::operator[](size_type index) const
+	{
+		return quat(xs()[index], ys()[index], zs()[index], ws()[index]);
+	}
+
+	float* soa_buffer<quat>::xs()
+	{
+		return component(0);
+	}
+
+	const float* soa_buffer<quat>::xs() const
+	{
+		return component(0);
+	}
+
+	float* soa_buffer<quat>::ys()
+	{
+		return component(1);
+	}
+
+	const float* soa_buffer<quat>::ys() const
+	{
+		return component(1);
+	}
+
+	float* soa_buffer<quat>::zs()
+	{
+		return component(2);
+	}
+
+	const float* soa_buffer<quat>::zs() const
+	{
+		return component(2);
+	}
+
+	float* soa_buffer<quat>::ws()
+	{
+		return component(3);
+	}
+
+	const float* soa_buffer<quat>::ws() const
+	{
+		return component(3);
+	}
+} // namespace bl
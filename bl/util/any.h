@@ -1,109 +1,347 @@
 #pragma once
+#include <bl/util/object_pool.h>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace bl
 {
+	// type erased copyable value. values of at most inline_size bytes with a nothrow move are stored inside the any,
+	// larger ones in a per-type object_pool. the stored type is identified by the address of a static per-type table
+	// of operations, so contains() and get() are a pointer comparison and need no rtti
 	class any
 	{
 	public:
-		inline any();
-
-		template<typename t_value>
-		inline any(const t_value& value);
+		static const size_t inline_size = 24;
 
+		inline any() noexcept;
 		inline any(const any& other);
+		inline any(any&& other) noexcept;
+
+		template<typename t_value, typename = typename std::enable_if<!std::is_same<typename std::decay<t_value>::type, any>::value>::type>
+		inline any(t_value&& value);
+
+		inline ~any();
+
+		inline any& operator=(const any& other);
+		inline any& operator=(any&& other) noexcept;
 
+		template<typename t_value, typename = typename std::enable_if<!std::is_same<typename std::decay<t_value>::type, any>::value>::type>
+		inline any& operator=(t_value&& value);
+
+		template<typename t_value, typename ...t_args>
+		inline t_value& emplace(t_args&& ...args);
+
+		inline void reset() noexcept;
+		inline void swap(any& other) noexcept;
+		inline bool empty() const noexcept;
+
+		// equal when both are empty or hold equal values of the same type
 		inline bool operator==(const any& other) const;
 
 		template<typename t_value>
-		inline bool contains() const;
+		inline bool contains() const noexcept;
 
+		// unchecked, contains<t_value>() must be true
 		template<typename t_value>
 		inline const t_value& get() const;
 
+		template<typename t_value>
+		inline t_value& get();
+
+		// nullptr unless contains<t_value>()
+		template<typename t_value>
+		inline const t_value* get_if() const noexcept;
+
+		template<typename t_value>
+		inline t_value* get_if() noexcept;
+
 	private:
-		class iholder
+		union storage
 		{
-		public:
-			virtual ~iholder() {}
-			virtual iholder* clone() const = 0;
-			virtual bool equals(iholder* other) const = 0;
+			void* heap;
+			typename std::aligned_storage<inline_size, alignof(void*)>::type buffer;
 		};
 
-		template<typename t_value>
-		class holder : public iholder
+		struct operations
 		{
-		public:
-			inline holder(const t_value& value);
-			inline virtual iholder* clone() const override;
-			inline virtual bool equals(iholder* other) const override;
-			inline const t_value& get() const;
+			void (*destroy)(storage& s);
+			void (*copy)(const storage& from, storage& to);
+			void (*move)(storage& from, storage& to); // from is left destroyed
+			bool (*equals)(const storage& a, const storage& b);
+		};
 
-		private:
-			t_value _value;
+		template<typename t_value>
+		struct fits_inline
+		{
+			static const bool value = sizeof(t_value) <= inline_size && alignof(t_value) <= alignof(void*) &&
+									  std::is_nothrow_move_constructible<t_value>::value;
 		};
 
-		iholder* _holder;
+		template<typename t_value, bool t_inline = fits_inline<t_value>::value>
+		struct handler;
+
+		const operations* _ops; // nullptr when empty, else the type tag
+		storage _storage;
 	};
 
-	any::any()
-		: _holder(nullptr)
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	struct any::handler<t_value, true>
 	{
-	}
+		static const operations ops;
+
+		inline static t_value* ptr(storage& s)
+		{
+			return reinterpret_cast<t_value*>(&s.buffer);
+		}
+
+		inline static const t_value* ptr(const storage& s)
+		{
+			return reinterpret_cast<const t_value*>(&s.buffer);
+		}
+
+		template<typename ...t_args>
+		inline static void create(storage& s, t_args&& ...args)
+		{
+			new(&s.buffer) t_value(std::forward<t_args>(args)...);
+		}
+
+		inline static void destroy(storage& s)
+		{
+			ptr(s)->~t_value();
+		}
+
+		inline static void copy(const storage& from, storage& to)
+		{
+			create(to, *ptr(from));
+		}
+
+		inline static void move(storage& from, storage& to)
+		{
+			create(to, std::move(*ptr(from)));
+			destroy(from);
+		}
+
+		inline static bool equals(const storage& a, const storage& b)
+		{
+			return *ptr(a) == *ptr(b);
+		}
+	};
 
 	template<typename t_value>
-	any::any(const t_value& value)
-		: _holder(new holder<t_value>(value))
+	struct any::handler<t_value, false>
+	{
+		static const operations ops;
+
+		inline static object_pool<t_value>& pool()
+		{
+			// intentionally never destroyed, values owned by static objects may outlive it
+			static object_pool<t_value>* p = new object_pool<t_value>();
+			return *p;
+		}
+
+		inline static t_value* ptr(storage& s)
+		{
+			return static_cast<t_value*>(s.heap);
+		}
+
+		inline static const t_value* ptr(const storage& s)
+		{
+			return static_cast<const t_value*>(s.heap);
+		}
+
+		template<typename ...t_args>
+		inline static void create(storage& s, t_args&& ...args)
+		{
+			s.heap = pool().create(std::forward<t_args>(args)...);
+		}
+
+		inline static void destroy(storage& s)
+		{
+			pool().destroy(ptr(s));
+		}
+
+		inline static void copy(const storage& from, storage& to)
+		{
+			create(to, *ptr(from));
+		}
+
+		inline static void move(storage& from, storage& to)
+		{
+			to.heap = from.heap;
+		}
+
+		inline static bool equals(const storage& a, const storage& b)
+		{
+			return *ptr(a) == *ptr(b);
+		}
+	};
+
+	template<typename t_value>
+	const any::operations any::handler<t_value, true>::ops = {&destroy, &copy, &move, &equals};
+
+	template<typename t_value>
+	const any::operations any::handler<t_value, false>::ops = {&destroy, &copy, &move, &equals};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	any::any() noexcept
+		: _ops(nullptr)
 	{
 	}
 
 	any::any(const any& other)
-		: _holder(other._holder? other._holder->clone() : nullptr)
+		: _ops(nullptr)
 	{
+		if(other._ops != nullptr)
+		{
+			other._ops->copy(other._storage, _storage);
+			_ops = other._ops;
+		}
 	}
 
-	bool any::operator==(const any& other) const
+	any::any(any&& other) noexcept
+		: _ops(other._ops)
 	{
-		return _holder->equals(other._holder);
+		if(_ops != nullptr)
+		{
+			_ops->move(other._storage, _storage);
+			other._ops = nullptr;
+		}
 	}
 
-	template<typename t_value>
-	bool any::contains() const
+	template<typename t_value, typename>
+	any::any(t_value&& value)
+		: _ops(nullptr)
+	{
+		typedef typename std::decay<t_value>::type value_type;
+		handler<value_type>::create(_storage, std::forward<t_value>(value));
+		_ops = &handler<value_type>::ops;
+	}
+
+	any::~any()
+	{
+		reset();
+	}
+
+	any& any::operator=(const any& other)
+	{
+		if(this != &other)
+		{
+			any copy(other);
+			swap(copy);
+		}
+		return *this;
+	}
+
+	any& any::operator=(any&& other) noexcept
+	{
+		if(this != &other)
+		{
+			reset();
+			if(other._ops != nullptr)
+			{
+				other._ops->move(other._storage, _storage);
+				_ops = other._ops;
+				other._ops = nullptr;
+			}
+		}
+		return *this;
+	}
+
+	template<typename t_value, typename>
+	any& any::operator=(t_value&& value)
+	{
+		// build before destroying the current value, value may refer into it as in a = a.get<t>()
+		any(std::forward<t_value>(value)).swap(*this);
+		return *this;
+	}
+
+	template<typename t_value, typename ...t_args>
+	t_value& any::emplace(t_args&& ...args)
 	{
-		return dynamic_cast<holder<t_value>*>(_holder) != nullptr;
+		reset();
+		handler<t_value>::create(_storage, std::forward<t_args>(args)...);
+		_ops = &handler<t_value>::ops;
+		return *handler<t_value>::ptr(_storage);
+	}
+
+	void any::reset() noexcept
+	{
+		if(_ops != nullptr)
+		{
+			_ops->destroy(_storage);
+			_ops = nullptr;
+		}
+	}
+
+	void any::swap(any& other) noexcept
+	{
+		if(this == &other)
+		{
+			return;
+		}
+
+		storage tmp;
+		if(other._ops != nullptr)
+		{
+			other._ops->move(other._storage, tmp);
+		}
+		if(_ops != nullptr)
+		{
+			_ops->move(_storage, other._storage);
+		}
+		if(other._ops != nullptr)
+		{
+			other._ops->move(tmp, _storage);
+		}
+		std::swap(_ops, other._ops);
+	}
+
+	bool any::empty() const noexcept
+	{
+		return _ops == nullptr;
+	}
+
+	bool any::operator==(const any& other) const
+	{
+		if(_ops != other._ops)
+		{
+			return false;
+		}
+		return _ops == nullptr || _ops->equals(_storage, other._storage);
 	}
 
 	template<typename t_value>
-	const t_value& any::get() const
+	bool any::contains() const noexcept
 	{
-		return dynamic_cast<holder<t_value>*>(_holder)->get();
+		return _ops == &handler<typename std::decay<t_value>::type>::ops;
 	}
 
 	template<typename t_value>
-	any::holder<t_value>::holder(const t_value& value)
-		: _value(value)
+	const t_value& any::get() const
 	{
+		return *handler<t_value>::ptr(_storage);
 	}
 
 	template<typename t_value>
-	any::iholder* any::holder<t_value>::clone() const
+	t_value& any::get()
 	{
-		return new holder<t_value>(_value);
+		return *handler<t_value>::ptr(_storage);
 	}
 
 	template<typename t_value>
-	bool any::holder<t_value>::equals(iholder* other) const
+	const t_value* any::get_if() const noexcept
 	{
-		auto other_holder = dynamic_cast<holder<t_value>*>(other);
-		if(other_holder == nullptr)
-		{
-			return false;
-		}
-		return _value == other_holder->_value;
+		return contains<t_value>() ? handler<t_value>::ptr(_storage) : nullptr;
 	}
 
 	template<typename t_value>
-	const t_value& any::holder<t_value>::get() const
+	t_value* any::get_if() noexcept
 	{
-		return _value;
+		return contains<t_value>() ? handler<t_value>::ptr(_storage) : nullptr;
 	}
 } // namespace bl
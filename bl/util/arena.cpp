@@ -0,0 +1,116 @@
+#include <bl/util/arena.h>
+
+namespace bl
+{
+	arena::arena(size_t block_size)
+		: _block_size(block_size),
+		  _bytes_reserved(0),
+		  _first(nullptr),
+		  _current(nullptr),
+		  _ptr(nullptr),
+		  _limit(nullptr)
+	{
+	}
+
+	arena::~arena()
+	{
+		release();
+	}
+
+	void arena::reset()
+	{
+		_current = nullptr;
+		_ptr = nullptr;
+		_limit = nullptr;
+	}
+
+	arena::marker arena::mark() const
+	{
+		marker m;
+		m.block = _current;
+		m.ptr = _ptr;
+		return m;
+	}
+
+	void arena::rewind(const marker& m)
+	{
+		_current = static_cast<block*>(m.block);
+		_ptr = m.ptr;
+		_limit = _current != nullptr ? _end(_current) : nullptr;
+	}
+
+	void arena::release()
+	{
+		while(_first != nullptr)
+		{
+			block* next = _first->next;
+			::operator delete(_first);
+			_first = next;
+		}
+		_bytes_reserved = 0;
+		reset();
+	}
+
+	size_t arena::block_size() const
+	{
+		return _block_size;
+	}
+
+	size_t arena::bytes_reserved() const
+	{
+		return _bytes_reserved;
+	}
+
+	char* arena::_begin(block* b)
+	{
+		return reinterpret_cast<char*>(b + 1);
+	}
+
+	char* arena::_end(block* b)
+	{
+		return _begin(b) + b->size;
+	}
+
+	void* arena::_allocate_slow(size_t size, size_t alignment)
+	{
+		const size_t needed = size + alignment - 1;
+
+		// reuse the block that follows the current one (kept by reset/rewind) when it is large enough,
+		// otherwise link a new block right after the current one
+		block* next = _current != nullptr ? _current->next : _first;
+		if(next == nullptr || next->size < needed)
+		{
+			const size_t new_size = needed > _block_size ? needed : _block_size;
+			block* b = static_cast<block*>(::operator new(sizeof(block) + new_size));
+			b->size = new_size;
+			b->next = next;
+			if(_current != nullptr)
+			{
+				_current->next = b;
+			}
+			else
+			{
+				_first = b;
+			}
+			_bytes_reserved += new_size;
+			next = b;
+		}
+
+		_current = next;
+		_ptr = _begin(next);
+		_limit = _end(next);
+		return allocate(size, alignment);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	arena_scope::arena_scope(arena& a)
+		: _arena(a), _marker(a.mark())
+	{
+	}
+
+	arena_scope::~arena_scope()
+	{
+		_arena.rewind(_marker);
+	}
+} // namespace bl
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bl
+{
+	// monotonic bump allocator: memory comes from chunked blocks and is only given back by reset/rewind/release.
+	// not thread safe, use one arena per thread or per request.
+	class arena
+	{
+	public:
+		// position inside the arena, used to rewind to an earlier state
+		struct marker
+		{
+			void* block;
+			char* ptr;
+		};
+
+		explicit arena(size_t block_size = 64*1024);
+		~arena();
+
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		// constructed objects are never destroyed, only use for trivially destructible types or call the destructor yourself
+		template<typename t_value, typename ...t_args>
+		t_value* create(t_args&& ...args);
+
+		// O(1): rewinds to the first block and keeps every block for reuse
+		void reset();
+		marker mark() const;
+		void rewind(const marker& m);
+
+		// frees every block
+		void release();
+
+		size_t block_size() const;
+		size_t bytes_reserved() const;
+
+	private:
+		struct block
+		{
+			block* next;
+			size_t size;
+		};
+
+		static char* _begin(block* b);
+		static char* _end(block* b);
+		void* _allocate_slow(size_t size, size_t alignment);
+
+		size_t _block_size;
+		size_t _bytes_reserved;
+		block* _first;
+		block* _current;
+		char* _ptr;
+		char* _limit;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// restores the arena to its state at construction when going out of scope
+	class arena_scope
+	{
+	public:
+		explicit arena_scope(arena& a);
+		~arena_scope();
+
+		arena_scope(const arena_scope&) = delete;
+		arena_scope& operator=(const arena_scope&) = delete;
+
+	private:
+		arena& _arena;
+		arena::marker _marker;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// stl allocator adapter, deallocate is a no-op and memory is reclaimed by the arena
+	template<typename t_value>
+	class arena_allocator
+	{
+	public:
+		typedef t_value value_type;
+
+		template<typename t_other>
+		struct rebind
+		{
+			typedef arena_allocator<t_other> other;
+		};
+
+		arena_allocator(arena& a);
+
+		template<typename t_other>
+		arena_allocator(const arena_allocator<t_other>& other);
+
+		t_value* allocate(size_t n);
+		void deallocate(t_value* ptr, size_t n);
+
+		arena* get_arena() const;
+
+	private:
+		arena* _arena;
+	};
+
+	template<typename t_value, typename t_other>
+	bool operator==(const arena_allocator<t_value>& a, const arena_allocator<t_other>& b);
+
+	template<typename t_value, typename t_other>
+	bool operator!=(const arena_allocator<t_value>& a, const arena_allocator<t_other>& b);
+
+	template<typename t_value>
+	using arena_vector = std::vector<t_value, arena_allocator<t_value>>;
+
+	typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline void* arena::allocate(size_t size, size_t alignment)
+	{
+		const uintptr_t aligned = (reinterpret_cast<uintptr_t>(_ptr) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		if(_ptr == nullptr || aligned + size > reinterpret_cast<uintptr_t>(_limit))
+		{
+			return _allocate_slow(size, alignment);
+		}
+		_ptr = reinterpret_cast<char*>(aligned + size);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	template<typename t_value, typename ...t_args>
+	t_value* arena::create(t_args&& ...args)
+	{
+		return new(allocate(sizeof(t_value), alignof(t_value))) t_value(std::forward<t_args>(args)...);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	arena_allocator<t_value>::arena_allocator(arena& a)
+		: _arena(&a)
+	{
+	}
+
+	template<typename t_value>
+	template<typename t_other>
+	arena_allocator<t_value>::arena_allocator(const arena_allocator<t_other>& other)
+		: _arena(other.get_arena())
+	{
+	}
+
+	template<typename t_value>
+	t_value* arena_allocator<t_value>::allocate(size_t n)
+	{
+		return static_cast<t_value*>(_arena->allocate(n * sizeof(t_value), alignof(t_value)));
+	}
+
+	template<typename t_value>
+	void arena_allocator<t_value>::deallocate(t_value*, size_t)
+	{
+	}
+
+	template<typename t_value>
+	arena* arena_allocator<t_value>::get_arena() const
+	{
+		return _arena;
+	}
+
+	template<typename t_value, typename t_other>
+	bool operator==(const arena_allocator<t_value>& a, const arena_allocator<t_other>& b)
+	{
+		return a.get_arena() == b.get_arena();
+	}
+
+	template<typename t_value, typename t_other>
+	bool operator!=(const arena_allocator<t_value>& a, const arena_allocator<t_other>& b)
+	{
+		return !(a == b);
+	}
+} // namespace bl
@@ -1,13 +1,17 @@
 #pragma once
+#include <bl/util/thread_pool.h>
 #include <future>
 
 namespace bl
 {
 	using std::future;
 
+	// runs on the global thread_pool instead of a new thread per call. unlike std::async the returned future
+	// does not block in its destructor. get() and wait() on a pool worker execute queued tasks until the result is
+	// ready, so tasks can wait for the tasks they spawned even on a single worker
 	template<typename t_function, typename ...t_args>
-	auto async(t_function function, t_args&& ...args) -> decltype(std::async(std::launch::async, function, std::forward<t_args>(args)...))
+	auto async(t_function&& function, t_args&& ...args) -> decltype(thread_pool::global().async(std::forward<t_function>(function), std::forward<t_args>(args)...))
 	{
-		return std::async(std::launch::async, function, std::forward<t_args>(args)...);
+		return thread_pool::global().async(std::forward<t_function>(function), std::forward<t_args>(args)...);
 	}
 } // namespace bl
@@ -0,0 +1,453 @@
+#include <bl/util/bench.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace bl
+{
+	static const perf_counters::event s_events[] = {perf_counters::event::cycles, perf_counters::event::instructions,
+													perf_counters::event::branch_misses, perf_counters::event::l1d_misses,
+													perf_counters::event::llc_misses, perf_counters::event::dtlb_misses};
+
+	// value at fraction q (0 to 1) of sorted values, interpolated between neighbors
+	static double s_quantile(const std::vector<double>& sorted, double q)
+	{
+		const double position = q * static_cast<double>(sorted.size() - 1);
+		const size_t below = static_cast<size_t>(position);
+		const size_t above = below + 1 < sorted.size() ? below + 1 : below;
+		const double fraction = position - static_cast<double>(below);
+		return sorted[below] + (sorted[above] - sorted[below]) * fraction;
+	}
+
+	// z with P(|Z| <= z) = confidence for a standard normal Z, by bisection on erf
+	static double s_normal_quantile(double confidence)
+	{
+		double low = 0;
+		double high = 10;
+		for(int i = 0; i < 64; ++i)
+		{
+			const double middle = (low + high) / 2;
+			if(std::erf(middle / std::sqrt(2.0)) < confidence)
+			{
+				low = middle;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+		return (low + high) / 2;
+	}
+
+	static std::string s_format_time(double ns)
+	{
+		char buffer[32];
+		if(ns < 1e3)
+		{
+			std::snprintf(buffer, sizeof(buffer), "%.2f ns", ns);
+		}
+		else if(ns < 1e6)
+		{
+			std::snprintf(buffer, sizeof(buffer), "%.2f us", ns * 1e-3);
+		}
+		else if(ns < 1e9)
+		{
+			std::snprintf(buffer, sizeof(buffer), "%.2f ms", ns * 1e-6);
+		}
+		else
+		{
+			std::snprintf(buffer, sizeof(buffer), "%.2f s", ns * 1e-9);
+		}
+		return buffer;
+	}
+
+	static void s_write_string(std::ostream& out, const std::string& s)
+	{
+		out << '"';
+		for(char c : s)
+		{
+			if(c == '"' || c == '\\')
+			{
+				out << '\\' << c;
+			}
+			else if(static_cast<unsigned char>(c) < 0x20)
+			{
+				char buffer[8];
+				std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+				out << buffer;
+			}
+			else
+			{
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
+	static std::string s_number(double value)
+	{
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+		return buffer;
+	}
+
+	// two sided p value of the mann-whitney u test, normal approximation with tie and continuity correction
+	// ref: https://en.wikipedia.org/wiki/Mann%E2%80%93Whitney_U_test
+	static double s_mann_whitney(const std::vector<double>& a, const std::vector<double>& b)
+	{
+		std::vector<std::pair<double, bool>> pooled;
+		for(double v : a)
+		{
+			pooled.push_back(std::make_pair(v, true));
+		}
+		for(double v : b)
+		{
+			pooled.push_back(std::make_pair(v, false));
+		}
+		std::sort(pooled.begin(), pooled.end());
+
+		// ties share the average of their ranks
+		const double n = static_cast<double>(pooled.size());
+		double rank_sum = 0;
+		double ties = 0;
+		for(size_t first = 0; first < pooled.size();)
+		{
+			size_t last = first + 1;
+			while(last < pooled.size() && pooled[last].first == pooled[first].first)
+			{
+				++last;
+			}
+			const double count = static_cast<double>(last - first);
+			const double rank = (static_cast<double>(first + 1) + static_cast<double>(last)) / 2;
+			for(size_t i = first; i < last; ++i)
+			{
+				rank_sum += pooled[i].second ? rank : 0;
+			}
+			ties += count * count * count - count;
+			first = last;
+		}
+
+		const double n1 = static_cast<double>(a.size());
+		const double n2 = static_cast<double>(b.size());
+		const double u = rank_sum - n1 * (n1 + 1) / 2;
+		const double mean = n1 * n2 / 2;
+		const double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+		if(variance <= 0)
+		{
+			return 1;
+		}
+		double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+		z = z < 0 ? 0 : z;
+		return std::erfc(z / std::sqrt(2.0));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	bench::config::config()
+		: warmup_seconds(0.05), sample_seconds(0.01), samples(20), min_samples(3), max_seconds(2), confidence(0.95), counters(true), verbose(true)
+	{
+	}
+
+	double bench::result::per_item(perf_counters::event e) const
+	{
+		const double items = static_cast<double>(iterations) * static_cast<double>(size == 0 ? 1 : size);
+		return items > 0 ? static_cast<double>(counters[e]) / items : 0;
+	}
+
+	bench::bench(const config& c)
+		: _config(c)
+	{
+	}
+
+	const std::vector<bench::result>& bench::results() const
+	{
+		return _results;
+	}
+
+	const bench::config& bench::settings() const
+	{
+		return _config;
+	}
+
+	void bench::_summarize(result& r, std::vector<double>& times, double confidence)
+	{
+		std::sort(times.begin(), times.end());
+		const size_t n = times.size();
+		r.samples = static_cast<int>(n);
+		r.min = times.front();
+		r.max = times.back();
+		r.median = s_quantile(times, 0.5);
+
+		std::vector<double> deviations(n);
+		for(size_t i = 0; i < n; ++i)
+		{
+			deviations[i] = std::fabs(times[i] - r.median);
+		}
+		std::sort(deviations.begin(), deviations.end());
+		r.mad = s_quantile(deviations, 0.5);
+
+		// tukey fences
+		const double q1 = s_quantile(times, 0.25);
+		const double q3 = s_quantile(times, 0.75);
+		const double low_fence = q1 - 1.5 * (q3 - q1);
+		const double high_fence = q3 + 1.5 * (q3 - q1);
+		double sum = 0;
+		size_t kept = 0;
+		for(double t : times)
+		{
+			if(t >= low_fence && t <= high_fence)
+			{
+				sum += t;
+				++kept;
+			}
+		}
+		r.outliers = static_cast<int>(n - kept);
+		r.mean = sum / static_cast<double>(kept);
+		double squares = 0;
+		for(double t : times)
+		{
+			if(t >= low_fence && t <= high_fence)
+			{
+				squares += (t - r.mean) * (t - r.mean);
+			}
+		}
+		r.stddev = kept > 1 ? std::sqrt(squares / static_cast<double>(kept - 1)) : 0;
+
+		// distribution free interval of the median from the order statistics around it
+		// ref: https://www-users.york.ac.uk/~mb55/intro/cicent.htm
+		const double z = s_normal_quantile(confidence);
+		const double half_width = z * std::sqrt(static_cast<double>(n)) / 2;
+		const double lower_rank = std::floor(static_cast<double>(n) / 2 - half_width) - 1;
+		const double upper_rank = std::ceil(static_cast<double>(n) / 2 + half_width);
+		r.ci_low = times[lower_rank < 0 ? 0 : static_cast<size_t>(lower_rank)];
+		r.ci_high = times[upper_rank >= static_cast<double>(n) ? n - 1 : static_cast<size_t>(upper_rank)];
+
+		r.items_per_second = r.median > 0 ? static_cast<double>(r.size) / (r.median * 1e-9) : 0;
+		r.times = times;
+	}
+
+	const bench::result& bench::_finish(result& r, std::vector<double>& times)
+	{
+		_summarize(r, times, _config.confidence);
+		_results.push_back(r);
+		if(_config.verbose)
+		{
+			_print(_results.back());
+		}
+		return _results.back();
+	}
+
+	void bench::_print(const result& r) const
+	{
+		char rate[32];
+		std::snprintf(rate, sizeof(rate), "%.2f", r.items_per_second * 1e-6);
+		std::cout << r.name << " [" << r.size << "] - median: " << s_format_time(r.median) << " +/- " << s_format_time(r.mad)
+				  << " | " << static_cast<int>(_config.confidence * 100) << "% ci: " << s_format_time(r.ci_low) << " .. " << s_format_time(r.ci_high)
+				  << " | million items/s: " << rate << " | samples: " << r.samples << " x " << r.iterations / static_cast<uint64>(r.samples)
+				  << " | outliers: " << r.outliers << std::endl;
+
+		if(r.counters.valid(perf_counters::event::cycles) || r.counters.valid(perf_counters::event::branch_misses))
+		{
+			std::cout << "    ipc: " << s_number(r.counters.ipc());
+			for(perf_counters::event e : s_events)
+			{
+				if(e != perf_counters::event::instructions && r.counters.valid(e))
+				{
+					std::cout << " | " << perf_counters::name(e) << "/item: " << s_number(r.per_item(e));
+				}
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	void bench::write_json(std::ostream& out) const
+	{
+		out << "{\"benchmarks\":[";
+		for(size_t i = 0; i < _results.size(); ++i)
+		{
+			const result& r = _results[i];
+			out << (i == 0 ? "\n{" : ",\n{") << "\"name\":";
+			s_write_string(out, r.name);
+			out << ",\"size\":" << r.size << ",\"samples\":" << r.samples << ",\"iterations\":" << r.iterations
+				<< ",\"median_ns\":" << s_number(r.median) << ",\"mad_ns\":" << s_number(r.mad)
+				<< ",\"mean_ns\":" << s_number(r.mean) << ",\"stddev_ns\":" << s_number(r.stddev)
+				<< ",\"min_ns\":" << s_number(r.min) << ",\"max_ns\":" << s_number(r.max)
+				<< ",\"ci_low_ns\":" << s_number(r.ci_low) << ",\"ci_high_ns\":" << s_number(r.ci_high)
+				<< ",\"outliers\":" << r.outliers << ",\"items_per_second\":" << s_number(r.items_per_second) << ",\"counters_per_item\":{";
+			bool first = true;
+			for(perf_counters::event e : s_events)
+			{
+				if(r.counters.valid(e))
+				{
+					out << (first ? "\"" : ",\"") << perf_counters::name(e) << "\":" << s_number(r.per_item(e));
+					first = false;
+				}
+			}
+			out << "}}";
+		}
+		out << "\n],\"confidence\":" << s_number(_config.confidence) << "}\n";
+	}
+
+	void bench::write_csv(std::ostream& out) const
+	{
+		out << "name,size,samples,iterations,median_ns,mad_ns,mean_ns,stddev_ns,min_ns,max_ns,ci_low_ns,ci_high_ns,outliers,items_per_second";
+		for(perf_counters::event e : s_events)
+		{
+			out << ',' << perf_counters::name(e) << "_per_item";
+		}
+		out << '\n';
+		for(const result& r : _results)
+		{
+			// names are quoted with embedded quotes doubled, so they may contain commas
+			std::string name = r.name;
+			for(size_t p = name.find('"'); p != std::string::npos; p = name.find('"', p + 2))
+			{
+				name.insert(p, 1, '"');
+			}
+			out << '"' << name << "\"," << r.size << ',' << r.samples << ',' << r.iterations << ',' << s_number(r.median) << ','
+				<< s_number(r.mad) << ',' << s_number(r.mean) << ',' << s_number(r.stddev) << ',' << s_number(r.min) << ','
+				<< s_number(r.max) << ',' << s_number(r.ci_low) << ',' << s_number(r.ci_high) << ',' << r.outliers << ','
+				<< s_number(r.items_per_second);
+			for(perf_counters::event e : s_events)
+			{
+				out << ',';
+				if(r.counters.valid(e))
+				{
+					out << s_number(r.per_item(e));
+				}
+			}
+			out << '\n';
+		}
+	}
+
+	void bench::write_baseline(std::ostream& out) const
+	{
+		// one line per result: name, size, iterations and the sample times, tab separated
+		out << "bl::bench baseline 1\n";
+		for(const result& r : _results)
+		{
+			out << r.name << '\t' << r.size << '\t' << r.iterations << '\t';
+			for(size_t i = 0; i < r.times.size(); ++i)
+			{
+				char buffer[32];
+				std::snprintf(buffer, sizeof(buffer), i == 0 ? "%.9g" : " %.9g", r.times[i]);
+				out << buffer;
+			}
+			out << '\n';
+		}
+	}
+
+	bool bench::read_baseline(std::istream& in, std::vector<result>& baseline)
+	{
+		std::string line;
+		if(!std::getline(in, line) || line != "bl::bench baseline 1")
+		{
+			return false;
+		}
+		while(std::getline(in, line))
+		{
+			if(line.empty())
+			{
+				continue;
+			}
+			const size_t name_end = line.find('\t');
+			if(name_end == std::string::npos)
+			{
+				return false;
+			}
+			result r;
+			r.name = line.substr(0, name_end);
+			std::istringstream fields(line.substr(name_end + 1));
+			std::vector<double> times;
+			double t;
+			if(!(fields >> r.size >> r.iterations))
+			{
+				return false;
+			}
+			while(fields >> t)
+			{
+				times.push_back(t);
+			}
+			if(times.empty())
+			{
+				return false;
+			}
+			_summarize(r, times, 0.95);
+			baseline.push_back(r);
+		}
+		return true;
+	}
+
+	std::vector<bench::comparison> bench::compare(const std::vector<result>& baseline, double alpha, double threshold) const
+	{
+		std::vector<comparison> comparisons;
+		for(const result& current : _results)
+		{
+			for(const result& base : baseline)
+			{
+				if(base.name != current.name || base.size != current.size)
+				{
+					continue;
+				}
+				comparison c;
+				c.name = current.name;
+				c.size = current.size;
+				c.baseline = base.median;
+				c.current = current.median;
+				c.speedup = current.median > 0 ? base.median / current.median : 0;
+				c.p_value = s_mann_whitney(base.times, current.times);
+				c.verdict = change::none;
+				if(c.p_value < alpha)
+				{
+					if(current.median > base.median * (1 + threshold))
+					{
+						c.verdict = change::slower;
+					}
+					else if(current.median * (1 + threshold) < base.median)
+					{
+						c.verdict = change::faster;
+					}
+				}
+				comparisons.push_back(c);
+				break;
+			}
+		}
+		return comparisons;
+	}
+
+	void bench::write_comparison(std::ostream& out, const std::vector<comparison>& comparisons)
+	{
+		size_t width = 9;
+		for(const comparison& c : comparisons)
+		{
+			width = c.name.size() > width ? c.name.size() : width;
+		}
+		char buffer[160];
+		std::snprintf(buffer, sizeof(buffer), "%-*s %12s %12s %12s %9s %8s\n", static_cast<int>(width), "benchmark", "size", "baseline", "current", "speedup", "p");
+		out << buffer;
+		for(const comparison& c : comparisons)
+		{
+			const char* verdict = c.verdict == change::slower ? "  slower" : c.verdict == change::faster ? "  faster" : "";
+			std::snprintf(buffer, sizeof(buffer), "%-*s %12llu %12s %12s %8.3fx %8.4f", static_cast<int>(width), c.name.c_str(),
+						  static_cast<unsigned long long>(c.size), s_format_time(c.baseline).c_str(), s_format_time(c.current).c_str(), c.speedup, c.p_value);
+			out << buffer << verdict << '\n';
+		}
+	}
+
+	std::vector<uint64> bench::geometric_sizes(uint64 first, uint64 last, uint64 factor)
+	{
+		std::vector<uint64> sizes;
+		for(uint64 size = first < 1 ? 1 : first; size <= last; size *= (factor < 2 ? 2 : factor))
+		{
+			sizes.push_back(size);
+			if(size > last / (factor < 2 ? 2 : factor))
+			{
+				break;
+			}
+		}
+		return sizes;
+	}
+} // namespace bl
@@ -0,0 +1,252 @@
+#pragma once
+#include <bl/util/cycle_timer.h>
+#include <bl/util/integer.h>
+#include <bl/util/perf_counters.h>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bl
+{
+	// keeps the compiler from discarding a value computed only for measuring
+	template<typename t_value>
+	inline void do_not_optimize(const t_value& value)
+	{
+	#if defined(__GNUG__)
+		asm volatile("" : : "g"(&value) : "memory");
+	#else
+		const volatile char* p = reinterpret_cast<const volatile char*>(&value);
+		(void)*p;
+	#endif
+	}
+
+	// micro benchmark runner: warms up, picks how many iterations a sample needs to be long enough to time, collects
+	// samples until it has enough or its time budget is spent and summarizes them with robust statistics. an iteration
+	// may have an untimed setup (e.g. refilling the array to sort) and teardown (e.g. checking the result)
+	class bench
+	{
+	public:
+		struct config
+		{
+			config();
+
+			double warmup_seconds; // untimed runs before measuring, at least one
+			double sample_seconds; // minimum timed duration of a sample, iterations are repeated to reach it
+			int samples;
+			int min_samples;    // kept even past the budget
+			double max_seconds; // timed duration after which a benchmark stops sampling
+			double confidence;  // of the median interval
+			bool counters;      // sample perf_counters around the timed sections
+			bool verbose;       // print every result as it completes
+		};
+
+		struct result
+		{
+			std::string name;
+			uint64 size;       // items processed per iteration
+			int samples;
+			uint64 iterations; // timed iterations over all samples
+
+			// nanoseconds per iteration
+			double median;
+			double mad; // median absolute deviation
+			double mean; // without outliers
+			double stddev; // without outliers
+			double min;
+			double max;
+			double ci_low; // confidence interval of the median
+			double ci_high;
+			int outliers; // samples beyond 1.5 interquartile ranges
+
+			double items_per_second;
+			perf_counters::sample counters; // sum over the timed iterations
+			std::vector<double> times;      // nanoseconds per iteration of every sample, sorted
+
+			double per_item(perf_counters::event e) const;
+		};
+
+		enum class change
+		{
+			none,
+			faster,
+			slower
+		};
+
+		struct comparison
+		{
+			std::string name;
+			uint64 size;
+			double baseline; // median nanoseconds per iteration
+			double current;
+			double speedup; // baseline / current
+			double p_value; // two sided mann-whitney u test of the samples
+			change verdict;
+		};
+
+		explicit bench(const config& c = config());
+
+		template<typename t_function>
+		const result& run(const std::string& name, uint64 size, t_function fn);
+
+		template<typename t_setup, typename t_function>
+		const result& run(const std::string& name, uint64 size, t_setup setup, t_function fn);
+
+		template<typename t_setup, typename t_function, typename t_teardown>
+		const result& run(const std::string& name, uint64 size, t_setup setup, t_function fn, t_teardown teardown);
+
+		const std::vector<result>& results() const;
+		const config& settings() const;
+
+		void write_json(std::ostream& out) const;
+		void write_csv(std::ostream& out) const;
+
+		// the samples of every result, to compare later runs against
+		void write_baseline(std::ostream& out) const;
+
+		// results rebuilt from a baseline (no counters), false when it is malformed
+		static bool read_baseline(std::istream& in, std::vector<result>& baseline);
+
+		// results that have a baseline with the same name and size. a change is reported when the samples differ at
+		// significance alpha and the medians by more than threshold (0.05 is 5%)
+		std::vector<comparison> compare(const std::vector<result>& baseline, double alpha = 0.05, double threshold = 0.05) const;
+		static void write_comparison(std::ostream& out, const std::vector<comparison>& comparisons);
+
+		// first, first * factor, ... up to last
+		static std::vector<uint64> geometric_sizes(uint64 first, uint64 last, uint64 factor = 10);
+
+	private:
+		struct nothing
+		{
+			void operator()() const
+			{
+			}
+		};
+
+		template<bool t_batched, typename t_setup, typename t_function, typename t_teardown>
+		const result& _run(const std::string& name, uint64 size, t_setup& setup, t_function& fn, t_teardown& teardown);
+
+		// timed ticks of count iterations
+		template<bool t_batched, typename t_setup, typename t_function, typename t_teardown>
+		uint64 _measure(uint64 count, t_setup& setup, t_function& fn, t_teardown& teardown, perf_counters::sample* counters);
+
+		static void _summarize(result& r, std::vector<double>& times, double confidence);
+		const result& _finish(result& r, std::vector<double>& times);
+		void _print(const result& r) const;
+
+		config _config;
+		perf_counters _counters;
+		std::vector<result> _results;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_function>
+	const bench::result& bench::run(const std::string& name, uint64 size, t_function fn)
+	{
+		nothing setup, teardown;
+		return _run<true>(name, size, setup, fn, teardown);
+	}
+
+	template<typename t_setup, typename t_function>
+	const bench::result& bench::run(const std::string& name, uint64 size, t_setup setup, t_function fn)
+	{
+		nothing teardown;
+		return _run<false>(name, size, setup, fn, teardown);
+	}
+
+	template<typename t_setup, typename t_function, typename t_teardown>
+	const bench::result& bench::run(const std::string& name, uint64 size, t_setup setup, t_function fn, t_teardown teardown)
+	{
+		return _run<false>(name, size, setup, fn, teardown);
+	}
+
+	template<bool t_batched, typename t_setup, typename t_function, typename t_teardown>
+	uint64 bench::_measure(uint64 count, t_setup& setup, t_function& fn, t_teardown& teardown, perf_counters::sample* counters)
+	{
+		const bool sample_counters = counters != nullptr && _config.counters && _counters.available();
+		uint64 ticks = 0;
+		if(t_batched)
+		{
+			// nothing untimed between iterations, time them together
+			if(sample_counters)
+			{
+				_counters.start();
+			}
+			const cycle_timer::ticks start = cycle_timer::now_serialized();
+			for(uint64 i = 0; i < count; ++i)
+			{
+				fn();
+			}
+			ticks = cycle_timer::now_serialized() - start;
+			if(sample_counters)
+			{
+				_counters.stop();
+				*counters += _counters.read();
+			}
+			return ticks;
+		}
+
+		for(uint64 i = 0; i < count; ++i)
+		{
+			setup();
+			if(sample_counters)
+			{
+				_counters.start();
+			}
+			const cycle_timer::ticks start = cycle_timer::now_serialized();
+			fn();
+			ticks += cycle_timer::now_serialized() - start;
+			if(sample_counters)
+			{
+				_counters.stop();
+				*counters += _counters.read();
+			}
+			teardown();
+		}
+		return ticks;
+	}
+
+	template<bool t_batched, typename t_setup, typename t_function, typename t_teardown>
+	const bench::result& bench::_run(const std::string& name, uint64 size, t_setup& setup, t_function& fn, t_teardown& teardown)
+	{
+		result r;
+		r.name = name;
+		r.size = size;
+		r.iterations = 0;
+
+		// warm up and estimate the duration of one iteration
+		const double warmup_ns = _config.warmup_seconds * 1e9;
+		double spent_ns = 0;
+		double iteration_ns = 0;
+		uint64 batch = 1;
+		do
+		{
+			iteration_ns = cycle_timer::to_nanoseconds(_measure<t_batched>(batch, setup, fn, teardown, nullptr)) / static_cast<double>(batch);
+			spent_ns += iteration_ns * static_cast<double>(batch);
+			batch = batch < (uint64(1) << 30) ? batch * 2 : batch;
+		}
+		while(spent_ns < warmup_ns);
+
+		const double sample_ns = _config.sample_seconds * 1e9;
+		uint64 count = iteration_ns > 0 ? static_cast<uint64>(sample_ns / iteration_ns) : 1;
+		count = count < 1 ? 1 : count;
+
+		std::vector<double> times;
+		const double budget_ns = _config.max_seconds * 1e9;
+		spent_ns = 0;
+		while(static_cast<int>(times.size()) < _config.samples)
+		{
+			const double ns = cycle_timer::to_nanoseconds(_measure<t_batched>(count, setup, fn, teardown, &r.counters));
+			times.push_back(ns / static_cast<double>(count));
+			r.iterations += count;
+			spent_ns += ns;
+			if(spent_ns > budget_ns && static_cast<int>(times.size()) >= _config.min_samples)
+			{
+				break;
+			}
+		}
+		return _finish(r, times);
+	}
+} // namespace bl
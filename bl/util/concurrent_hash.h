@@ -0,0 +1,241 @@
+#pragma once
+#include <bl/util/flat_hash.h>
+#include <bl/util/platform.h>
+#include <bl/util/thread.h>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace bl
+{
+	// hash map for many threads: keys are spread over independent shards by their hash bits, each shard is a
+	// flat_hash_map guarded by a rw_spin_lock so lookups on any shard never block each other.
+	// values are returned by copy or visited under the shard lock, references never escape.
+	template<typename t_key,
+			 typename t_value,
+			 typename t_hash = hash<t_key>,
+			 typename t_pred = equal_to<t_key>>
+	class concurrent_hash_map
+	{
+	public:
+		typedef t_key key_type;
+		typedef t_value mapped_type;
+
+		// shard_count is rounded up to a power of two, 0 picks 8 shards per hardware thread
+		explicit concurrent_hash_map(size_t shard_count = 0, const t_hash& hash = t_hash(), const t_pred& pred = t_pred());
+
+		concurrent_hash_map(const concurrent_hash_map&) = delete;
+		concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+		// copies the value into out when found
+		bool find(const t_key& key, t_value& out) const;
+		bool contains(const t_key& key) const;
+
+		// calls f(const t_value&) under the shared shard lock, returns false when key is missing
+		template<typename t_func>
+		bool visit(const t_key& key, t_func f) const;
+
+		// returns false and leaves the map untouched if key already exists
+		bool insert(const t_key& key, const t_value& value);
+
+		// returns true if key was inserted, false if an existing value was overwritten
+		bool insert_or_update(const t_key& key, const t_value& value);
+
+		// atomic read-modify-write: calls f(t_value& value, bool inserted) under the exclusive shard lock,
+		// value is default constructed when key was missing. returns inserted
+		template<typename t_func>
+		bool compute(const t_key& key, t_func f);
+
+		bool erase(const t_key& key);
+
+		// calls f(const t_key&, const t_value&) for every entry, one shard at a time
+		template<typename t_func>
+		void for_each(t_func f) const;
+
+		// sums the shards without a global lock, exact only when no writer is active
+		size_t size() const;
+		bool empty() const;
+		void clear();
+		void reserve(size_t count);
+		size_t shard_count() const;
+
+	private:
+		typedef flat_hash_map<t_key, t_value, t_hash, t_pred> map_type;
+
+		struct shard
+		{
+			mutable rw_spin_lock lock;
+			map_type map;
+			char pad[BL_CACHE_LINE_SIZE]; // keep neighbour locks off the same line
+		};
+
+		shard& _shard(const t_key& key) const;
+
+		std::unique_ptr<shard[]> _shards;
+		size_t _shard_count;
+		unsigned _shard_bits;
+		t_hash _hash;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	concurrent_hash_map<t_key, t_value, t_hash, t_pred>::concurrent_hash_map(size_t shard_count, const t_hash& hash, const t_pred& pred)
+		: _shard_count(1), _shard_bits(0), _hash(hash)
+	{
+		if(shard_count == 0)
+		{
+			const unsigned hw = std::thread::hardware_concurrency();
+			shard_count = (hw == 0 ? 4 : hw) * 8;
+		}
+		while(_shard_count < shard_count)
+		{
+			_shard_count *= 2;
+			++_shard_bits;
+		}
+
+		_shards.reset(new shard[_shard_count]);
+		for(size_t i = 0; i < _shard_count; ++i)
+		{
+			_shards[i].map = map_type(0, hash, pred);
+		}
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::find(const t_key& key, t_value& out) const
+	{
+		return visit(key, [&out](const t_value& v) { out = v; });
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::contains(const t_key& key) const
+	{
+		const shard& s = _shard(key);
+		shared_spin_lock l(s.lock);
+		return s.map.contains(key);
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	template<typename t_func>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::visit(const t_key& key, t_func f) const
+	{
+		const shard& s = _shard(key);
+		shared_spin_lock l(s.lock);
+		auto it = s.map.find(key);
+		if(it == s.map.end())
+		{
+			return false;
+		}
+		f(it->second);
+		return true;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::insert(const t_key& key, const t_value& value)
+	{
+		shard& s = _shard(key);
+		unique_spin_lock l(s.lock);
+		return s.map.try_emplace(key, value).second;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::insert_or_update(const t_key& key, const t_value& value)
+	{
+		shard& s = _shard(key);
+		unique_spin_lock l(s.lock);
+		return s.map.insert_or_assign(key, value).second;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	template<typename t_func>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::compute(const t_key& key, t_func f)
+	{
+		shard& s = _shard(key);
+		unique_spin_lock l(s.lock);
+		auto res = s.map.try_emplace(key);
+		f(res.first->second, res.second);
+		return res.second;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::erase(const t_key& key)
+	{
+		shard& s = _shard(key);
+		unique_spin_lock l(s.lock);
+		return s.map.erase(key) > 0;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	template<typename t_func>
+	void concurrent_hash_map<t_key, t_value, t_hash, t_pred>::for_each(t_func f) const
+	{
+		for(size_t i = 0; i < _shard_count; ++i)
+		{
+			const shard& s = _shards[i];
+			shared_spin_lock l(s.lock);
+			for(const auto& kv : s.map)
+			{
+				f(kv.first, kv.second);
+			}
+		}
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	size_t concurrent_hash_map<t_key, t_value, t_hash, t_pred>::size() const
+	{
+		size_t count = 0;
+		for(size_t i = 0; i < _shard_count; ++i)
+		{
+			shared_spin_lock l(_shards[i].lock);
+			count += _shards[i].map.size();
+		}
+		return count;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	bool concurrent_hash_map<t_key, t_value, t_hash, t_pred>::empty() const
+	{
+		return size() == 0;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	void concurrent_hash_map<t_key, t_value, t_hash, t_pred>::clear()
+	{
+		for(size_t i = 0; i < _shard_count; ++i)
+		{
+			unique_spin_lock l(_shards[i].lock);
+			_shards[i].map.clear();
+		}
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	void concurrent_hash_map<t_key, t_value, t_hash, t_pred>::reserve(size_t count)
+	{
+		// assumes keys spread evenly, which the shard selection below ensures for any decent hash
+		const size_t per_shard = count / _shard_count + 1;
+		for(size_t i = 0; i < _shard_count; ++i)
+		{
+			unique_spin_lock l(_shards[i].lock);
+			_shards[i].map.reserve(per_shard);
+		}
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	size_t concurrent_hash_map<t_key, t_value, t_hash, t_pred>::shard_count() const
+	{
+		return _shard_count;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred>
+	typename concurrent_hash_map<t_key, t_value, t_hash, t_pred>::shard& concurrent_hash_map<t_key, t_value, t_hash, t_pred>::_shard(const t_key& key) const
+	{
+		// fibonacci hashing of the top bits: the low bits are used inside the shard, and this stays
+		// balanced even for weak user supplied hashes
+		if(_shard_bits == 0)
+		{
+			return _shards[0];
+		}
+		const uint64 mixed = static_cast<uint64>(_hash(key)) * 0x9E3779B97F4A7C15ULL;
+		return _shards[static_cast<size_t>(mixed >> (64 - _shard_bits))];
+	}
+} // namespace bl
@@ -0,0 +1,933 @@
+#pragma once
+
+// c++20 coroutine types scheduled on bl::thread_pool. the library itself is built as c++11, so everything here is
+// header only and compiled out unless the including translation unit enables coroutines (-std=c++20).
+// gcc lowers every coroutine body to a switch without default: coroutine code needs -Wno-switch-default
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include <bl/util/thread.h>
+#include <bl/util/thread_pool.h>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wswitch-default"
+#endif
+
+namespace bl
+{
+	template<typename t_value = void>
+	class task;
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// promise types
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	class _task_promise_base
+	{
+	public:
+		// resumes the awaiting coroutine by symmetric transfer, so chains of tasks do not grow the stack
+		// (gcc only turns the transfer into a tail call with optimization on and without sanitizers)
+		struct final_awaiter
+		{
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			template<typename t_promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<t_promise> handle) noexcept
+			{
+				return handle.promise().continuation;
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+		};
+
+		std::suspend_always initial_suspend() const noexcept
+		{
+			return {};
+		}
+
+		final_awaiter final_suspend() const noexcept
+		{
+			return {};
+		}
+
+		void unhandled_exception() noexcept
+		{
+			error = std::current_exception();
+		}
+
+		std::coroutine_handle<> continuation = std::noop_coroutine();
+		std::exception_ptr error;
+	};
+
+	template<typename t_value>
+	class _task_promise : public _task_promise_base
+	{
+	public:
+		task<t_value> get_return_object() noexcept;
+
+		template<typename t_arg>
+		void return_value(t_arg&& value)
+		{
+			result.emplace(std::forward<t_arg>(value));
+		}
+
+		t_value take()
+		{
+			if(error)
+			{
+				std::rethrow_exception(error);
+			}
+			return std::move(*result);
+		}
+
+		std::optional<t_value> result;
+	};
+
+	template<>
+	class _task_promise<void> : public _task_promise_base
+	{
+	public:
+		task<void> get_return_object() noexcept;
+
+		void return_void() const noexcept
+		{
+		}
+
+		void take()
+		{
+			if(error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	};
+
+	// coroutine that starts eagerly and frees itself when done, used to drive tasks from non coroutine code
+	class _detached_task
+	{
+	public:
+		struct promise_type
+		{
+			_detached_task get_return_object() const noexcept
+			{
+				return {};
+			}
+
+			std::suspend_never initial_suspend() const noexcept
+			{
+				return {};
+			}
+
+			std::suspend_never final_suspend() const noexcept
+			{
+				return {};
+			}
+
+			void return_void() const noexcept
+			{
+			}
+
+			void unhandled_exception() const noexcept
+			{
+				std::terminate();
+			}
+		};
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// task
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// lazy coroutine producing one t_value: the body starts when the task is awaited and resumes the awaiting coroutine
+	// when it finishes. exceptions propagate to the awaiter. move only, destroying the task destroys the coroutine
+	template<typename t_value>
+	class task
+	{
+	public:
+		typedef _task_promise<t_value> promise_type;
+		typedef std::coroutine_handle<promise_type> handle_type;
+
+		task() noexcept;
+		task(task&& other) noexcept;
+		task& operator=(task&& other) noexcept;
+		~task();
+
+		task(const task&) = delete;
+		task& operator=(const task&) = delete;
+
+		bool valid() const noexcept;
+		bool done() const noexcept;
+
+		auto operator co_await() && noexcept;
+
+	private:
+		friend class _task_promise<t_value>;
+
+		template<typename t_other>
+		friend t_other sync_wait(task<t_other> t);
+
+		// resumes the awaiting coroutine when the task finished, without taking its result
+		struct ready_awaiter
+		{
+			bool await_ready() const noexcept;
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+			void await_resume() const noexcept;
+
+			handle_type handle;
+		};
+
+		struct result_awaiter : public ready_awaiter
+		{
+			t_value await_resume();
+		};
+
+		explicit task(handle_type handle) noexcept;
+
+		handle_type _handle;
+	};
+
+	// runs t on the calling thread until its first suspension and blocks until it finished, returns its result
+	template<typename t_value>
+	t_value sync_wait(task<t_value> t);
+
+	// runs t on pool without waiting for it, an exception escaping t terminates the program
+	void spawn(thread_pool& pool, task<void> t);
+	void spawn(task<void> t);
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// awaitables
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// co_await resume_on(pool) continues the coroutine on a worker of pool
+	class _pool_awaiter : public thread_pool::task
+	{
+	public:
+		explicit _pool_awaiter(thread_pool& pool) noexcept;
+
+		bool await_ready() const noexcept;
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept;
+
+		void run() override;
+
+	private:
+		thread_pool& _pool;
+		std::coroutine_handle<> _handle;
+	};
+
+	_pool_awaiter resume_on(thread_pool& pool);
+
+	// single thread holding the pending timed resumptions, due tasks are pushed to their pool.
+	// tasks still pending at program exit are never resumed
+	class _coroutine_timer
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		static _coroutine_timer& instance();
+
+		_coroutine_timer();
+		~_coroutine_timer();
+
+		_coroutine_timer(const _coroutine_timer&) = delete;
+		_coroutine_timer& operator=(const _coroutine_timer&) = delete;
+
+		void add(clock::time_point at, thread_pool& pool, thread_pool::task& t);
+
+	private:
+		struct entry
+		{
+			clock::time_point at;
+			uint64 sequence; // keeps equal deadlines in insertion order
+			thread_pool* pool;
+			thread_pool::task* t;
+
+			bool operator>(const entry& other) const;
+		};
+
+		void _run();
+
+		mutex _mutex;
+		condition_variable _condition;
+		std::priority_queue<entry, std::vector<entry>, std::greater<entry>> _entries;
+		uint64 _sequence;
+		bool _quit;
+		thread _thread;
+	};
+
+	// co_await resume_after(duration, pool) continues the coroutine on pool once duration elapsed, no thread waits meanwhile
+	class _timer_awaiter : public thread_pool::task
+	{
+	public:
+		_timer_awaiter(_coroutine_timer::clock::time_point at, thread_pool& pool) noexcept;
+
+		bool await_ready() const noexcept;
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept;
+
+		void run() override;
+
+	private:
+		_coroutine_timer::clock::time_point _at;
+		thread_pool& _pool;
+		std::coroutine_handle<> _handle;
+	};
+
+	template<typename t_rep, typename t_period>
+	_timer_awaiter resume_after(std::chrono::duration<t_rep, t_period> duration, thread_pool& pool = thread_pool::global());
+
+	// co_await on the lock-free queues (spsc_ring_buffer, mpmc_queue or anything with try_push / try_pop and
+	// park_push / park_pop): completes at once when possible, otherwise the coroutine parks on the queue and the next
+	// push / pop resumes it on the pool, so a coroutine waiting on a queue holds no thread
+	template<typename t_queue, bool t_pop>
+	class _queue_awaiter : public thread_pool::task, public spin_waiter::parked
+	{
+	public:
+		typedef typename t_queue::value_type value_type;
+
+		_queue_awaiter(t_queue& queue, thread_pool& pool) noexcept;
+		_queue_awaiter(t_queue& queue, thread_pool& pool, value_type&& value);
+
+		bool await_ready();
+		bool await_suspend(std::coroutine_handle<> handle);
+		auto await_resume();
+
+		void run() override;
+		void wake() override;
+
+	private:
+		bool _try();
+
+		// true once the operation went through, false once parked
+		bool _try_or_park();
+
+		t_queue& _queue;
+		thread_pool& _pool;
+		std::coroutine_handle<> _handle;
+		value_type _value;
+	};
+
+	// value_type v = co_await async_pop(queue)
+	template<typename t_queue>
+	_queue_awaiter<t_queue, true> async_pop(t_queue& queue, thread_pool& pool = thread_pool::global());
+
+	// co_await async_push(queue, value)
+	template<typename t_queue, typename t_value>
+	_queue_awaiter<t_queue, false> async_push(t_queue& queue, t_value&& value, thread_pool& pool = thread_pool::global());
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// generator
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// synchronous lazy sequence: each step of the range for loop resumes the coroutine up to its next co_yield
+	template<typename t_value>
+	class generator
+	{
+	public:
+		struct promise_type
+		{
+			generator get_return_object() noexcept;
+			std::suspend_always initial_suspend() const noexcept;
+			std::suspend_always final_suspend() const noexcept;
+			std::suspend_always yield_value(const t_value& value) noexcept;
+			void return_void() const noexcept;
+			void unhandled_exception() noexcept;
+
+			// co_await is not allowed inside a generator
+			template<typename t_other>
+			std::suspend_never await_transform(t_other&&) = delete;
+
+			const t_value* current = nullptr;
+			std::exception_ptr error;
+		};
+
+		typedef std::coroutine_handle<promise_type> handle_type;
+
+		class iterator
+		{
+		public:
+			typedef std::input_iterator_tag iterator_category;
+			typedef std::ptrdiff_t difference_type;
+			typedef t_value value_type;
+			typedef const t_value& reference;
+			typedef const t_value* pointer;
+
+			iterator() noexcept;
+			explicit iterator(handle_type handle) noexcept;
+
+			reference operator*() const noexcept;
+			pointer operator->() const noexcept;
+			iterator& operator++();
+			void operator++(int);
+
+			bool operator==(std::default_sentinel_t) const noexcept;
+
+		private:
+			handle_type _handle;
+		};
+
+		generator() noexcept;
+		generator(generator&& other) noexcept;
+		generator& operator=(generator&& other) noexcept;
+		~generator();
+
+		generator(const generator&) = delete;
+		generator& operator=(const generator&) = delete;
+
+		iterator begin();
+		std::default_sentinel_t end() const noexcept;
+
+	private:
+		explicit generator(handle_type handle) noexcept;
+
+		static void _advance(handle_type handle);
+
+		handle_type _handle;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	task<t_value> _task_promise<t_value>::get_return_object() noexcept
+	{
+		return task<t_value>(task<t_value>::handle_type::from_promise(*this));
+	}
+
+	inline task<void> _task_promise<void>::get_return_object() noexcept
+	{
+		return task<void>(task<void>::handle_type::from_promise(*this));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	task<t_value>::task() noexcept
+		: _handle(nullptr)
+	{
+	}
+
+	template<typename t_value>
+	task<t_value>::task(handle_type handle) noexcept
+		: _handle(handle)
+	{
+	}
+
+	template<typename t_value>
+	task<t_value>::task(task&& other) noexcept
+		: _handle(std::exchange(other._handle, nullptr))
+	{
+	}
+
+	template<typename t_value>
+	task<t_value>& task<t_value>::operator=(task&& other) noexcept
+	{
+		if(this != &other)
+		{
+			if(_handle)
+			{
+				_handle.destroy();
+			}
+			_handle = std::exchange(other._handle, nullptr);
+		}
+		return *this;
+	}
+
+	template<typename t_value>
+	task<t_value>::~task()
+	{
+		if(_handle)
+		{
+			_handle.destroy();
+		}
+	}
+
+	template<typename t_value>
+	bool task<t_value>::valid() const noexcept
+	{
+		return static_cast<bool>(_handle);
+	}
+
+	template<typename t_value>
+	bool task<t_value>::done() const noexcept
+	{
+		return _handle && _handle.done();
+	}
+
+	template<typename t_value>
+	auto task<t_value>::operator co_await() && noexcept
+	{
+		return result_awaiter{{_handle}};
+	}
+
+	template<typename t_value>
+	bool task<t_value>::ready_awaiter::await_ready() const noexcept
+	{
+		return handle.done();
+	}
+
+	template<typename t_value>
+	std::coroutine_handle<> task<t_value>::ready_awaiter::await_suspend(std::coroutine_handle<> awaiting) noexcept
+	{
+		handle.promise().continuation = awaiting;
+		return handle;
+	}
+
+	template<typename t_value>
+	void task<t_value>::ready_awaiter::await_resume() const noexcept
+	{
+	}
+
+	template<typename t_value>
+	t_value task<t_value>::result_awaiter::await_resume()
+	{
+		return this->handle.promise().take();
+	}
+
+	template<typename t_value>
+	t_value sync_wait(task<t_value> t)
+	{
+		struct state
+		{
+			mutex m;
+			condition_variable condition;
+			bool done = false;
+		} s;
+
+		// notifies under the lock, so s outlives the notifier
+		[](typename task<t_value>::ready_awaiter ready, state& waiting) -> _detached_task
+		{
+			co_await ready;
+			mutex_lock l(waiting.m);
+			waiting.done = true;
+			waiting.condition.notify_one();
+		}(typename task<t_value>::ready_awaiter{t._handle}, s);
+
+		unique_mutex_lock l(s.m);
+		while(!s.done)
+		{
+			s.condition.wait(l);
+		}
+		return t._handle.promise().take();
+	}
+
+	inline void spawn(thread_pool& pool, task<void> t)
+	{
+		[](thread_pool& p, task<void> spawned) -> _detached_task
+		{
+			co_await resume_on(p);
+			co_await std::move(spawned);
+		}(pool, std::move(t));
+	}
+
+	inline void spawn(task<void> t)
+	{
+		spawn(thread_pool::global(), std::move(t));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline _pool_awaiter::_pool_awaiter(thread_pool& pool) noexcept
+		: _pool(pool)
+	{
+	}
+
+	inline bool _pool_awaiter::await_ready() const noexcept
+	{
+		return false;
+	}
+
+	inline void _pool_awaiter::await_suspend(std::coroutine_handle<> handle)
+	{
+		// a worker may resume the coroutine, and so destroy this awaiter, before push returns
+		_handle = handle;
+		_pool.push(*this);
+	}
+
+	inline void _pool_awaiter::await_resume() const noexcept
+	{
+	}
+
+	inline void _pool_awaiter::run()
+	{
+		_handle.resume();
+	}
+
+	inline _pool_awaiter resume_on(thread_pool& pool)
+	{
+		return _pool_awaiter(pool);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline _coroutine_timer& _coroutine_timer::instance()
+	{
+		static _coroutine_timer timer;
+		return timer;
+	}
+
+	inline _coroutine_timer::_coroutine_timer()
+		: _sequence(0), _quit(false)
+	{
+		_thread = thread([this]()
+		{
+			_run();
+		});
+	}
+
+	inline _coroutine_timer::~_coroutine_timer()
+	{
+		{
+			mutex_lock l(_mutex);
+			_quit = true;
+		}
+		_condition.notify_one();
+		_thread.join();
+	}
+
+	inline void _coroutine_timer::add(clock::time_point at, thread_pool& pool, thread_pool::task& t)
+	{
+		bool earliest;
+		{
+			mutex_lock l(_mutex);
+			earliest = _entries.empty() || at < _entries.top().at;
+			_entries.push(entry{at, _sequence++, &pool, &t});
+		}
+		if(earliest)
+		{
+			_condition.notify_one();
+		}
+	}
+
+	inline bool _coroutine_timer::entry::operator>(const entry& other) const
+	{
+		return at != other.at ? at > other.at : sequence > other.sequence;
+	}
+
+	inline void _coroutine_timer::_run()
+	{
+		unique_mutex_lock l(_mutex);
+		while(!_quit)
+		{
+			if(_entries.empty())
+			{
+				_condition.wait(l);
+				continue;
+			}
+
+			const entry next = _entries.top();
+			if(clock::now() < next.at)
+			{
+				_condition.wait_until(l, next.at);
+				continue;
+			}
+
+			_entries.pop();
+			l.unlock();
+			next.pool->push(*next.t);
+			l.lock();
+		}
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline _timer_awaiter::_timer_awaiter(_coroutine_timer::clock::time_point at, thread_pool& pool) noexcept
+		: _at(at), _pool(pool)
+	{
+	}
+
+	inline bool _timer_awaiter::await_ready() const noexcept
+	{
+		return _coroutine_timer::clock::now() >= _at;
+	}
+
+	inline void _timer_awaiter::await_suspend(std::coroutine_handle<> handle)
+	{
+		_handle = handle;
+		_coroutine_timer::instance().add(_at, _pool, *this);
+	}
+
+	inline void _timer_awaiter::await_resume() const noexcept
+	{
+	}
+
+	inline void _timer_awaiter::run()
+	{
+		_handle.resume();
+	}
+
+	template<typename t_rep, typename t_period>
+	_timer_awaiter resume_after(std::chrono::duration<t_rep, t_period> duration, thread_pool& pool)
+	{
+		return _timer_awaiter(_coroutine_timer::clock::now() + std::chrono::duration_cast<_coroutine_timer::clock::duration>(duration), pool);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_queue, bool t_pop>
+	_queue_awaiter<t_queue, t_pop>::_queue_awaiter(t_queue& queue, thread_pool& pool) noexcept
+		: _queue(queue), _pool(pool), _value()
+	{
+	}
+
+	template<typename t_queue, bool t_pop>
+	_queue_awaiter<t_queue, t_pop>::_queue_awaiter(t_queue& queue, thread_pool& pool, value_type&& value)
+		: _queue(queue), _pool(pool), _value(std::move(value))
+	{
+	}
+
+	template<typename t_queue, bool t_pop>
+	bool _queue_awaiter<t_queue, t_pop>::await_ready()
+	{
+		return _try();
+	}
+
+	template<typename t_queue, bool t_pop>
+	bool _queue_awaiter<t_queue, t_pop>::await_suspend(std::coroutine_handle<> handle)
+	{
+		_handle = handle;
+		return !_try_or_park();
+	}
+
+	template<typename t_queue, bool t_pop>
+	auto _queue_awaiter<t_queue, t_pop>::await_resume()
+	{
+		if constexpr(t_pop)
+		{
+			return std::move(_value);
+		}
+	}
+
+	template<typename t_queue, bool t_pop>
+	void _queue_awaiter<t_queue, t_pop>::run()
+	{
+		if(_try_or_park())
+		{
+			_handle.resume();
+		}
+	}
+
+	template<typename t_queue, bool t_pop>
+	void _queue_awaiter<t_queue, t_pop>::wake()
+	{
+		_pool.push(*this);
+	}
+
+	template<typename t_queue, bool t_pop>
+	bool _queue_awaiter<t_queue, t_pop>::_try()
+	{
+		if constexpr(t_pop)
+		{
+			return _queue.try_pop(_value);
+		}
+		else
+		{
+			return _queue.try_push(std::move(_value));
+		}
+	}
+
+	template<typename t_queue, bool t_pop>
+	bool _queue_awaiter<t_queue, t_pop>::_try_or_park()
+	{
+		// a failed park means the queue changed meanwhile, but another thread may take the slot before our retry
+		while(!_try())
+		{
+			if constexpr(t_pop)
+			{
+				if(_queue.park_pop(*this))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if(_queue.park_push(*this))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template<typename t_queue>
+	_queue_awaiter<t_queue, true> async_pop(t_queue& queue, thread_pool& pool)
+	{
+		return _queue_awaiter<t_queue, true>(queue, pool);
+	}
+
+	template<typename t_queue, typename t_value>
+	_queue_awaiter<t_queue, false> async_push(t_queue& queue, t_value&& value, thread_pool& pool)
+	{
+		return _queue_awaiter<t_queue, false>(queue, pool, typename t_queue::value_type(std::forward<t_value>(value)));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	generator<t_value> generator<t_value>::promise_type::get_return_object() noexcept
+	{
+		return generator(handle_type::from_promise(*this));
+	}
+
+	template<typename t_value>
+	std::suspend_always generator<t_value>::promise_type::initial_suspend() const noexcept
+	{
+		return {};
+	}
+
+	template<typename t_value>
+	std::suspend_always generator<t_value>::promise_type::final_suspend() const noexcept
+	{
+		return {};
+	}
+
+	template<typename t_value>
+	std::suspend_always generator<t_value>::promise_type::yield_value(const t_value& value) noexcept
+	{
+		// a yielded temporary lives until the coroutine is resumed
+		current = std::addressof(value);
+		return {};
+	}
+
+	template<typename t_value>
+	void generator<t_value>::promise_type::return_void() const noexcept
+	{
+	}
+
+	template<typename t_value>
+	void generator<t_value>::promise_type::unhandled_exception() noexcept
+	{
+		error = std::current_exception();
+	}
+
+	template<typename t_value>
+	generator<t_value>::iterator::iterator() noexcept
+		: _handle(nullptr)
+	{
+	}
+
+	template<typename t_value>
+	generator<t_value>::iterator::iterator(handle_type handle) noexcept
+		: _handle(handle)
+	{
+	}
+
+	template<typename t_value>
+	typename generator<t_value>::iterator::reference generator<t_value>::iterator::operator*() const noexcept
+	{
+		return *_handle.promise().current;
+	}
+
+	template<typename t_value>
+	typename generator<t_value>::iterator::pointer generator<t_value>::iterator::operator->() const noexcept
+	{
+		return _handle.promise().current;
+	}
+
+	template<typename t_value>
+	typename generator<t_value>::iterator& generator<t_value>::iterator::operator++()
+	{
+		_advance(_handle);
+		return *this;
+	}
+
+	template<typename t_value>
+	void generator<t_value>::iterator::operator++(int)
+	{
+		++*this;
+	}
+
+	template<typename t_value>
+	bool generator<t_value>::iterator::operator==(std::default_sentinel_t) const noexcept
+	{
+		return !_handle || _handle.done();
+	}
+
+	template<typename t_value>
+	generator<t_value>::generator() noexcept
+		: _handle(nullptr)
+	{
+	}
+
+	template<typename t_value>
+	generator<t_value>::generator(handle_type handle) noexcept
+		: _handle(handle)
+	{
+	}
+
+	template<typename t_value>
+	generator<t_value>::generator(generator&& other) noexcept
+		: _handle(std::exchange(other._handle, nullptr))
+	{
+	}
+
+	template<typename t_value>
+	generator<t_value>& generator<t_value>::operator=(generator&& other) noexcept
+	{
+		if(this != &other)
+		{
+			if(_handle)
+			{
+				_handle.destroy();
+			}
+			_handle = std::exchange(other._handle, nullptr);
+		}
+		return *this;
+	}
+
+	template<typename t_value>
+	generator<t_value>::~generator()
+	{
+		if(_handle)
+		{
+			_handle.destroy();
+		}
+	}
+
+	template<typename t_value>
+	typename generator<t_value>::iterator generator<t_value>::begin()
+	{
+		if(_handle)
+		{
+			_advance(_handle);
+		}
+		return iterator(_handle);
+	}
+
+	template<typename t_value>
+	std::default_sentinel_t generator<t_value>::end() const noexcept
+	{
+		return std::default_sentinel;
+	}
+
+	template<typename t_value>
+	void generator<t_value>::_advance(handle_type handle)
+	{
+		handle.resume();
+		if(handle.promise().error)
+		{
+			std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+		}
+	}
+} // namespace bl
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+#include <bl/util/cycle_timer.h>
+
+#if defined(BL_CPU_X86) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+namespace bl
+{
+	typedef std::chrono::steady_clock s_clock;
+
+	static const s_clock::duration s_calibration_time = std::chrono::milliseconds(10);
+
+#if defined(BL_CPU_X86)
+	static bool s_cpuid(uint32 leaf, uint32 regs[4])
+	{
+	#if defined(_MSC_VER)
+		int r[4];
+		__cpuid(r, static_cast<int>(leaf & 0x80000000U));
+		if(static_cast<uint32>(r[0]) < leaf)
+		{
+			return false;
+		}
+		__cpuid(r, static_cast<int>(leaf));
+		for(int i = 0; i < 4; ++i)
+		{
+			regs[i] = static_cast<uint32>(r[i]);
+		}
+		return true;
+	#else
+		return __get_cpuid(leaf, &regs[0], &regs[1], &regs[2], &regs[3]) != 0;
+	#endif
+	}
+
+	// a clock reading and the tsc at that moment, bracketed by two tsc reads and the tightest of a few tries kept
+	static void s_sample(uint64& tsc, s_clock::time_point& time)
+	{
+		uint64 best = ~uint64(0);
+		for(int i = 0; i < 5; ++i)
+		{
+			const uint64 before = __rdtsc();
+			const s_clock::time_point t = s_clock::now();
+			const uint64 after = __rdtsc();
+			if(after - before < best)
+			{
+				best = after - before;
+				tsc = before + (after - before) / 2;
+				time = t;
+			}
+		}
+	}
+#endif
+
+	cycle_timer::calibration cycle_timer::_calibrate()
+	{
+		calibration c;
+		c.tsc = false;
+		c.rdtscp = false;
+		c.ticks_per_ns = 1.0;
+		c.ns_per_tick = 1.0;
+
+	#if defined(BL_CPU_X86)
+		uint32 regs[4];
+		c.tsc = s_cpuid(0x80000007U, regs) && (regs[3] & (1U << 8)) != 0;
+		c.rdtscp = s_cpuid(0x80000001U, regs) && (regs[3] & (1U << 27)) != 0;
+		if(!c.tsc)
+		{
+			return c;
+		}
+
+		uint64 tsc0 = 0, tsc1 = 0;
+		s_clock::time_point t0, t1;
+		s_sample(tsc0, t0);
+		while(s_clock::now() - t0 < s_calibration_time)
+		{
+		}
+		s_sample(tsc1, t1);
+
+		const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+		if(tsc1 > tsc0 && ns > 0)
+		{
+			c.ticks_per_ns = static_cast<double>(tsc1 - tsc0) / ns;
+			c.ns_per_tick = 1.0 / c.ticks_per_ns;
+		}
+		else
+		{
+			c.tsc = false;
+		}
+	#endif
+		return c;
+	}
+
+	// calibrate while the process starts instead of on the first, possibly timed, use
+	static const bool s_calibrated = cycle_timer::invariant_tsc();
+} // namespace bl
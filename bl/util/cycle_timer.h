@@ -0,0 +1,163 @@
+#pragma once
+#include <bl/util/integer.h>
+#include <bl/util/platform.h>
+#include <chrono>
+
+#if defined(BL_CPU_X86)
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#endif
+
+namespace bl
+{
+	// timer on the cpu time stamp counter. reading it is a single instruction, so raw tick snapshots are cheap enough
+	// for hot paths and are only converted to time when reported. the tick rate is calibrated against the steady clock
+	// once at startup. without an invariant tsc (or off x86) ticks are steady clock nanoseconds instead
+	class cycle_timer
+	{
+	public:
+		typedef uint64 ticks;
+
+		cycle_timer();
+		void restart();
+		ticks elapsed_ticks() const;
+		double seconds() const;
+		double milliseconds() const;
+		double microseconds() const;
+		double nanoseconds() const;
+
+		// current tick count, may be reordered with the surrounding instructions
+		static ticks now();
+
+		// current tick count once every preceding instruction completed, later ones do not start before it
+		static ticks now_serialized();
+
+		static double to_seconds(ticks t);
+		static double to_nanoseconds(ticks t);
+		static double ticks_per_nanosecond();
+
+		// the tsc runs at a constant rate across power states and cores and is used for ticks
+		static bool invariant_tsc();
+
+	private:
+		struct calibration
+		{
+			bool tsc;
+			bool rdtscp;
+			double ticks_per_ns;
+			double ns_per_tick;
+		};
+
+		static const calibration& _calibration();
+		static calibration _calibrate();
+		static ticks _steady_ticks();
+
+		ticks _start;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline cycle_timer::cycle_timer()
+		: _start(now())
+	{
+	}
+
+	inline void cycle_timer::restart()
+	{
+		_start = now();
+	}
+
+	inline cycle_timer::ticks cycle_timer::elapsed_ticks() const
+	{
+		return now() - _start;
+	}
+
+	inline double cycle_timer::seconds() const
+	{
+		return to_seconds(elapsed_ticks());
+	}
+
+	inline double cycle_timer::milliseconds() const
+	{
+		return to_nanoseconds(elapsed_ticks()) * 1e-6;
+	}
+
+	inline double cycle_timer::microseconds() const
+	{
+		return to_nanoseconds(elapsed_ticks()) * 1e-3;
+	}
+
+	inline double cycle_timer::nanoseconds() const
+	{
+		return to_nanoseconds(elapsed_ticks());
+	}
+
+	inline const cycle_timer::calibration& cycle_timer::_calibration()
+	{
+		static const calibration c = _calibrate();
+		return c;
+	}
+
+	inline cycle_timer::ticks cycle_timer::_steady_ticks()
+	{
+		return static_cast<ticks>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	inline cycle_timer::ticks cycle_timer::now()
+	{
+	#if defined(BL_CPU_X86)
+		if(_calibration().tsc)
+		{
+			return __rdtsc();
+		}
+	#endif
+		return _steady_ticks();
+	}
+
+	inline cycle_timer::ticks cycle_timer::now_serialized()
+	{
+	#if defined(BL_CPU_X86)
+		const calibration& c = _calibration();
+		if(c.tsc)
+		{
+			ticks t;
+			if(c.rdtscp)
+			{
+				unsigned aux;
+				t = __rdtscp(&aux);
+			}
+			else
+			{
+				_mm_lfence();
+				t = __rdtsc();
+			}
+			_mm_lfence();
+			return t;
+		}
+	#endif
+		return _steady_ticks();
+	}
+
+	inline double cycle_timer::to_seconds(ticks t)
+	{
+		return to_nanoseconds(t) * 1e-9;
+	}
+
+	inline double cycle_timer::to_nanoseconds(ticks t)
+	{
+		return static_cast<double>(t) * _calibration().ns_per_tick;
+	}
+
+	inline double cycle_timer::ticks_per_nanosecond()
+	{
+		return _calibration().ticks_per_ns;
+	}
+
+	inline bool cycle_timer::invariant_tsc()
+	{
+		return _calibration().tsc;
+	}
+} // namespace bl
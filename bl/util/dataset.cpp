@@ -0,0 +1,63 @@
+#include <bl/util/dataset.h>
+#include <bl/util/hash_function.h>
+
+namespace bl
+{
+	bool dataset::key::operator<(const key& other) const
+	{
+		if(dist != other.dist)
+		{
+			return dist < other.dist;
+		}
+		if(type != other.type)
+		{
+			return std::less<const void*>()(type, other.type);
+		}
+		return size < other.size;
+	}
+
+	dataset::dataset(uint64 seed, thread_pool& pool)
+		: _seed(seed), _pool(pool)
+	{
+	}
+
+	void dataset::clear()
+	{
+		mutex_lock l(_mutex);
+		_cache.clear();
+	}
+
+	size_t dataset::entries() const
+	{
+		mutex_lock l(_mutex);
+		return _cache.size();
+	}
+
+	uint64 dataset::_chunk_seed(distribution d, size_t chunk) const
+	{
+		return hash_int(static_cast<uint64>(chunk), hash_int(static_cast<uint64>(d), _seed));
+	}
+
+	const char* dataset::name(distribution d)
+	{
+		switch(d)
+		{
+			case distribution::random:
+				return "random";
+			case distribution::ordered:
+				return "ordered";
+			case distribution::reverse:
+				return "reverse";
+			case distribution::near_disorder:
+				return "near disorder";
+			case distribution::far_disorder:
+				return "far disorder";
+			case distribution::duplicates:
+				return "random duplicate";
+			case distribution::contiguous:
+				return "contiguous";
+			default:
+				return "unknown";
+		}
+	}
+} // namespace bl
@@ -0,0 +1,222 @@
+#pragma once
+#include <bl/util/any.h>
+#include <bl/util/integer.h>
+#include <bl/util/random.h>
+#include <bl/util/thread.h>
+#include <bl/util/thread_pool.h>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+namespace bl
+{
+	// input patterns of the sort benchmarks
+	enum class distribution
+	{
+		random,        // uniform in [0, size]
+		ordered,       // 0, 1, 2, ...
+		reverse,       // size, size - 1, ...
+		near_disorder, // ordered, then 5 passes swapping neighbors with probability 0.1
+		far_disorder,  // ordered with 10% of the values replaced by random ones
+		duplicates,    // uniform in [0, size / 100]
+		contiguous     // alternating ordered and random runs of size / 100 + 2 values
+	};
+
+	// benchmark inputs generated on first use and cached per (distribution, type, size). generation runs on a thread
+	// pool in fixed chunks, each with its own engine seeded from (seed, distribution, chunk), so the data only depends
+	// on the seed, never on the number of threads
+	class dataset
+	{
+	public:
+		static const size_t chunk_size = 65536;
+		static const size_t distribution_count = 7;
+
+		explicit dataset(uint64 seed = 13, thread_pool& pool = thread_pool::global());
+
+		dataset(const dataset&) = delete;
+		dataset& operator=(const dataset&) = delete;
+
+		// stays valid until clear()
+		template<typename t_value>
+		const std::vector<t_value>& get(distribution d, size_t size);
+
+		// copies the cached values into scratch, which is grown as needed, for algorithms working in place
+		template<typename t_value>
+		t_value* copy(distribution d, size_t size, std::vector<t_value>& scratch);
+
+		void clear();
+		size_t entries() const;
+
+		static const char* name(distribution d);
+
+	private:
+		template<typename t_value>
+		struct type_tag
+		{
+			static const char tag;
+		};
+
+		struct key
+		{
+			distribution dist;
+			const void* type;
+			size_t size;
+
+			bool operator<(const key& other) const;
+		};
+
+		// engine seed of one chunk of a distribution
+		uint64 _chunk_seed(distribution d, size_t chunk) const;
+
+		template<typename t_value>
+		void _generate(distribution d, t_value* values, size_t size, size_t chunk);
+
+		// integers in [0, max], reals in [0, max). the std distributions are implementation defined, these give the
+		// same data with every standard library
+		template<typename t_value>
+		static typename std::enable_if<std::is_integral<t_value>::value, t_value>::type _uniform(xoshiro256ss& engine, t_value max);
+
+		template<typename t_value>
+		static typename std::enable_if<!std::is_integral<t_value>::value, t_value>::type _uniform(xoshiro256ss& engine, t_value max);
+
+		uint64 _seed;
+		thread_pool& _pool;
+		mutable mutex _mutex;
+		std::map<key, any> _cache;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	const char dataset::type_tag<t_value>::tag = 0;
+
+	template<typename t_value>
+	const std::vector<t_value>& dataset::get(distribution d, size_t size)
+	{
+		const key k = {d, &type_tag<t_value>::tag, size};
+		{
+			mutex_lock l(_mutex);
+			auto it = _cache.find(k);
+			if(it != _cache.end())
+			{
+				return it->second.get<std::vector<t_value>>();
+			}
+		}
+
+		// generate without holding the lock, the pool may run other tasks on this thread while it waits and those can call get too
+		std::vector<t_value> values(size);
+		t_value* data = values.data();
+		_pool.parallel_for(0, (size + chunk_size - 1) / chunk_size, 1, [this, d, data, size](size_t first, size_t last)
+		{
+			for(size_t chunk = first; chunk < last; ++chunk)
+			{
+				_generate(d, data, size, chunk);
+			}
+		});
+
+		// a concurrent call may have inserted the same entry meanwhile, insert keeps it and our copy is dropped
+		mutex_lock l(_mutex);
+		auto it = _cache.insert(std::make_pair(k, any(std::move(values)))).first;
+		return it->second.get<std::vector<t_value>>();
+	}
+
+	template<typename t_value>
+	t_value* dataset::copy(distribution d, size_t size, std::vector<t_value>& scratch)
+	{
+		const std::vector<t_value>& values = get<t_value>(d, size);
+		if(scratch.size() < size)
+		{
+			scratch.resize(size);
+		}
+		std::copy(values.begin(), values.end(), scratch.begin());
+		return scratch.data();
+	}
+
+	template<typename t_value>
+	void dataset::_generate(distribution d, t_value* values, size_t size, size_t chunk)
+	{
+		const size_t first = chunk * chunk_size;
+		const size_t last = std::min(first + chunk_size, size);
+		xoshiro256ss engine(_chunk_seed(d, chunk));
+		const t_value max = static_cast<t_value>(size);
+		const t_value max_duplicate = static_cast<t_value>(size / 100);
+
+		switch(d)
+		{
+			case distribution::random:
+				for(size_t i = first; i < last; ++i)
+				{
+					values[i] = _uniform(engine, max);
+				}
+				break;
+			case distribution::ordered:
+				for(size_t i = first; i < last; ++i)
+				{
+					values[i] = static_cast<t_value>(i);
+				}
+				break;
+			case distribution::reverse:
+				for(size_t i = first; i < last; ++i)
+				{
+					values[i] = static_cast<t_value>(size - i);
+				}
+				break;
+			case distribution::near_disorder:
+				// swaps stay inside the chunk so chunks are independent
+				for(size_t i = first; i < last; ++i)
+				{
+					values[i] = static_cast<t_value>(i);
+				}
+				for(int pass = 0; pass < 5; ++pass)
+				{
+					for(size_t i = first + 1; i < last; ++i)
+					{
+						if(unit_double(engine()) < 0.1)
+						{
+							std::swap(values[i], values[i - 1]);
+						}
+					}
+				}
+				break;
+			case distribution::far_disorder:
+				for(size_t i = first; i < last; ++i)
+				{
+					values[i] = unit_double(engine()) < 0.1 ? _uniform(engine, max) : static_cast<t_value>(i);
+				}
+				break;
+			case distribution::duplicates:
+				for(size_t i = first; i < last; ++i)
+				{
+					values[i] = _uniform(engine, max_duplicate);
+				}
+				break;
+			case distribution::contiguous:
+			{
+				// run r covers [r * run, (r + 1) * run), the even ones continue counting where the previous even one stopped
+				const size_t run = size / 100 + 2;
+				for(size_t i = first; i < last; ++i)
+				{
+					const size_t r = i / run;
+					values[i] = r % 2 == 0 ? static_cast<t_value>(r / 2 * run + i % run) : _uniform(engine, max);
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	template<typename t_value>
+	typename std::enable_if<std::is_integral<t_value>::value, t_value>::type dataset::_uniform(xoshiro256ss& engine, t_value max)
+	{
+		return static_cast<t_value>(bounded_random(engine, static_cast<uint64>(max) + 1));
+	}
+
+	template<typename t_value>
+	typename std::enable_if<!std::is_integral<t_value>::value, t_value>::type dataset::_uniform(xoshiro256ss& engine, t_value max)
+	{
+		return static_cast<t_value>(unit_double(engine()) * max);
+	}
+} // namespace bl
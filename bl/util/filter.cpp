@@ -0,0 +1,440 @@
+#include <bl/util/filter.h>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BL_FILTER_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BL_FILTER_SSE2
+#endif
+
+namespace bl
+{
+	static const uint32 s_bloom_magic = 0x46424c42;  // "BLBF"
+	static const uint32 s_cuckoo_magic = 0x46434c42; // "BLCF"
+	static const uint32 s_version = 1;
+
+	static const uint32 s_salt[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+	// fixed size header shared by both filters
+	struct filter_header
+	{
+		uint32 magic;
+		uint32 version;
+		uint64 seed;
+		uint64 count;  // blocks or buckets
+		uint64 size;   // keys, cuckoo only
+		uint64 victim; // index << 16 | fingerprint, 0 if none
+	};
+
+	static void write_filter(std::vector<uint8>& out, const filter_header& header, const void* payload, size_t payload_bytes)
+	{
+		out.assign(sizeof(header) + payload_bytes, 0);
+		std::memcpy(out.data(), &header, sizeof(header));
+		std::memcpy(out.data() + sizeof(header), payload, payload_bytes);
+	}
+
+	static bool read_filter_header(const void* data, size_t size, uint32 magic, filter_header& header)
+	{
+		if(data == nullptr || size < sizeof(header))
+		{
+			return false;
+		}
+		std::memcpy(&header, data, sizeof(header));
+		return header.magic == magic && header.version == s_version;
+	}
+
+	template<typename t_value>
+	static unique_ptr<t_value, aligned_deleter> allocate_zeroed(size_t count)
+	{
+		const size_t bytes = count * sizeof(t_value);
+		void* ptr = aligned_malloc(bytes > 0 ? bytes : 1, 64);
+		if(ptr == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		std::memset(ptr, 0, bytes);
+		return unique_ptr<t_value, aligned_deleter>(static_cast<t_value*>(ptr));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// bloom_filter
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	bloom_filter::bloom_filter()
+		: _blocks(0), _seed(0)
+	{
+		reset(0);
+	}
+
+	bloom_filter::bloom_filter(size_t expected_keys, double false_positive_rate, uint64 seed)
+		: _blocks(0), _seed(0)
+	{
+		reset(expected_keys, false_positive_rate, seed);
+	}
+
+	void bloom_filter::reset(size_t expected_keys, double false_positive_rate, uint64 seed)
+	{
+		// written so that nan fails too
+		if(!(false_positive_rate > 0.0 && false_positive_rate < 1.0))
+		{
+			throw std::invalid_argument("bloom_filter: false_positive_rate must be in (0, 1)");
+		}
+
+		// blocked filters need about 20% more bits than a classic bloom filter for the same rate
+		const double bits_per_key = -std::log2(false_positive_rate) * 1.44 * 1.2;
+		const double bits = static_cast<double>(expected_keys > 0 ? expected_keys : 1) * bits_per_key;
+		_blocks = static_cast<size_t>(std::ceil(bits / (block_bytes * 8)));
+		_blocks = _blocks > 0 ? _blocks : 1;
+		_words = allocate_zeroed<uint32>(_blocks * block_words);
+		_seed = seed;
+	}
+
+	void bloom_filter::clear()
+	{
+		std::memset(_words.get(), 0, size_bytes());
+	}
+
+	void bloom_filter::insert_hash(uint64 h)
+	{
+		uint32* block = _block(h);
+		const uint32 x = static_cast<uint32>(h);
+	#if defined(BL_FILTER_AVX2)
+		const __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(x)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s_salt))), 27);
+		const __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+		__m256i* b = reinterpret_cast<__m256i*>(block);
+		_mm256_store_si256(b, _mm256_or_si256(_mm256_load_si256(b), mask));
+	#else
+		for(size_t i = 0; i < block_words; ++i)
+		{
+			block[i] |= 1u << ((x * s_salt[i]) >> 27);
+		}
+	#endif
+	}
+
+	bool bloom_filter::contains_hash(uint64 h) const
+	{
+		const uint32* block = _block(h);
+		const uint32 x = static_cast<uint32>(h);
+	#if defined(BL_FILTER_AVX2)
+		const __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(x)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s_salt))), 27);
+		const __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+		return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block)), mask) != 0;
+	#else
+		uint32 missing = 0;
+		for(size_t i = 0; i < block_words; ++i)
+		{
+			missing |= ~block[i] & (1u << ((x * s_salt[i]) >> 27));
+		}
+		return missing == 0;
+	#endif
+	}
+
+	void bloom_filter::contains_hash(const uint64* hashes, size_t count, bool* out) const
+	{
+		static const size_t prefetch_distance = 8;
+		for(size_t i = 0; i < count; ++i)
+		{
+			if(i + prefetch_distance < count)
+			{
+				__builtin_prefetch(_block(hashes[i + prefetch_distance]));
+			}
+			out[i] = contains_hash(hashes[i]);
+		}
+	}
+
+	size_t bloom_filter::block_count() const
+	{
+		return _blocks;
+	}
+
+	size_t bloom_filter::size_bytes() const
+	{
+		return _blocks * block_bytes;
+	}
+
+	uint64 bloom_filter::seed() const
+	{
+		return _seed;
+	}
+
+	void bloom_filter::serialize(std::vector<uint8>& out) const
+	{
+		filter_header header = {s_bloom_magic, s_version, _seed, _blocks, 0, 0};
+		write_filter(out, header, _words.get(), size_bytes());
+	}
+
+	bool bloom_filter::deserialize(const std::vector<uint8>& in)
+	{
+		return deserialize(in.data(), in.size());
+	}
+
+	bool bloom_filter::deserialize(const void* data, size_t size)
+	{
+		filter_header header;
+		// count is compared by division so a huge value cannot wrap the size check
+		if(!read_filter_header(data, size, s_bloom_magic, header) || header.count == 0 || (size - sizeof(header)) % block_bytes != 0 ||
+		   header.count != (size - sizeof(header)) / block_bytes)
+		{
+			return false;
+		}
+		_blocks = static_cast<size_t>(header.count);
+		_seed = header.seed;
+		_words = allocate_zeroed<uint32>(_blocks * block_words);
+		std::memcpy(_words.get(), static_cast<const uint8*>(data) + sizeof(header), size_bytes());
+		return true;
+	}
+
+	uint32* bloom_filter::_block(uint64 h) const
+	{
+		// upper bits pick the block (multiply-shift range reduction), lower bits pick the lanes
+		const size_t index = static_cast<size_t>(((h >> 32) * _blocks) >> 32);
+		return _words.get() + index * block_words;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// cuckoo_filter
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	cuckoo_filter::cuckoo_filter()
+		: _buckets(0), _size(0), _seed(0), _rng(0x9E3779B97F4A7C15ULL), _has_victim(false), _victim_index(0), _victim_fp(0)
+	{
+		reset(0);
+	}
+
+	cuckoo_filter::cuckoo_filter(size_t capacity, uint64 seed)
+		: cuckoo_filter()
+	{
+		reset(capacity, seed);
+	}
+
+	void cuckoo_filter::reset(size_t capacity, uint64 seed)
+	{
+		// 95% is the practical load limit with 4 slots per bucket
+		const size_t needed = static_cast<size_t>(std::ceil(static_cast<double>(capacity) / (bucket_slots * 0.95)));
+		_buckets = 1;
+		while(_buckets < needed)
+		{
+			_buckets *= 2;
+		}
+		_slots = allocate_zeroed<uint16>(_buckets * bucket_slots);
+		_size = 0;
+		_seed = seed;
+		_has_victim = false;
+	}
+
+	void cuckoo_filter::clear()
+	{
+		std::memset(_slots.get(), 0, size_bytes());
+		_size = 0;
+		_has_victim = false;
+	}
+
+	bool cuckoo_filter::insert_hash(uint64 h)
+	{
+		if(_has_victim)
+		{
+			return false;
+		}
+
+		const uint16 fp = _fingerprint(h);
+		size_t index = static_cast<size_t>(h) & (_buckets - 1);
+		if(_insert_into(index, fp) || _insert_into(_alt_index(index, fp), fp))
+		{
+			++_size;
+			return true;
+		}
+
+		// both buckets full: evict a random resident and move it to its other bucket
+		index = (_rng & 1) ? index : _alt_index(index, fp);
+		uint16 current = fp;
+		for(int kick = 0; kick < max_kicks; ++kick)
+		{
+			_rng ^= _rng << 13;
+			_rng ^= _rng >> 7;
+			_rng ^= _rng << 17;
+			uint16& slot = _slots.get()[index * bucket_slots + (_rng & (bucket_slots - 1))];
+			const uint16 evicted = slot;
+			slot = current;
+			current = evicted;
+			index = _alt_index(index, current);
+			if(_insert_into(index, current))
+			{
+				++_size;
+				return true;
+			}
+		}
+
+		// keep the homeless fingerprint so no inserted key is ever lost
+		_has_victim = true;
+		_victim_index = index;
+		_victim_fp = current;
+		++_size;
+		return false;
+	}
+
+	bool cuckoo_filter::contains_hash(uint64 h) const
+	{
+		const uint16 fp = _fingerprint(h);
+		const size_t i1 = static_cast<size_t>(h) & (_buckets - 1);
+		const size_t i2 = _alt_index(i1, fp);
+		if(_has_victim && _victim_fp == fp && (_victim_index == i1 || _victim_index == i2))
+		{
+			return true;
+		}
+
+		const uint16* b1 = _slots.get() + i1 * bucket_slots;
+		const uint16* b2 = _slots.get() + i2 * bucket_slots;
+	#if defined(BL_FILTER_SSE2)
+		// both buckets in one register, 8 fingerprints compared at once
+		int64 w1;
+		int64 w2;
+		std::memcpy(&w1, b1, sizeof(w1));
+		std::memcpy(&w2, b2, sizeof(w2));
+		const __m128i slots = _mm_set_epi64x(w2, w1);
+		return _mm_movemask_epi8(_mm_cmpeq_epi16(slots, _mm_set1_epi16(static_cast<short>(fp)))) != 0;
+	#else
+		for(size_t i = 0; i < bucket_slots; ++i)
+		{
+			if(b1[i] == fp || b2[i] == fp)
+			{
+				return true;
+			}
+		}
+		return false;
+	#endif
+	}
+
+	bool cuckoo_filter::erase_hash(uint64 h)
+	{
+		const uint16 fp = _fingerprint(h);
+		const size_t i1 = static_cast<size_t>(h) & (_buckets - 1);
+		const size_t i2 = _alt_index(i1, fp);
+
+		if(_has_victim && _victim_fp == fp && (_victim_index == i1 || _victim_index == i2))
+		{
+			_has_victim = false;
+			--_size;
+			return true;
+		}
+
+		if(!_erase_from(i1, fp) && !_erase_from(i2, fp))
+		{
+			return false;
+		}
+		--_size;
+
+		// a slot just freed up, give the victim another chance
+		if(_has_victim)
+		{
+			const size_t index = _victim_index;
+			_has_victim = !_insert_into(index, _victim_fp) && !_insert_into(_alt_index(index, _victim_fp), _victim_fp);
+		}
+		return true;
+	}
+
+	size_t cuckoo_filter::size() const
+	{
+		return _size;
+	}
+
+	size_t cuckoo_filter::capacity() const
+	{
+		return _buckets * bucket_slots;
+	}
+
+	size_t cuckoo_filter::size_bytes() const
+	{
+		return _buckets * bucket_slots * sizeof(uint16);
+	}
+
+	uint64 cuckoo_filter::seed() const
+	{
+		return _seed;
+	}
+
+	void cuckoo_filter::serialize(std::vector<uint8>& out) const
+	{
+		const uint64 victim = _has_victim ? ((static_cast<uint64>(_victim_index) << 16) | _victim_fp) : 0;
+		filter_header header = {s_cuckoo_magic, s_version, _seed, _buckets, _size, victim};
+		write_filter(out, header, _slots.get(), size_bytes());
+	}
+
+	bool cuckoo_filter::deserialize(const std::vector<uint8>& in)
+	{
+		return deserialize(in.data(), in.size());
+	}
+
+	bool cuckoo_filter::deserialize(const void* data, size_t size)
+	{
+		filter_header header;
+		const size_t bucket_bytes = bucket_slots * sizeof(uint16);
+		if(!read_filter_header(data, size, s_cuckoo_magic, header) || header.count == 0 || (header.count & (header.count - 1)) != 0 ||
+		   (size - sizeof(header)) % bucket_bytes != 0 || header.count != (size - sizeof(header)) / bucket_bytes)
+		{
+			return false;
+		}
+
+		// a victim is indexed into the buckets by later inserts and erases, and its fingerprint cannot be 0 (empty)
+		if(header.victim != 0 && ((header.victim >> 16) >= header.count || static_cast<uint16>(header.victim) == 0))
+		{
+			return false;
+		}
+		_buckets = static_cast<size_t>(header.count);
+		_size = static_cast<size_t>(header.size);
+		_seed = header.seed;
+		_has_victim = header.victim != 0;
+		_victim_index = static_cast<size_t>(header.victim >> 16);
+		_victim_fp = static_cast<uint16>(header.victim);
+		_slots = allocate_zeroed<uint16>(_buckets * bucket_slots);
+		std::memcpy(_slots.get(), static_cast<const uint8*>(data) + sizeof(header), size_bytes());
+		return true;
+	}
+
+	uint16 cuckoo_filter::_fingerprint(uint64 h)
+	{
+		// 0 marks an empty slot
+		const uint16 fp = static_cast<uint16>(h >> 48);
+		return fp != 0 ? fp : 1;
+	}
+
+	size_t cuckoo_filter::_alt_index(size_t index, uint16 fp) const
+	{
+		// partial-key cuckoo hashing: an involution, so the original bucket is recovered the same way
+		return (index ^ static_cast<size_t>(fp * 0x5bd1e995U)) & (_buckets - 1);
+	}
+
+	bool cuckoo_filter::_insert_into(size_t index, uint16 fp)
+	{
+		uint16* bucket = _slots.get() + index * bucket_slots;
+		for(size_t i = 0; i < bucket_slots; ++i)
+		{
+			if(bucket[i] == 0)
+			{
+				bucket[i] = fp;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool cuckoo_filter::_erase_from(size_t index, uint16 fp)
+	{
+		uint16* bucket = _slots.get() + index * bucket_slots;
+		for(size_t i = 0; i < bucket_slots; ++i)
+		{
+			if(bucket[i] == fp)
+			{
+				bucket[i] = 0;
+				return true;
+			}
+		}
+		return false;
+	}
+} // namespace bl
@@ -0,0 +1,148 @@
+#pragma once
+#include <bl/util/hash_function.h>
+#include <bl/util/integer.h>
+#include <bl/util/memory.h>
+#include <vector>
+
+// probabilistic membership filters to skip lookups of keys that are certainly absent.
+// both hash keys with a seed stored in the filter, so a serialized filter answers the same in any process.
+// serialized data uses the native byte order
+namespace bl
+{
+	// split block bloom filter: each key sets one bit in each of the 8 lanes of a single 32 byte block,
+	// so a probe touches one cache line and is a single avx2 test
+	// ref: https://github.com/apache/parquet-format/blob/master/BloomFilter.md
+	class bloom_filter
+	{
+	public:
+		bloom_filter();
+		// throws std::invalid_argument unless 0 < false_positive_rate < 1
+		explicit bloom_filter(size_t expected_keys, double false_positive_rate = 0.01, uint64 seed = 0);
+
+		void reset(size_t expected_keys, double false_positive_rate = 0.01, uint64 seed = 0);
+		void clear();
+
+		template<typename t_key>
+		void insert(const t_key& key);
+
+		template<typename t_key>
+		bool contains(const t_key& key) const;
+
+		// for keys hashed by the caller, hashes must be well mixed
+		void insert_hash(uint64 h);
+		bool contains_hash(uint64 h) const;
+
+		// out[i] = contains_hash(hashes[i]), prefetches ahead to overlap the cache misses
+		void contains_hash(const uint64* hashes, size_t count, bool* out) const;
+
+		size_t block_count() const;
+		size_t size_bytes() const;
+		uint64 seed() const;
+
+		void serialize(std::vector<uint8>& out) const;
+		bool deserialize(const std::vector<uint8>& in);
+		bool deserialize(const void* data, size_t size);
+
+	private:
+		static const size_t block_words = 8;
+		static const size_t block_bytes = block_words * sizeof(uint32);
+
+		uint32* _block(uint64 h) const;
+
+		unique_ptr<uint32, aligned_deleter> _words;
+		size_t _blocks;
+		uint64 _seed;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// cuckoo filter with 16 bit fingerprints in buckets of 4, supports deletion of inserted keys.
+	// inserting the same key more than twice may fill both of its buckets, erase only keys that were inserted
+	// ref: https://www.cs.cmu.edu/~dga/papers/cuckoo-conext2014.pdf
+	class cuckoo_filter
+	{
+	public:
+		cuckoo_filter();
+		explicit cuckoo_filter(size_t capacity, uint64 seed = 0);
+
+		void reset(size_t capacity, uint64 seed = 0);
+		void clear();
+
+		// returns false when the filter is full: the key that overflowed it is still kept, later keys are rejected
+		template<typename t_key>
+		bool insert(const t_key& key);
+
+		template<typename t_key>
+		bool contains(const t_key& key) const;
+
+		template<typename t_key>
+		bool erase(const t_key& key);
+
+		bool insert_hash(uint64 h);
+		bool contains_hash(uint64 h) const;
+		bool erase_hash(uint64 h);
+
+		size_t size() const;
+		size_t capacity() const;
+		size_t size_bytes() const;
+		uint64 seed() const;
+
+		void serialize(std::vector<uint8>& out) const;
+		bool deserialize(const std::vector<uint8>& in);
+		bool deserialize(const void* data, size_t size);
+
+	private:
+		static const size_t bucket_slots = 4;
+		static const int max_kicks = 500;
+
+		static uint16 _fingerprint(uint64 h);
+		size_t _alt_index(size_t index, uint16 fp) const;
+		bool _insert_into(size_t index, uint16 fp);
+		bool _erase_from(size_t index, uint16 fp);
+
+		unique_ptr<uint16, aligned_deleter> _slots;
+		size_t _buckets;
+		size_t _size;
+		uint64 _seed;
+		uint64 _rng;
+
+		// last fingerprint that could not be placed, the filter is full while it is set
+		bool _has_victim;
+		size_t _victim_index;
+		uint16 _victim_fp;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_key>
+	void bloom_filter::insert(const t_key& key)
+	{
+		insert_hash(hash<t_key>(_seed)(key));
+	}
+
+	template<typename t_key>
+	bool bloom_filter::contains(const t_key& key) const
+	{
+		return contains_hash(hash<t_key>(_seed)(key));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_key>
+	bool cuckoo_filter::insert(const t_key& key)
+	{
+		return insert_hash(hash<t_key>(_seed)(key));
+	}
+
+	template<typename t_key>
+	bool cuckoo_filter::contains(const t_key& key) const
+	{
+		return contains_hash(hash<t_key>(_seed)(key));
+	}
+
+	template<typename t_key>
+	bool cuckoo_filter::erase(const t_key& key)
+	{
+		return erase_hash(hash<t_key>(_seed)(key));
+	}
+} // namespace bl
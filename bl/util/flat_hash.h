@@ -0,0 +1,1127 @@
+#pragma once
+#include <bl/util/hash_function.h>
+#include <bl/util/integer.h>
+#include <bl/util/platform.h>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BL_FLAT_HASH_SSE2
+#endif
+
+// open addressing hash containers in the style of swiss tables
+// ref: https://abseil.io/about/design/swisstables
+namespace bl
+{
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// control bytes: one per slot, full slots store the low 7 bits of the hash
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	typedef int8 flat_ctrl;
+
+	static const flat_ctrl flat_ctrl_empty = -128;
+	static const flat_ctrl flat_ctrl_deleted = -2;
+	static const flat_ctrl flat_ctrl_sentinel = -1;
+
+	// set of matching slots inside a group, t_shift is log2 of the number of mask bits per slot
+	template<typename t_mask, int t_width, int t_shift>
+	class flat_bitmask
+	{
+	public:
+		explicit flat_bitmask(t_mask mask) : _mask(mask) {}
+
+		explicit operator bool() const { return _mask != 0; }
+		void clear_lowest() { _mask &= (_mask - 1); }
+
+		int lowest() const { return _ctz(_mask) >> t_shift; }
+		int leading_zeros() const { return (_clz(_mask) - static_cast<int>(sizeof(t_mask) * 8 - (t_width << t_shift))) >> t_shift; }
+
+	private:
+		static int _ctz(uint32 x) { return __builtin_ctz(x); }
+		static int _ctz(uint64 x) { return __builtin_ctzll(x); }
+		static int _clz(uint32 x) { return __builtin_clz(x); }
+		static int _clz(uint64 x) { return __builtin_clzll(x); }
+
+		t_mask _mask;
+	};
+
+#if defined(BL_FLAT_HASH_SSE2)
+	// 16 control bytes compared at once
+	class flat_group
+	{
+	public:
+		static const size_t width = 16;
+		typedef flat_bitmask<uint32, 16, 0> mask_type;
+
+		explicit flat_group(const flat_ctrl* pos)
+			: _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)))
+		{
+		}
+
+		mask_type match(flat_ctrl h2) const
+		{
+			return mask_type(static_cast<uint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl))));
+		}
+
+		mask_type match_empty() const
+		{
+			return match(flat_ctrl_empty);
+		}
+
+		mask_type match_empty_or_deleted() const
+		{
+			return mask_type(static_cast<uint32>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(flat_ctrl_sentinel), _ctrl))));
+		}
+
+	private:
+		__m128i _ctrl;
+	};
+#else
+	// 8 control bytes compared at once with word arithmetic (little endian)
+	class flat_group
+	{
+	public:
+		static const size_t width = 8;
+		typedef flat_bitmask<uint64, 8, 3> mask_type;
+
+		explicit flat_group(const flat_ctrl* pos)
+		{
+			std::memcpy(&_ctrl, pos, sizeof(_ctrl));
+		}
+
+		// may report false positives, which are discarded by the key comparison
+		mask_type match(flat_ctrl h2) const
+		{
+			const uint64 x = _ctrl ^ (lsbs * static_cast<uint8>(h2));
+			return mask_type((x - lsbs) & ~x & msbs);
+		}
+
+		mask_type match_empty() const
+		{
+			return mask_type((_ctrl & (~_ctrl << 6)) & msbs);
+		}
+
+		mask_type match_empty_or_deleted() const
+		{
+			return mask_type((_ctrl & (~_ctrl << 7)) & msbs);
+		}
+
+	private:
+		static const uint64 msbs = 0x8080808080808080ULL;
+		static const uint64 lsbs = 0x0101010101010101ULL;
+
+		uint64 _ctrl;
+	};
+#endif
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// heterogeneous lookup: enabled when both hasher and key equality declare is_transparent
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename>
+	struct flat_void
+	{
+		typedef void type;
+	};
+
+	template<typename t_type, typename = void>
+	struct is_transparent : std::false_type
+	{
+	};
+
+	template<typename t_type>
+	struct is_transparent<t_type, typename flat_void<typename t_type::is_transparent>::type> : std::true_type
+	{
+	};
+
+	template<bool t_transparent>
+	struct flat_key_arg
+	{
+		template<typename t_key, typename t_key_type>
+		using type = t_key;
+	};
+
+	template<>
+	struct flat_key_arg<false>
+	{
+		template<typename t_key, typename t_key_type>
+		using type = t_key_type;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// slot policies
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_key>
+	struct flat_set_policy
+	{
+		typedef t_key key_type;
+		typedef t_key value_type;
+
+		static const key_type& key(const value_type& value)
+		{
+			return value;
+		}
+
+		static void transfer(value_type* dst, value_type* src)
+		{
+			new(dst) value_type(std::move(*src));
+			src->~value_type();
+		}
+	};
+
+	template<typename t_key, typename t_value>
+	struct flat_map_policy
+	{
+		typedef t_key key_type;
+		typedef std::pair<const t_key, t_value> value_type;
+
+		static const key_type& key(const value_type& value)
+		{
+			return value.first;
+		}
+
+		static void transfer(value_type* dst, value_type* src)
+		{
+			// the source is destroyed right after, so moving out of its const key is safe (same trick as libc++ and abseil)
+			new(dst) value_type(std::move(const_cast<t_key&>(src->first)), std::move(src->second));
+			src->~value_type();
+		}
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// table shared by flat_hash_set and flat_hash_map
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	class flat_hash_table
+	{
+	public:
+		typedef typename t_policy::key_type key_type;
+		typedef typename t_policy::value_type value_type;
+		typedef size_t size_type;
+		typedef t_hash hasher;
+		typedef t_pred key_equal;
+		typedef t_alloc allocator_type;
+		typedef value_type& reference;
+		typedef const value_type& const_reference;
+
+	private:
+		typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type slot_type;
+		typedef typename std::allocator_traits<t_alloc>::template rebind_alloc<slot_type> slot_allocator;
+
+	protected:
+		template<typename t_key>
+		using key_arg = typename flat_key_arg<is_transparent<t_hash>::value && is_transparent<t_pred>::value>::template type<t_key, key_type>;
+
+	private:
+
+		template<bool t_const>
+		class iterator_impl
+		{
+			friend class flat_hash_table;
+
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef typename flat_hash_table::value_type value_type;
+			typedef typename std::conditional<t_const, const value_type&, value_type&>::type reference;
+			typedef typename std::conditional<t_const, const value_type*, value_type*>::type pointer;
+			typedef ptrdiff_t difference_type;
+
+			iterator_impl() : _ctrl(nullptr), _slot(nullptr) {}
+
+			// iterator converts to const_iterator
+			template<bool t_other, typename = typename std::enable_if<t_const && !t_other>::type>
+			iterator_impl(const iterator_impl<t_other>& other) : _ctrl(other._ctrl), _slot(other._slot) {}
+
+			reference operator*() const { return *reinterpret_cast<pointer>(_slot); }
+			pointer operator->() const { return reinterpret_cast<pointer>(_slot); }
+
+			iterator_impl& operator++()
+			{
+				++_ctrl;
+				++_slot;
+				_skip_free();
+				return *this;
+			}
+
+			iterator_impl operator++(int)
+			{
+				iterator_impl tmp = *this;
+				++*this;
+				return tmp;
+			}
+
+			bool operator==(const iterator_impl& other) const { return _ctrl == other._ctrl; }
+			bool operator!=(const iterator_impl& other) const { return _ctrl != other._ctrl; }
+
+		private:
+			template<bool> friend class iterator_impl;
+
+			iterator_impl(flat_ctrl* ctrl, slot_type* slot) : _ctrl(ctrl), _slot(slot) {}
+
+			// the sentinel stops the scan at end()
+			void _skip_free()
+			{
+				while(*_ctrl < flat_ctrl_sentinel)
+				{
+					++_ctrl;
+					++_slot;
+				}
+			}
+
+			flat_ctrl* _ctrl;
+			slot_type* _slot;
+		};
+
+	public:
+		typedef iterator_impl<false> iterator;
+		typedef iterator_impl<true> const_iterator;
+
+		explicit flat_hash_table(size_t bucket_count = 0, const t_hash& hash = t_hash(), const t_pred& pred = t_pred(), const t_alloc& alloc = t_alloc());
+		flat_hash_table(std::initializer_list<value_type> list, size_t bucket_count = 0, const t_hash& hash = t_hash(), const t_pred& pred = t_pred(), const t_alloc& alloc = t_alloc());
+		flat_hash_table(const flat_hash_table& other);
+		flat_hash_table(flat_hash_table&& other);
+		~flat_hash_table();
+
+		flat_hash_table& operator=(const flat_hash_table& other);
+		flat_hash_table& operator=(flat_hash_table&& other);
+
+		iterator begin();
+		const_iterator begin() const;
+		const_iterator cbegin() const;
+		iterator end();
+		const_iterator end() const;
+		const_iterator cend() const;
+
+		bool empty() const;
+		size_t size() const;
+		size_t capacity() const;
+		float load_factor() const;
+
+		void clear();
+		void reserve(size_t count);
+		void rehash(size_t count);
+		void swap(flat_hash_table& other);
+
+		std::pair<iterator, bool> insert(const value_type& value);
+		std::pair<iterator, bool> insert(value_type&& value);
+
+		template<typename t_iterator>
+		void insert(t_iterator first, t_iterator last);
+
+		template<typename ...t_args>
+		std::pair<iterator, bool> emplace(t_args&& ...args);
+
+		template<typename t_key = key_type>
+		iterator find(const key_arg<t_key>& key);
+
+		template<typename t_key = key_type>
+		const_iterator find(const key_arg<t_key>& key) const;
+
+		template<typename t_key = key_type>
+		bool contains(const key_arg<t_key>& key) const;
+
+		template<typename t_key = key_type>
+		size_t count(const key_arg<t_key>& key) const;
+
+		template<typename t_key = key_type>
+		size_t erase(const key_arg<t_key>& key);
+
+		// unlike the std containers this does not return the next iterator, use erase(it++) while iterating
+		void erase(const_iterator position);
+
+		hasher hash_function() const;
+		key_equal key_eq() const;
+		allocator_type get_allocator() const;
+
+	protected:
+		// finds key, or claims a slot for it and returns (index, true) so the caller can construct the value in place
+		template<typename t_key>
+		std::pair<size_t, bool> _find_or_prepare_insert(const t_key& key);
+
+		// undo _find_or_prepare_insert when constructing the value throws
+		void _abort_insert(size_t index);
+
+		value_type* _value(size_t index) const;
+		iterator _iterator_at(size_t index);
+
+	private:
+		static const size_t npos = static_cast<size_t>(-1);
+		static const size_t cloned_bytes = flat_group::width - 1;
+
+		static size_t _normalize_capacity(size_t n);
+		static size_t _capacity_to_growth(size_t capacity);
+		static size_t _growth_to_capacity(size_t growth);
+
+		template<typename t_key>
+		size_t _find_index(const t_key& key, size_t hash) const;
+		size_t _find_first_non_full(size_t hash) const;
+		void _set_ctrl(size_t index, flat_ctrl h);
+		void _erase_index(size_t index);
+		void _release_ctrl(size_t index);
+		void _resize(size_t new_capacity);
+		void _drop_deletes();
+		void _destroy_all();
+		void _deallocate();
+
+		template<typename t_value>
+		std::pair<iterator, bool> _insert_value(t_value&& value);
+
+		slot_type* _slots;
+		flat_ctrl* _ctrl;
+		size_t _size;
+		size_t _capacity;
+		size_t _growth_left;
+		t_hash _hash;
+		t_pred _pred;
+		slot_allocator _alloc;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value,
+			 typename t_hash = hash<t_value>,
+			 typename t_pred = equal_to<t_value>,
+			 typename t_alloc = std::allocator<t_value>>
+	class flat_hash_set : public flat_hash_table<flat_set_policy<t_value>, t_hash, t_pred, t_alloc>
+	{
+		typedef flat_hash_table<flat_set_policy<t_value>, t_hash, t_pred, t_alloc> base;
+
+	public:
+		using base::base;
+	};
+
+	template<typename t_key,
+			 typename t_value,
+			 typename t_hash = hash<t_key>,
+			 typename t_pred = equal_to<t_key>,
+			 typename t_alloc = std::allocator<std::pair<const t_key, t_value>>>
+	class flat_hash_map : public flat_hash_table<flat_map_policy<t_key, t_value>, t_hash, t_pred, t_alloc>
+	{
+		typedef flat_hash_table<flat_map_policy<t_key, t_value>, t_hash, t_pred, t_alloc> base;
+
+	public:
+		typedef t_value mapped_type;
+		typedef typename base::iterator iterator;
+		typedef typename base::const_iterator const_iterator;
+
+		using base::base;
+
+		template<typename ...t_args>
+		std::pair<iterator, bool> try_emplace(const t_key& key, t_args&& ...args);
+
+		template<typename ...t_args>
+		std::pair<iterator, bool> try_emplace(t_key&& key, t_args&& ...args);
+
+		template<typename t_arg>
+		std::pair<iterator, bool> insert_or_assign(const t_key& key, t_arg&& value);
+
+		template<typename t_arg>
+		std::pair<iterator, bool> insert_or_assign(t_key&& key, t_arg&& value);
+
+		t_value& operator[](const t_key& key);
+		t_value& operator[](t_key&& key);
+
+		template<typename t_lookup = t_key>
+		t_value& at(const typename base::template key_arg<t_lookup>& key);
+
+		template<typename t_lookup = t_key>
+		const t_value& at(const typename base::template key_arg<t_lookup>& key) const;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::flat_hash_table(size_t bucket_count, const t_hash& hash, const t_pred& pred, const t_alloc& alloc)
+		: _slots(nullptr), _ctrl(nullptr), _size(0), _capacity(0), _growth_left(0), _hash(hash), _pred(pred), _alloc(alloc)
+	{
+		if(bucket_count > 0)
+		{
+			_resize(_normalize_capacity(bucket_count));
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::flat_hash_table(std::initializer_list<value_type> list, size_t bucket_count, const t_hash& hash, const t_pred& pred, const t_alloc& alloc)
+		: flat_hash_table(bucket_count, hash, pred, alloc)
+	{
+		insert(list.begin(), list.end());
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::flat_hash_table(const flat_hash_table& other)
+		: flat_hash_table(0, other._hash, other._pred, std::allocator_traits<slot_allocator>::select_on_container_copy_construction(other._alloc))
+	{
+		reserve(other.size());
+		insert(other.begin(), other.end());
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::flat_hash_table(flat_hash_table&& other)
+		: _slots(other._slots), _ctrl(other._ctrl), _size(other._size), _capacity(other._capacity), _growth_left(other._growth_left),
+		  _hash(std::move(other._hash)), _pred(std::move(other._pred)), _alloc(std::move(other._alloc))
+	{
+		other._slots = nullptr;
+		other._ctrl = nullptr;
+		other._size = 0;
+		other._capacity = 0;
+		other._growth_left = 0;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::~flat_hash_table()
+	{
+		_destroy_all();
+		_deallocate();
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	flat_hash_table<t_policy, t_hash, t_pred, t_alloc>& flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::operator=(const flat_hash_table& other)
+	{
+		if(this != &other)
+		{
+			flat_hash_table tmp(other);
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	flat_hash_table<t_policy, t_hash, t_pred, t_alloc>& flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::operator=(flat_hash_table&& other)
+	{
+		swap(other);
+		return *this;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::begin()
+	{
+		if(_size == 0)
+		{
+			return end();
+		}
+		iterator it(_ctrl, _slots);
+		it._skip_free();
+		return it;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::const_iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::begin() const
+	{
+		return const_cast<flat_hash_table*>(this)->begin();
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::const_iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::cbegin() const
+	{
+		return begin();
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::end()
+	{
+		return iterator(_ctrl + _capacity, _slots + _capacity);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::const_iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::end() const
+	{
+		return const_cast<flat_hash_table*>(this)->end();
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::const_iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::cend() const
+	{
+		return end();
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	bool flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::empty() const
+	{
+		return _size == 0;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::size() const
+	{
+		return _size;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::capacity() const
+	{
+		return _capacity;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	float flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::load_factor() const
+	{
+		return _capacity == 0 ? 0.0f : static_cast<float>(_size) / static_cast<float>(_capacity);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::clear()
+	{
+		_destroy_all();
+		if(_capacity > 0)
+		{
+			std::memset(_ctrl, flat_ctrl_empty, _capacity + 1 + cloned_bytes);
+			_ctrl[_capacity] = flat_ctrl_sentinel;
+		}
+		_size = 0;
+		_growth_left = _capacity_to_growth(_capacity);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::reserve(size_t count)
+	{
+		if(count > _size + _growth_left)
+		{
+			_resize(_normalize_capacity(_growth_to_capacity(count)));
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::rehash(size_t count)
+	{
+		const size_t needed = _growth_to_capacity(_size);
+		const size_t new_capacity = _normalize_capacity(count > needed ? count : needed);
+		if(_size == 0 && count == 0)
+		{
+			_deallocate();
+		}
+		else if(new_capacity != _capacity)
+		{
+			_resize(new_capacity);
+		}
+		else if(_capacity_to_growth(_capacity) != _size + _growth_left)
+		{
+			_drop_deletes();
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::swap(flat_hash_table& other)
+	{
+		std::swap(_slots, other._slots);
+		std::swap(_ctrl, other._ctrl);
+		std::swap(_size, other._size);
+		std::swap(_capacity, other._capacity);
+		std::swap(_growth_left, other._growth_left);
+		std::swap(_hash, other._hash);
+		std::swap(_pred, other._pred);
+		std::swap(_alloc, other._alloc);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	std::pair<typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::insert(const value_type& value)
+	{
+		return _insert_value(value);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	std::pair<typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::insert(value_type&& value)
+	{
+		return _insert_value(std::move(value));
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_iterator>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::insert(t_iterator first, t_iterator last)
+	{
+		for(; first != last; ++first)
+		{
+			insert(*first);
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename ...t_args>
+	std::pair<typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::emplace(t_args&& ...args)
+	{
+		// the key is only known after construction
+		return _insert_value(value_type(std::forward<t_args>(args)...));
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_key>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::find(const key_arg<t_key>& key)
+	{
+		const size_t index = _find_index(key, _hash(key));
+		return index == npos ? end() : _iterator_at(index);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_key>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::const_iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::find(const key_arg<t_key>& key) const
+	{
+		return const_cast<flat_hash_table*>(this)->find<t_key>(key);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_key>
+	bool flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::contains(const key_arg<t_key>& key) const
+	{
+		return _find_index(key, _hash(key)) != npos;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_key>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::count(const key_arg<t_key>& key) const
+	{
+		return contains<t_key>(key) ? 1 : 0;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_key>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::erase(const key_arg<t_key>& key)
+	{
+		const size_t index = _find_index(key, _hash(key));
+		if(index == npos)
+		{
+			return 0;
+		}
+		_erase_index(index);
+		return 1;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::erase(const_iterator position)
+	{
+		_erase_index(static_cast<size_t>(position._ctrl - _ctrl));
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::hasher flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::hash_function() const
+	{
+		return _hash;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::key_equal flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::key_eq() const
+	{
+		return _pred;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::allocator_type flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::get_allocator() const
+	{
+		return allocator_type(_alloc);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_key>
+	std::pair<size_t, bool> flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_find_or_prepare_insert(const t_key& key)
+	{
+		const size_t hash = _hash(key);
+		const size_t found = _find_index(key, hash);
+		if(found != npos)
+		{
+			return std::make_pair(found, false);
+		}
+
+		if(_capacity == 0)
+		{
+			_resize(1);
+		}
+
+		size_t index = _find_first_non_full(hash);
+		if(_growth_left == 0 && _ctrl[index] != flat_ctrl_deleted)
+		{
+			// grow, or just drop tombstones in place when they are the reason we ran out of room
+			if(_capacity > flat_group::width && _size * 32 <= _capacity * 25)
+			{
+				_drop_deletes();
+			}
+			else
+			{
+				_resize(_capacity * 2 + 1);
+			}
+			index = _find_first_non_full(hash);
+		}
+
+		++_size;
+		_growth_left -= (_ctrl[index] == flat_ctrl_empty) ? 1 : 0;
+		_set_ctrl(index, static_cast<flat_ctrl>(hash & 0x7f));
+		return std::make_pair(index, true);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_abort_insert(size_t index)
+	{
+		// the slot may have been a tombstone on the probe path of other keys, so it is released like an erased one
+		--_size;
+		_release_ctrl(index);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::value_type* flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_value(size_t index) const
+	{
+		return reinterpret_cast<value_type*>(_slots + index);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_iterator_at(size_t index)
+	{
+		return iterator(_ctrl + index, _slots + index);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_normalize_capacity(size_t n)
+	{
+		// capacities are of the form 2^k - 1 so that index & capacity wraps around
+		size_t capacity = 1;
+		while(capacity < n)
+		{
+			capacity = capacity * 2 + 1;
+		}
+		return capacity;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_capacity_to_growth(size_t capacity)
+	{
+		// max load factor of 7/8, small tables always keep empty control bytes within reach of every group load
+		if(flat_group::width == 8 && capacity == 7)
+		{
+			return 6;
+		}
+		return capacity - capacity / 8;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_growth_to_capacity(size_t growth)
+	{
+		if(flat_group::width == 8 && growth == 7)
+		{
+			return 8;
+		}
+		return growth + (growth > 0 ? (growth - 1) / 7 : 0);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_key>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_find_index(const t_key& key, size_t hash) const
+	{
+		if(_capacity == 0)
+		{
+			return npos;
+		}
+
+		const flat_ctrl h2 = static_cast<flat_ctrl>(hash & 0x7f);
+		size_t offset = (hash >> 7) & _capacity;
+		size_t step = 0;
+		for(;;)
+		{
+			const flat_group g(_ctrl + offset);
+			for(auto m = g.match(h2); m; m.clear_lowest())
+			{
+				const size_t index = (offset + static_cast<size_t>(m.lowest())) & _capacity;
+				if(_pred(t_policy::key(*_value(index)), key))
+				{
+					return index;
+				}
+			}
+			if(g.match_empty())
+			{
+				return npos;
+			}
+			// triangular probing visits every group once
+			step += flat_group::width;
+			offset = (offset + step) & _capacity;
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	size_t flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_find_first_non_full(size_t hash) const
+	{
+		size_t offset = (hash >> 7) & _capacity;
+		size_t step = 0;
+		for(;;)
+		{
+			const auto m = flat_group(_ctrl + offset).match_empty_or_deleted();
+			if(m)
+			{
+				return (offset + static_cast<size_t>(m.lowest())) & _capacity;
+			}
+			step += flat_group::width;
+			offset = (offset + step) & _capacity;
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_set_ctrl(size_t index, flat_ctrl h)
+	{
+		// the first cloned_bytes control bytes are mirrored after the sentinel so group loads never wrap
+		_ctrl[index] = h;
+		_ctrl[((index - cloned_bytes) & _capacity) + (cloned_bytes & _capacity)] = h;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_erase_index(size_t index)
+	{
+		_value(index)->~value_type();
+		--_size;
+		_release_ctrl(index);
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_release_ctrl(size_t index)
+	{
+		// if no probe sequence can have walked past this slot while the group around it was full,
+		// the slot can go straight back to empty instead of becoming a tombstone
+		const size_t index_before = (index - flat_group::width) & _capacity;
+		const auto empty_after = flat_group(_ctrl + index).match_empty();
+		const auto empty_before = flat_group(_ctrl + index_before).match_empty();
+		const bool was_never_full = empty_before && empty_after &&
+									static_cast<size_t>(empty_after.lowest() + empty_before.leading_zeros()) < flat_group::width;
+
+		_set_ctrl(index, was_never_full ? flat_ctrl_empty : flat_ctrl_deleted);
+		_growth_left += was_never_full ? 1 : 0;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_resize(size_t new_capacity)
+	{
+		slot_type* old_slots = _slots;
+		flat_ctrl* old_ctrl = _ctrl;
+		const size_t old_capacity = _capacity;
+
+		// slots first to get their alignment from the allocator, control bytes right after
+		const size_t ctrl_bytes = new_capacity + 1 + cloned_bytes;
+		const size_t slot_count = new_capacity + (ctrl_bytes + sizeof(slot_type) - 1) / sizeof(slot_type);
+		_slots = std::allocator_traits<slot_allocator>::allocate(_alloc, slot_count);
+		_ctrl = reinterpret_cast<flat_ctrl*>(_slots + new_capacity);
+		_capacity = new_capacity;
+		std::memset(_ctrl, flat_ctrl_empty, ctrl_bytes);
+		_ctrl[_capacity] = flat_ctrl_sentinel;
+		_growth_left = _capacity_to_growth(_capacity) - _size;
+
+		for(size_t i = 0; i < old_capacity; ++i)
+		{
+			if(old_ctrl[i] >= 0)
+			{
+				value_type* old_value = reinterpret_cast<value_type*>(old_slots + i);
+				const size_t hash = _hash(t_policy::key(*old_value));
+				const size_t index = _find_first_non_full(hash);
+				_set_ctrl(index, static_cast<flat_ctrl>(hash & 0x7f));
+				t_policy::transfer(_value(index), old_value);
+			}
+		}
+
+		if(old_slots != nullptr)
+		{
+			const size_t old_count = old_capacity + (old_capacity + 1 + cloned_bytes + sizeof(slot_type) - 1) / sizeof(slot_type);
+			std::allocator_traits<slot_allocator>::deallocate(_alloc, old_slots, old_count);
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_drop_deletes()
+	{
+		// rehash in the same allocation: tombstones become empty and every full slot is marked deleted,
+		// meaning "still to be placed", then each of those is moved to the first free slot of its probe sequence
+		for(size_t i = 0; i < _capacity; ++i)
+		{
+			_set_ctrl(i, _ctrl[i] >= 0 ? flat_ctrl_deleted : flat_ctrl_empty);
+		}
+
+		slot_type tmp;
+		for(size_t i = 0; i < _capacity; ++i)
+		{
+			if(_ctrl[i] != flat_ctrl_deleted)
+			{
+				continue;
+			}
+
+			const size_t hash = _hash(t_policy::key(*_value(i)));
+			const flat_ctrl h2 = static_cast<flat_ctrl>(hash & 0x7f);
+			const size_t target = _find_first_non_full(hash);
+
+			// already in the first group its probe sequence reaches, lookups find it where it is
+			const size_t probe_offset = (hash >> 7) & _capacity;
+			if(((i - probe_offset) & _capacity) / flat_group::width == ((target - probe_offset) & _capacity) / flat_group::width)
+			{
+				_set_ctrl(i, h2);
+				continue;
+			}
+
+			if(_ctrl[target] == flat_ctrl_empty)
+			{
+				_set_ctrl(target, h2);
+				t_policy::transfer(_value(target), _value(i));
+				_set_ctrl(i, flat_ctrl_empty);
+			}
+			else
+			{
+				// target holds another value still to be placed, swap and process slot i again
+				_set_ctrl(target, h2);
+				value_type* held = reinterpret_cast<value_type*>(&tmp);
+				t_policy::transfer(held, _value(target));
+				t_policy::transfer(_value(target), _value(i));
+				t_policy::transfer(_value(i), held);
+				--i;
+			}
+		}
+
+		_growth_left = _capacity_to_growth(_capacity) - _size;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_destroy_all()
+	{
+		if(!std::is_trivially_destructible<value_type>::value)
+		{
+			for(size_t i = 0; i < _capacity; ++i)
+			{
+				if(_ctrl[i] >= 0)
+				{
+					_value(i)->~value_type();
+				}
+			}
+		}
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	void flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_deallocate()
+	{
+		if(_slots != nullptr)
+		{
+			const size_t count = _capacity + (_capacity + 1 + cloned_bytes + sizeof(slot_type) - 1) / sizeof(slot_type);
+			std::allocator_traits<slot_allocator>::deallocate(_alloc, _slots, count);
+		}
+		_slots = nullptr;
+		_ctrl = nullptr;
+		_capacity = 0;
+		_growth_left = 0;
+	}
+
+	template<typename t_policy, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_value>
+	std::pair<typename flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_table<t_policy, t_hash, t_pred, t_alloc>::_insert_value(t_value&& value)
+	{
+		const auto res = _find_or_prepare_insert(t_policy::key(value));
+		if(res.second)
+		{
+			try
+			{
+				new(_value(res.first)) value_type(std::forward<t_value>(value));
+			}
+			catch(...)
+			{
+				_abort_insert(res.first);
+				throw;
+			}
+		}
+		return std::make_pair(_iterator_at(res.first), res.second);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename ...t_args>
+	std::pair<typename flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::try_emplace(const t_key& key, t_args&& ...args)
+	{
+		const auto res = this->_find_or_prepare_insert(key);
+		if(res.second)
+		{
+			try
+			{
+				new(this->_value(res.first)) typename base::value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<t_args>(args)...));
+			}
+			catch(...)
+			{
+				this->_abort_insert(res.first);
+				throw;
+			}
+		}
+		return std::make_pair(this->_iterator_at(res.first), res.second);
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename ...t_args>
+	std::pair<typename flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::try_emplace(t_key&& key, t_args&& ...args)
+	{
+		const auto res = this->_find_or_prepare_insert(key);
+		if(res.second)
+		{
+			try
+			{
+				new(this->_value(res.first)) typename base::value_type(std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<t_args>(args)...));
+			}
+			catch(...)
+			{
+				this->_abort_insert(res.first);
+				throw;
+			}
+		}
+		return std::make_pair(this->_iterator_at(res.first), res.second);
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_arg>
+	std::pair<typename flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::insert_or_assign(const t_key& key, t_arg&& value)
+	{
+		auto res = try_emplace(key, std::forward<t_arg>(value));
+		if(!res.second)
+		{
+			res.first->second = std::forward<t_arg>(value);
+		}
+		return res;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_arg>
+	std::pair<typename flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::iterator, bool> flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::insert_or_assign(t_key&& key, t_arg&& value)
+	{
+		auto res = try_emplace(std::move(key), std::forward<t_arg>(value));
+		if(!res.second)
+		{
+			res.first->second = std::forward<t_arg>(value);
+		}
+		return res;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	t_value& flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::operator[](const t_key& key)
+	{
+		return try_emplace(key).first->second;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	t_value& flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::operator[](t_key&& key)
+	{
+		return try_emplace(std::move(key)).first->second;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_lookup>
+	t_value& flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::at(const typename base::template key_arg<t_lookup>& key)
+	{
+		auto it = this->template find<t_lookup>(key);
+		if(it == this->end())
+		{
+			throw std::out_of_range("flat_hash_map::at: key not found");
+		}
+		return it->second;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash, typename t_pred, typename t_alloc>
+	template<typename t_lookup>
+	const t_value& flat_hash_map<t_key, t_value, t_hash, t_pred, t_alloc>::at(const typename base::template key_arg<t_lookup>& key) const
+	{
+		auto it = this->template find<t_lookup>(key);
+		if(it == this->end())
+		{
+			throw std::out_of_range("flat_hash_map::at: key not found");
+		}
+		return it->second;
+	}
+} // namespace bl
@@ -0,0 +1,280 @@
+#include <bl/util/hash_function.h>
+#include <bl/util/atomic.h>
+#include <chrono>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BL_HASH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BL_HASH_SSE2
+#endif
+
+namespace bl
+{
+	static const uint64 s_p0 = 0xa0761d6478bd642fULL;
+	static const uint64 s_p1 = 0xe7037ed1a0b428dbULL;
+	static const uint64 s_p2 = 0x8ebc6af09c88c6e3ULL;
+	static const uint64 s_p3 = 0x589965cc75374cc3ULL;
+
+	static const uint32 s_prime32 = 0x9E3779B1U;
+	static const uint64 s_prime64 = 0x9E3779B185EBCA87ULL;
+
+	// long keys: 64 byte stripes are accumulated into 8 lanes, every 16 stripes the lanes are scrambled
+	static const size_t s_stripe_size = 64;
+	static const size_t s_secret_size = 192;
+	static const size_t s_stripes_per_block = (s_secret_size - s_stripe_size) / 8;
+	static const size_t s_block_size = s_stripe_size * s_stripes_per_block;
+	static const size_t s_long_key = 256;
+
+	static const uint64 s_secret[s_secret_size / 8] = {
+		0x1ac046dda8e86e2aULL, 0xbe2c3b00b1d348c8ULL, 0x9b1a66a95412ff75ULL, 0xc448c2b1f05f7e4cULL,
+		0xc111ca6b8f6e73c4ULL, 0xb54861920d05b01dULL, 0x8d61500f4a7bbe16ULL, 0x5e0c25471f89e02eULL,
+		0x48105a3d28f0e221ULL, 0x2169f8846b637746ULL, 0x3d628782e0c0d863ULL, 0xa5ddb2216078aa40ULL,
+		0xc8119d17f0571101ULL, 0x98e2e2eb8f33280fULL, 0x8cd1e28860679cc4ULL, 0x9dca6189c923aef3ULL,
+		0x9d8d3071ba4f04c4ULL, 0x5d395ada34220c26ULL, 0xe6de42a441a1e28eULL, 0x308fbf68cc864f59ULL,
+		0x216a3c81332862f9ULL, 0xbaceca0a77f3132eULL, 0xdf2a2215339ca69cULL, 0x3e4c11a103a5d859ULL,
+	};
+
+	static uint64 read64(const uint8* p)
+	{
+		uint64 v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static uint64 read32(const uint8* p)
+	{
+		uint32 v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static void mum(uint64& a, uint64& b)
+	{
+	#if defined(__SIZEOF_INT128__)
+		__extension__ typedef unsigned __int128 uint128;
+		const uint128 r = static_cast<uint128>(a) * b;
+		a = static_cast<uint64>(r);
+		b = static_cast<uint64>(r >> 64);
+	#else
+		const uint64 ha = a >> 32, hb = b >> 32, la = static_cast<uint32>(a), lb = static_cast<uint32>(b);
+		const uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+		const uint64 lo = t + (rm1 << 32);
+		b = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl ? 1 : 0) + (lo < t ? 1 : 0);
+		a = lo;
+	#endif
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// long key path, the simd versions produce exactly the scalar result
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(BL_HASH_AVX2)
+	static void accumulate_stripe(uint64* acc, const uint8* input, const uint8* secret)
+	{
+		for(int i = 0; i < 2; ++i)
+		{
+			__m256i* a = reinterpret_cast<__m256i*>(acc) + i;
+			const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input) + i);
+			const __m256i key = _mm256_xor_si256(data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+			const __m256i product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+			const __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+			_mm256_storeu_si256(a, _mm256_add_epi64(_mm256_add_epi64(_mm256_loadu_si256(a), swapped), product));
+		}
+	}
+
+	static void scramble(uint64* acc, const uint8* secret)
+	{
+		const __m256i prime = _mm256_set1_epi32(static_cast<int>(s_prime32));
+		for(int i = 0; i < 2; ++i)
+		{
+			__m256i* a = reinterpret_cast<__m256i*>(acc) + i;
+			__m256i v = _mm256_loadu_si256(a);
+			v = _mm256_xor_si256(v, _mm256_srli_epi64(v, 47));
+			v = _mm256_xor_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+			const __m256i lo = _mm256_mul_epu32(v, prime);
+			const __m256i hi = _mm256_mul_epu32(_mm256_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+			_mm256_storeu_si256(a, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+		}
+	}
+#elif defined(BL_HASH_SSE2)
+	static void accumulate_stripe(uint64* acc, const uint8* input, const uint8* secret)
+	{
+		for(int i = 0; i < 4; ++i)
+		{
+			__m128i* a = reinterpret_cast<__m128i*>(acc) + i;
+			const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+			const __m128i key = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+			const __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+			const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+			_mm_storeu_si128(a, _mm_add_epi64(_mm_add_epi64(_mm_loadu_si128(a), swapped), product));
+		}
+	}
+
+	static void scramble(uint64* acc, const uint8* secret)
+	{
+		const __m128i prime = _mm_set1_epi32(static_cast<int>(s_prime32));
+		for(int i = 0; i < 4; ++i)
+		{
+			__m128i* a = reinterpret_cast<__m128i*>(acc) + i;
+			__m128i v = _mm_loadu_si128(a);
+			v = _mm_xor_si128(v, _mm_srli_epi64(v, 47));
+			v = _mm_xor_si128(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+			const __m128i lo = _mm_mul_epu32(v, prime);
+			const __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+			_mm_storeu_si128(a, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+		}
+	}
+#else
+	static void accumulate_stripe(uint64* acc, const uint8* input, const uint8* secret)
+	{
+		for(int i = 0; i < 8; ++i)
+		{
+			const uint64 data = read64(input + 8*i);
+			const uint64 key = data ^ read64(secret + 8*i);
+			acc[i ^ 1] += data;
+			acc[i] += (key & 0xffffffffULL) * (key >> 32);
+		}
+	}
+
+	static void scramble(uint64* acc, const uint8* secret)
+	{
+		for(int i = 0; i < 8; ++i)
+		{
+			uint64 a = acc[i];
+			a ^= a >> 47;
+			a ^= read64(secret + 8*i);
+			acc[i] = a * s_prime32;
+		}
+	}
+#endif
+
+	static uint64 hash_long(const uint8* p, size_t size, uint64 seed)
+	{
+		// the seed is folded into a private copy of the secret
+		uint64 secret_words[s_secret_size / 8];
+		for(size_t i = 0; i < s_secret_size / 8; ++i)
+		{
+			secret_words[i] = (i & 1) ? s_secret[i] - seed : s_secret[i] + seed;
+		}
+		const uint8* secret = reinterpret_cast<const uint8*>(secret_words);
+
+		uint64 acc[8] = {s_prime32, s_prime64, s_p0, s_p1, s_p2, s_p3, s_prime64 ^ s_p0, s_prime32 ^ s_p1};
+
+		const size_t blocks = (size - 1) / s_block_size;
+		for(size_t b = 0; b < blocks; ++b)
+		{
+			for(size_t s = 0; s < s_stripes_per_block; ++s)
+			{
+				accumulate_stripe(acc, p + b*s_block_size + s*s_stripe_size, secret + s*8);
+			}
+			scramble(acc, secret + s_secret_size - s_stripe_size);
+		}
+
+		const size_t stripes = ((size - 1) - blocks*s_block_size) / s_stripe_size;
+		for(size_t s = 0; s < stripes; ++s)
+		{
+			accumulate_stripe(acc, p + blocks*s_block_size + s*s_stripe_size, secret + s*8);
+		}
+		accumulate_stripe(acc, p + size - s_stripe_size, secret + s_secret_size - s_stripe_size - 7);
+
+		uint64 result = size * s_prime64;
+		for(int i = 0; i < 4; ++i)
+		{
+			result += hash_mix(acc[2*i] ^ read64(secret + 11 + 16*i), acc[2*i+1] ^ read64(secret + 19 + 16*i));
+		}
+		return hash_mix(result ^ s_p0, result ^ s_p1);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	static uint64 initial_seed()
+	{
+	#if defined(BL_HASH_FIXED_SEED)
+		return 0;
+	#else
+		int local = 0;
+		const uint64 t = static_cast<uint64>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+		return hash_mix(t ^ s_p2, static_cast<uint64>(reinterpret_cast<uintptr_t>(&local)) ^ s_p3);
+	#endif
+	}
+
+	static atomic<uint64>& seed_storage()
+	{
+		static atomic<uint64> seed(initial_seed());
+		return seed;
+	}
+
+	uint64 hash_seed()
+	{
+		return seed_storage().load(std::memory_order_relaxed);
+	}
+
+	void set_hash_seed(uint64 seed)
+	{
+		seed_storage().store(seed, std::memory_order_relaxed);
+	}
+
+	uint64 hash_bytes(const void* data, size_t size, uint64 seed)
+	{
+		const uint8* p = static_cast<const uint8*>(data);
+		if(size > s_long_key)
+		{
+			return hash_long(p, size, seed);
+		}
+
+		seed ^= hash_mix(seed ^ s_p0, s_p1);
+		uint64 a;
+		uint64 b;
+		if(size <= 16)
+		{
+			if(size >= 4)
+			{
+				a = (read32(p) << 32) | read32(p + ((size >> 3) << 2));
+				b = (read32(p + size - 4) << 32) | read32(p + size - 4 - ((size >> 3) << 2));
+			}
+			else if(size > 0)
+			{
+				a = (static_cast<uint64>(p[0]) << 16) | (static_cast<uint64>(p[size >> 1]) << 8) | p[size - 1];
+				b = 0;
+			}
+			else
+			{
+				a = b = 0;
+			}
+		}
+		else
+		{
+			size_t i = size;
+			if(i > 48)
+			{
+				uint64 see1 = seed;
+				uint64 see2 = seed;
+				do
+				{
+					seed = hash_mix(read64(p) ^ s_p1, read64(p + 8) ^ seed);
+					see1 = hash_mix(read64(p + 16) ^ s_p2, read64(p + 24) ^ see1);
+					see2 = hash_mix(read64(p + 32) ^ s_p3, read64(p + 40) ^ see2);
+					p += 48;
+					i -= 48;
+				}
+				while(i > 48);
+				seed ^= see1 ^ see2;
+			}
+			while(i > 16)
+			{
+				seed = hash_mix(read64(p) ^ s_p1, read64(p + 8) ^ seed);
+				p += 16;
+				i -= 16;
+			}
+			a = read64(p + i - 16);
+			b = read64(p + i - 8);
+		}
+
+		a ^= s_p1;
+		b ^= seed;
+		mum(a, b);
+		return hash_mix(a ^ s_p0 ^ size, b ^ s_p1);
+	}
+} // namespace bl
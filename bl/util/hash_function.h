@@ -0,0 +1,149 @@
+#pragma once
+#include <bl/util/integer.h>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+// fast non-cryptographic hashing: wyhash-style folded multiplies for integers and short keys,
+// xxh3-style striped accumulation (sse2/avx2) for long keys
+// ref: https://github.com/wangyi-fudan/wyhash
+// ref: https://github.com/Cyan4973/xxHash
+namespace bl
+{
+	// process wide default seed, random per run unless BL_HASH_FIXED_SEED is defined (then 0) or set_hash_seed is called.
+	// hashers copy the seed when constructed, so changing it never affects existing containers
+	uint64 hash_seed();
+	void set_hash_seed(uint64 seed);
+
+	// upper and lower halves of the 128 bit product xor'ed together
+	uint64 hash_mix(uint64 a, uint64 b);
+
+	uint64 hash_int(uint64 value, uint64 seed);
+	uint64 hash_bytes(const void* data, size_t size, uint64 seed);
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// common base holding the seed, construct with an explicit seed for reproducible hashes
+	class hasher_base
+	{
+	public:
+		hasher_base() : _seed(hash_seed()) {}
+		explicit hasher_base(uint64 seed) : _seed(seed) {}
+
+		uint64 seed() const { return _seed; }
+
+	protected:
+		uint64 _seed;
+	};
+
+	// default hasher of the bl hash containers. unknown types go through std::hash and get their bits remixed,
+	// so weak user hashes (identity, low entropy) still spread over open addressing tables
+	template<typename t_key, typename t_enable = void>
+	struct hash : hasher_base
+	{
+		using hasher_base::hasher_base;
+
+		size_t operator()(const t_key& key) const
+		{
+			return static_cast<size_t>(hash_int(static_cast<uint64>(std::hash<t_key>()(key)), _seed));
+		}
+	};
+
+	template<typename t_key>
+	struct hash<t_key, typename std::enable_if<std::is_integral<t_key>::value || std::is_enum<t_key>::value>::type> : hasher_base
+	{
+		using hasher_base::hasher_base;
+
+		size_t operator()(t_key key) const
+		{
+			return static_cast<size_t>(hash_int(static_cast<uint64>(key), _seed));
+		}
+	};
+
+	template<typename t_key>
+	struct hash<t_key, typename std::enable_if<std::is_floating_point<t_key>::value>::type> : hasher_base
+	{
+		using hasher_base::hasher_base;
+
+		size_t operator()(t_key key) const
+		{
+			// +0 and -0 compare equal and must hash equal
+			if(key == 0)
+			{
+				return static_cast<size_t>(hash_int(0, _seed));
+			}
+			return static_cast<size_t>(hash_bytes(&key, sizeof(key), _seed));
+		}
+	};
+
+	template<typename t_key>
+	struct hash<t_key*> : hasher_base
+	{
+		using hasher_base::hasher_base;
+
+		size_t operator()(t_key* key) const
+		{
+			return static_cast<size_t>(hash_int(static_cast<uint64>(reinterpret_cast<uintptr_t>(key)), _seed));
+		}
+	};
+
+	// transparent: lookups with const char* do not build a temporary string
+	template<>
+	struct hash<std::string> : hasher_base
+	{
+		typedef void is_transparent;
+
+		using hasher_base::hasher_base;
+
+		size_t operator()(const std::string& key) const
+		{
+			return static_cast<size_t>(hash_bytes(key.data(), key.size(), _seed));
+		}
+
+		size_t operator()(const char* key) const
+		{
+			return static_cast<size_t>(hash_bytes(key, std::strlen(key), _seed));
+		}
+	};
+
+	// default key equality of the bl hash containers, transparent for strings to match hash<std::string>
+	template<typename t_key>
+	struct equal_to : std::equal_to<t_key>
+	{
+	};
+
+	template<>
+	struct equal_to<std::string>
+	{
+		typedef void is_transparent;
+
+		bool operator()(const std::string& a, const std::string& b) const { return a == b; }
+		bool operator()(const std::string& a, const char* b) const { return a == b; }
+		bool operator()(const char* a, const std::string& b) const { return b == a; }
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline uint64 hash_mix(uint64 a, uint64 b)
+	{
+	#if defined(__SIZEOF_INT128__)
+		__extension__ typedef unsigned __int128 uint128;
+		const uint128 r = static_cast<uint128>(a) * b;
+		return static_cast<uint64>(r) ^ static_cast<uint64>(r >> 64);
+	#else
+		const uint64 ha = a >> 32, hb = b >> 32, la = static_cast<uint32>(a), lb = static_cast<uint32>(b);
+		const uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+		const uint64 lo = t + (rm1 << 32);
+		const uint64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl ? 1 : 0) + (lo < t ? 1 : 0);
+		return lo ^ hi;
+	#endif
+	}
+
+	inline uint64 hash_int(uint64 value, uint64 seed)
+	{
+		// a single fold leaves the low bits weakly mixed, the second one gives full avalanche
+		return hash_mix(hash_mix(value ^ seed ^ 0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL), 0x8ebc6af09c88c6e3ULL);
+	}
+} // namespace bl
@@ -0,0 +1,248 @@
+#include <bl/util/histogram.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace bl
+{
+	histogram_layout::histogram_layout(int significant_digits, uint64 highest)
+		: _digits(significant_digits), _sub_bits(1), _highest(highest < 1 ? 1 : highest), _buckets(0)
+	{
+		if(significant_digits < 1 || significant_digits > 5)
+		{
+			throw std::out_of_range("histogram significant digits must be between 1 and 5");
+		}
+
+		// enough sub buckets to tell apart 10^digits values within every power of two
+		uint64 largest_exact = 2;
+		for(int i = 0; i < significant_digits; ++i)
+		{
+			largest_exact *= 10;
+		}
+		while((uint64(1) << _sub_bits) < largest_exact)
+		{
+			++_sub_bits;
+		}
+		_buckets = index(_highest) + 1;
+	}
+
+	size_t histogram_layout::bucket_count() const
+	{
+		return _buckets;
+	}
+
+	uint64 histogram_layout::highest() const
+	{
+		return _highest;
+	}
+
+	int histogram_layout::significant_digits() const
+	{
+		return _digits;
+	}
+
+	uint64 histogram_layout::lowest_value(size_t index) const
+	{
+		if(index < (size_t(1) << _sub_bits))
+		{
+			return index;
+		}
+		const size_t shift = (index >> (_sub_bits - 1)) - 1;
+		return static_cast<uint64>(index - (shift << (_sub_bits - 1))) << shift;
+	}
+
+	uint64 histogram_layout::highest_value(size_t index) const
+	{
+		return index + 1 >= _buckets ? _highest : lowest_value(index + 1) - 1;
+	}
+
+	bool histogram_layout::operator==(const histogram_layout& other) const
+	{
+		return _sub_bits == other._sub_bits && _buckets == other._buckets;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	histogram::histogram(int significant_digits, uint64 highest)
+		: histogram(histogram_layout(significant_digits, highest))
+	{
+	}
+
+	histogram::histogram(const histogram_layout& layout)
+		: _layout(layout), _counts(layout.bucket_count(), 0), _total(0), _min(std::numeric_limits<uint64>::max()), _max(0), _sum(0)
+	{
+	}
+
+	void histogram::merge(const histogram& other)
+	{
+		if(other._total == 0)
+		{
+			return;
+		}
+		if(_layout == other._layout)
+		{
+			for(size_t i = 0; i < _counts.size(); ++i)
+			{
+				_counts[i] += other._counts[i];
+			}
+		}
+		else
+		{
+			for(size_t i = 0; i < other._counts.size(); ++i)
+			{
+				if(other._counts[i] != 0)
+				{
+					_counts[_layout.index(other._layout.lowest_value(i))] += other._counts[i];
+				}
+			}
+		}
+		_total += other._total;
+		_sum += other._sum;
+		_min = other._min < _min ? other._min : _min;
+		_max = other._max > _max ? other._max : _max;
+	}
+
+	void histogram::reset()
+	{
+		std::fill(_counts.begin(), _counts.end(), 0);
+		_total = 0;
+		_min = std::numeric_limits<uint64>::max();
+		_max = 0;
+		_sum = 0;
+	}
+
+	const histogram_layout& histogram::layout() const
+	{
+		return _layout;
+	}
+
+	uint64 histogram::count() const
+	{
+		return _total;
+	}
+
+	uint64 histogram::min() const
+	{
+		return _total == 0 ? 0 : _min;
+	}
+
+	uint64 histogram::max() const
+	{
+		return _max;
+	}
+
+	double histogram::mean() const
+	{
+		return _total == 0 ? 0.0 : _sum / static_cast<double>(_total);
+	}
+
+	uint64 histogram::value_at_percentile(double percentile) const
+	{
+		if(_total == 0)
+		{
+			return 0;
+		}
+		if(percentile <= 0)
+		{
+			return _min;
+		}
+		const double clamped = percentile > 100 ? 100 : percentile;
+		uint64 target = static_cast<uint64>(std::ceil(clamped / 100 * static_cast<double>(_total)));
+		target = target < 1 ? 1 : target;
+
+		uint64 seen = 0;
+		for(size_t i = 0; i < _counts.size(); ++i)
+		{
+			seen += _counts[i];
+			if(seen >= target)
+			{
+				const uint64 value = _layout.highest_value(i);
+				return value < _max ? value : _max;
+			}
+		}
+		return _max;
+	}
+
+	uint64 histogram::bucket(size_t index) const
+	{
+		return _counts[index];
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	concurrent_histogram::shard::shard(size_t buckets)
+		: counts(buckets), min(std::numeric_limits<uint64>::max()), max(0), sum(0)
+	{
+		for(atomic<uint64>& c : counts)
+		{
+			c.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	concurrent_histogram::concurrent_histogram(int significant_digits, uint64 highest)
+		: _layout(significant_digits, highest)
+	{
+		for(atomic<shard*>& s : _shards)
+		{
+			s.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	concurrent_histogram::~concurrent_histogram()
+	{
+		for(atomic<shard*>& s : _shards)
+		{
+			delete s.load(std::memory_order_relaxed);
+		}
+	}
+
+	histogram concurrent_histogram::snapshot() const
+	{
+		histogram h(_layout);
+		for(const atomic<shard*>& slot : _shards)
+		{
+			const shard* s = slot.load(std::memory_order_acquire);
+			if(s == nullptr)
+			{
+				continue;
+			}
+			for(size_t i = 0; i < h._counts.size(); ++i)
+			{
+				const uint64 c = s->counts[i].load(std::memory_order_relaxed);
+				h._counts[i] += c;
+				h._total += c;
+			}
+			h._sum += static_cast<double>(s->sum.load(std::memory_order_relaxed));
+			const uint64 low = s->min.load(std::memory_order_relaxed);
+			const uint64 high = s->max.load(std::memory_order_relaxed);
+			h._min = low < h._min ? low : h._min;
+			h._max = high > h._max ? high : h._max;
+		}
+		return h;
+	}
+
+	void concurrent_histogram::reset()
+	{
+		for(atomic<shard*>& slot : _shards)
+		{
+			shard* s = slot.load(std::memory_order_acquire);
+			if(s == nullptr)
+			{
+				continue;
+			}
+			for(atomic<uint64>& c : s->counts)
+			{
+				c.store(0, std::memory_order_relaxed);
+			}
+			s->min.store(std::numeric_limits<uint64>::max(), std::memory_order_relaxed);
+			s->max.store(0, std::memory_order_relaxed);
+			s->sum.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	const histogram_layout& concurrent_histogram::layout() const
+	{
+		return _layout;
+	}
+} // namespace bl
@@ -0,0 +1,222 @@
+#pragma once
+#include <bl/util/atomic.h>
+#include <bl/util/integer.h>
+#include <bl/util/platform.h>
+#include <bl/util/thread.h>
+#include <bl/util/timer.h>
+#include <cstddef>
+#include <vector>
+
+namespace bl
+{
+	// log-linear bucket layout shared by the histograms: values below 2^sub_bits have a bucket each, above that every
+	// power of two is split into 2^(sub_bits - 1) buckets, so a bucket is never wider than 1 / 2^(sub_bits - 1) of its
+	// values. recording is a count leading zeros and a shift
+	// ref: http://hdrhistogram.org
+	class histogram_layout
+	{
+	public:
+		// significant_digits (1 to 5) of decimal precision kept for every value up to highest
+		explicit histogram_layout(int significant_digits = 3, uint64 highest = 3600000000000ULL);
+
+		size_t bucket_count() const;
+		uint64 highest() const;
+		int significant_digits() const;
+
+		// values above highest land in the last bucket
+		size_t index(uint64 value) const;
+		uint64 lowest_value(size_t index) const;
+		uint64 highest_value(size_t index) const;
+
+		bool operator==(const histogram_layout& other) const;
+
+	private:
+		int _digits;
+		unsigned _sub_bits;
+		uint64 _highest;
+		size_t _buckets;
+	};
+
+	// histogram owned by one thread at a time
+	class histogram
+	{
+	public:
+		explicit histogram(int significant_digits = 3, uint64 highest = 3600000000000ULL);
+		explicit histogram(const histogram_layout& layout);
+
+		void record(uint64 value);
+		void record(uint64 value, uint64 count);
+
+		// adds the other counts. with a different layout its buckets are recorded at their lowest value
+		void merge(const histogram& other);
+		void reset();
+
+		const histogram_layout& layout() const;
+		uint64 count() const;
+		uint64 min() const; // exact, 0 when empty
+		uint64 max() const; // exact, 0 when empty
+		double mean() const;
+
+		// highest value equivalent to the one below which percentile % (0 to 100) of the recorded values are
+		uint64 value_at_percentile(double percentile) const;
+		uint64 bucket(size_t index) const;
+
+	private:
+		friend class concurrent_histogram;
+
+		histogram_layout _layout;
+		std::vector<uint64> _counts;
+		uint64 _total;
+		uint64 _min;
+		uint64 _max;
+		double _sum;
+	};
+
+	// histogram recorded into from any number of threads without locking. every thread counts into the shard of its
+	// thread index (shards are created on first use), snapshot() merges the shards
+	class concurrent_histogram
+	{
+	public:
+		explicit concurrent_histogram(int significant_digits = 3, uint64 highest = 3600000000000ULL);
+		~concurrent_histogram();
+
+		concurrent_histogram(const concurrent_histogram&) = delete;
+		concurrent_histogram& operator=(const concurrent_histogram&) = delete;
+
+		void record(uint64 value);
+
+		// counts recorded so far, recording may continue meanwhile
+		histogram snapshot() const;
+
+		// not concurrently with record()
+		void reset();
+
+		const histogram_layout& layout() const;
+
+	private:
+		struct shard
+		{
+			explicit shard(size_t buckets);
+
+			std::vector<atomic<uint64>> counts;
+			atomic<uint64> min;
+			atomic<uint64> max;
+			atomic<uint64> sum;
+		};
+
+		static const unsigned shard_count = 64;
+
+		shard* _shard();
+
+		histogram_layout _layout;
+		atomic<shard*> _shards[shard_count];
+	};
+
+	// records the nanoseconds from construction to destruction
+	class scoped_latency
+	{
+	public:
+		explicit scoped_latency(histogram& h);
+		explicit scoped_latency(concurrent_histogram& h);
+		~scoped_latency();
+
+		scoped_latency(const scoped_latency&) = delete;
+		scoped_latency& operator=(const scoped_latency&) = delete;
+
+	private:
+		histogram* _histogram;
+		concurrent_histogram* _concurrent;
+		timer _timer;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline size_t histogram_layout::index(uint64 value) const
+	{
+		if(value > _highest)
+		{
+			value = _highest;
+		}
+		if(value < (uint64(1) << _sub_bits))
+		{
+			return static_cast<size_t>(value);
+		}
+		const unsigned shift = static_cast<unsigned>(63 - __builtin_clzll(value)) - (_sub_bits - 1);
+		return (static_cast<size_t>(shift) << (_sub_bits - 1)) + static_cast<size_t>(value >> shift);
+	}
+
+	inline void histogram::record(uint64 value)
+	{
+		record(value, 1);
+	}
+
+	inline void histogram::record(uint64 value, uint64 count)
+	{
+		_counts[_layout.index(value)] += count;
+		_total += count;
+		_sum += static_cast<double>(value) * static_cast<double>(count);
+		if(value < _min)
+		{
+			_min = value;
+		}
+		if(value > _max)
+		{
+			_max = value;
+		}
+	}
+
+	inline void concurrent_histogram::record(uint64 value)
+	{
+		shard* s = _shard();
+		s->counts[_layout.index(value)].fetch_add(1, std::memory_order_relaxed);
+		s->sum.fetch_add(value, std::memory_order_relaxed);
+		uint64 current = s->min.load(std::memory_order_relaxed);
+		while(value < current && !s->min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{
+		}
+		current = s->max.load(std::memory_order_relaxed);
+		while(value > current && !s->max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	inline concurrent_histogram::shard* concurrent_histogram::_shard()
+	{
+		atomic<shard*>& slot = _shards[this_thread_index() % shard_count];
+		shard* s = slot.load(std::memory_order_acquire);
+		if(s != nullptr)
+		{
+			return s;
+		}
+		shard* created = new shard(_layout.bucket_count());
+		if(slot.compare_exchange_strong(s, created, std::memory_order_acq_rel))
+		{
+			return created;
+		}
+		delete created;
+		return s;
+	}
+
+	inline scoped_latency::scoped_latency(histogram& h)
+		: _histogram(&h), _concurrent(nullptr)
+	{
+	}
+
+	inline scoped_latency::scoped_latency(concurrent_histogram& h)
+		: _histogram(nullptr), _concurrent(&h)
+	{
+	}
+
+	inline scoped_latency::~scoped_latency()
+	{
+		const uint64 ns = static_cast<uint64>(_timer.nanoseconds());
+		if(_histogram != nullptr)
+		{
+			_histogram->record(ns);
+		}
+		else
+		{
+			_concurrent->record(ns);
+		}
+	}
+} // namespace bl
@@ -0,0 +1,40 @@
+#include <bl/util/memory.h>
+#include <bl/util/platform.h>
+
+#if defined(BL_OS_WIN)
+#include <malloc.h>
+#elif defined(BL_OS_LINUX)
+#include <stdlib.h>
+#else
+#error "Unsupported operating system."
+#endif
+
+namespace bl
+{
+	void* aligned_malloc(size_t size, size_t alignment)
+	{
+	#if defined(BL_OS_WIN)
+		return _aligned_malloc(size, alignment);
+	#elif defined(BL_OS_LINUX)
+		void* ptr = nullptr;
+		if(posix_memalign(&ptr, alignment, size) != 0)
+		{
+			return nullptr;
+		}
+		return ptr;
+	#else
+	#error "Unsupported operating system."
+	#endif
+	}
+
+	void aligned_free(void* ptr)
+	{
+	#if defined(BL_OS_WIN)
+		_aligned_free(ptr);
+	#elif defined(BL_OS_LINUX)
+		free(ptr);
+	#else
+	#error "Unsupported operating system."
+	#endif
+	}
+} // namespace bl
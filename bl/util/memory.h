@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <memory>
 #include <type_traits>
 #include <utility>
@@ -41,4 +42,21 @@ namespace bl
 
 	template<typename t_value, typename ...t_args>
 	typename _unique_if<t_value>::_known_bound make_unique(t_args&&...) = delete;
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// aligned memory
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// alignment must be a power of two multiple of sizeof(void*), returns nullptr on failure
+	void* aligned_malloc(size_t size, size_t alignment);
+	void aligned_free(void* ptr);
+
+	// unique_ptr deleter for memory from aligned_malloc
+	struct aligned_deleter
+	{
+		void operator()(void* ptr) const
+		{
+			aligned_free(ptr);
+		}
+	};
 } // namespace bl
@@ -0,0 +1,248 @@
+#pragma once
+#include <bl/util/atomic.h>
+#include <bl/util/platform.h>
+#include <bl/util/thread.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bl
+{
+	// fixed-size object allocator: slots are carved from slabs and recycled through an intrusive free list.
+	// each thread works on its own magazine (a small private free list selected by this_thread_index()),
+	// the shared free list and its mutex are only touched to refill or drain a magazine.
+	template<typename t_value>
+	class object_pool
+	{
+	public:
+		struct statistics
+		{
+			size_t live;             // objects currently allocated
+			size_t peak_checked_out; // high-water mark of slots out of the shared free list, in use or cached by magazines
+			size_t slabs;            // slabs allocated so far
+		};
+
+		// slots_per_slab is clamped to at least 1
+		explicit object_pool(size_t slots_per_slab = 256);
+
+		// releases every slab, objects still alive are not destroyed
+		~object_pool();
+
+		object_pool(const object_pool&) = delete;
+		object_pool& operator=(const object_pool&) = delete;
+
+		template<typename ...t_args>
+		t_value* create(t_args&& ...args);
+		void destroy(t_value* ptr);
+
+		// raw slot of sizeof(t_value) bytes
+		void* allocate();
+		void deallocate(void* ptr);
+
+		statistics stats() const;
+
+	private:
+		union slot
+		{
+			slot* next;
+			typename std::aligned_storage<sizeof(t_value), alignof(t_value)>::type storage;
+		};
+
+		struct magazine
+		{
+			std::atomic_flag busy;
+			slot* head;
+			size_t count;
+			atomic<size_t> allocated;
+			atomic<size_t> freed;
+			char pad[BL_CACHE_LINE_SIZE];
+		};
+
+		static const unsigned magazine_count = 16;
+		static const size_t magazine_capacity = 64;
+
+		magazine& _lock_magazine();
+		void _unlock_magazine(magazine& m);
+		void _refill(magazine& m);
+		void _drain(magazine& m, size_t n);
+
+		magazine _magazines[magazine_count];
+
+		mutable mutex _mutex;
+		slot* _free;
+		std::vector<slot*> _slabs;
+		size_t _slots_per_slab;
+		size_t _checked_out;
+		size_t _peak_checked_out;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	object_pool<t_value>::object_pool(size_t slots_per_slab)
+		: _free(nullptr), _slots_per_slab(slots_per_slab > 0 ? slots_per_slab : 1), _checked_out(0), _peak_checked_out(0)
+	{
+		for(auto& m : _magazines)
+		{
+			m.busy.clear();
+			m.head = nullptr;
+			m.count = 0;
+			m.allocated.store(0, std::memory_order_relaxed);
+			m.freed.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	template<typename t_value>
+	object_pool<t_value>::~object_pool()
+	{
+		for(auto s : _slabs)
+		{
+			::operator delete(s);
+		}
+	}
+
+	template<typename t_value>
+	template<typename ...t_args>
+	t_value* object_pool<t_value>::create(t_args&& ...args)
+	{
+		void* ptr = allocate();
+		try
+		{
+			return new(ptr) t_value(std::forward<t_args>(args)...);
+		}
+		catch(...)
+		{
+			deallocate(ptr);
+			throw;
+		}
+	}
+
+	template<typename t_value>
+	void object_pool<t_value>::destroy(t_value* ptr)
+	{
+		if(ptr != nullptr)
+		{
+			ptr->~t_value();
+			deallocate(ptr);
+		}
+	}
+
+	template<typename t_value>
+	void* object_pool<t_value>::allocate()
+	{
+		magazine& m = _lock_magazine();
+		if(m.head == nullptr)
+		{
+			_refill(m);
+		}
+		slot* s = m.head;
+		m.head = s->next;
+		--m.count;
+		m.allocated.store(m.allocated.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		_unlock_magazine(m);
+		return s;
+	}
+
+	template<typename t_value>
+	void object_pool<t_value>::deallocate(void* ptr)
+	{
+		slot* s = static_cast<slot*>(ptr);
+		magazine& m = _lock_magazine();
+		s->next = m.head;
+		m.head = s;
+		++m.count;
+		m.freed.store(m.freed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if(m.count > magazine_capacity)
+		{
+			_drain(m, magazine_capacity / 2);
+		}
+		_unlock_magazine(m);
+	}
+
+	template<typename t_value>
+	typename object_pool<t_value>::statistics object_pool<t_value>::stats() const
+	{
+		statistics st;
+		size_t allocated = 0;
+		size_t freed = 0;
+		for(const auto& m : _magazines)
+		{
+			// read freed first so a concurrent free of a just allocated object cannot make live underflow
+			freed += m.freed.load(std::memory_order_relaxed);
+			allocated += m.allocated.load(std::memory_order_relaxed);
+		}
+		st.live = allocated > freed ? allocated - freed : 0;
+
+		mutex_lock l(_mutex);
+		st.peak_checked_out = _peak_checked_out;
+		st.slabs = _slabs.size();
+		return st;
+	}
+
+	template<typename t_value>
+	typename object_pool<t_value>::magazine& object_pool<t_value>::_lock_magazine()
+	{
+		magazine& m = _magazines[this_thread_index() % magazine_count];
+		while(m.busy.test_and_set(std::memory_order_acquire))
+		{
+			cpu_pause();
+		}
+		return m;
+	}
+
+	template<typename t_value>
+	void object_pool<t_value>::_unlock_magazine(magazine& m)
+	{
+		m.busy.clear(std::memory_order_release);
+	}
+
+	template<typename t_value>
+	void object_pool<t_value>::_refill(magazine& m)
+	{
+		mutex_lock l(_mutex);
+		if(_free == nullptr)
+		{
+			slot* slab = static_cast<slot*>(::operator new(sizeof(slot) * _slots_per_slab));
+			for(size_t i = 0; i + 1 < _slots_per_slab; ++i)
+			{
+				slab[i].next = &slab[i+1];
+			}
+			slab[_slots_per_slab-1].next = nullptr;
+			_slabs.push_back(slab);
+			_free = slab;
+		}
+
+		size_t n = 0;
+		while(_free != nullptr && n < magazine_capacity / 2)
+		{
+			slot* s = _free;
+			_free = s->next;
+			s->next = m.head;
+			m.head = s;
+			++n;
+		}
+		m.count += n;
+
+		_checked_out += n;
+		if(_checked_out > _peak_checked_out)
+		{
+			_peak_checked_out = _checked_out;
+		}
+	}
+
+	template<typename t_value>
+	void object_pool<t_value>::_drain(magazine& m, size_t n)
+	{
+		mutex_lock l(_mutex);
+		for(size_t i = 0; i < n; ++i)
+		{
+			slot* s = m.head;
+			m.head = s->next;
+			s->next = _free;
+			_free = s;
+		}
+		m.count -= n;
+		_checked_out -= n;
+	}
+} // namespace bl
@@ -0,0 +1,169 @@
+#include <bl/util/observer.h>
+#include <bl/util/thread_pool.h>
+
+namespace bl
+{
+	bool notification_queue::key::operator==(const key& other) const
+	{
+		return std::memcmp(this, &other, sizeof(key)) == 0;
+	}
+
+	size_t notification_queue::key_hash::operator()(const key& k) const
+	{
+		return static_cast<size_t>(hash_bytes(&k, sizeof(k), _seed));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	notification_queue::notification_queue()
+		: _flushing(false), _pool(nullptr), _scheduled(false), _running(0)
+	{
+	}
+
+	notification_queue::notification_queue(thread_pool& pool)
+		: _flushing(false), _pool(&pool), _scheduled(false), _running(0)
+	{
+	}
+
+	notification_queue::~notification_queue()
+	{
+		if(_pool != nullptr)
+		{
+			_pool->wait_until([this]()
+			{
+				return _running.load(std::memory_order_acquire) == 0;
+			});
+		}
+	}
+
+	void notification_queue::cancel(const void* subject)
+	{
+		std::lock_guard<std::recursive_mutex> f(_flush_mutex);
+		for(entry& e : _batch)
+		{
+			if(e.k.subject == subject)
+			{
+				e.call = nullptr;
+			}
+		}
+
+		mutex_lock l(_mutex);
+		const size_t count = _pending.size();
+		for(size_t i = count; i-- > 0;)
+		{
+			if(_pending[i].k.subject == subject)
+			{
+				_pending.erase(_pending.begin() + static_cast<std::ptrdiff_t>(i));
+			}
+		}
+		if(_pending.size() != count)
+		{
+			_reindex();
+		}
+	}
+
+	size_t notification_queue::flush(size_t max_count)
+	{
+		std::lock_guard<std::recursive_mutex> f(_flush_mutex);
+		if(_flushing)
+		{
+			// flush() called by an observer, the outer flush owns the batch
+			return 0;
+		}
+
+		{
+			mutex_lock l(_mutex);
+			if(max_count >= _pending.size())
+			{
+				_batch.swap(_pending);
+				_index.clear();
+			}
+			else
+			{
+				_batch.assign(std::make_move_iterator(_pending.begin()), std::make_move_iterator(_pending.begin() + static_cast<std::ptrdiff_t>(max_count)));
+				_pending.erase(_pending.begin(), _pending.begin() + static_cast<std::ptrdiff_t>(max_count));
+				_reindex();
+			}
+		}
+
+		// also reset when an observer throws, otherwise every later flush would see _flushing and return 0
+		struct flushing_scope
+		{
+			explicit flushing_scope(notification_queue& q) : queue(q) { queue._flushing = true; }
+			~flushing_scope()
+			{
+				queue._batch.clear();
+				queue._flushing = false;
+			}
+
+			flushing_scope(const flushing_scope&) = delete;
+			flushing_scope& operator=(const flushing_scope&) = delete;
+
+			notification_queue& queue;
+		};
+
+		flushing_scope scope(*this);
+		size_t dispatched = 0;
+		for(size_t i = 0; i < _batch.size(); ++i)
+		{
+			// moved out first, a canceled call must not be destroyed while it runs
+			function<void()> call = std::move(_batch[i].call);
+			_batch[i].call = nullptr;
+			if(call)
+			{
+				call();
+				++dispatched;
+			}
+		}
+		return dispatched;
+	}
+
+	size_t notification_queue::pending() const
+	{
+		mutex_lock l(_mutex);
+		return _pending.size();
+	}
+
+	void notification_queue::_post(const key& k, function<void()>&& call)
+	{
+		{
+			mutex_lock l(_mutex);
+			auto it = _index.find(k);
+			if(it != _index.end())
+			{
+				_pending[it->second].call = std::move(call);
+			}
+			else
+			{
+				_index.emplace(k, _pending.size());
+				_pending.push_back(entry{k, std::move(call)});
+			}
+		}
+		_schedule();
+	}
+
+	void notification_queue::_schedule()
+	{
+		if(_pool == nullptr || _scheduled.exchange(true, std::memory_order_acq_rel))
+		{
+			return;
+		}
+
+		_running.fetch_add(1, std::memory_order_relaxed);
+		_pool->submit([this]()
+		{
+			_scheduled.store(false, std::memory_order_release);
+			flush();
+			_running.fetch_sub(1, std::memory_order_release);
+		});
+	}
+
+	void notification_queue::_reindex()
+	{
+		_index.clear();
+		for(size_t i = 0; i < _pending.size(); ++i)
+		{
+			_index.emplace(_pending[i].k, i);
+		}
+	}
+} // namespace bl
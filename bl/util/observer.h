@@ -1,28 +1,128 @@
 #pragma once
-#include <bl/util/array.h>
+#include <bl/util/atomic.h>
+#include <bl/util/flat_hash.h>
+#include <bl/util/function.h>
+#include <bl/util/hash_function.h>
+#include <bl/util/integer.h>
+#include <bl/util/rcu.h>
+#include <bl/util/thread.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 namespace bl
 {
+	class thread_pool;
+
 	template<typename t_observer>
 	class observer_base;
 
+	// pending notifications of subjects in deferred mode. posting the same (subject, method) again before a flush only
+	// replaces the arguments of the pending notification, which keeps its place in the queue. flush() dispatches in post
+	// order to the observers registered at that time. flushed by the owner (e.g. once per frame) or, when constructed
+	// with a thread pool, automatically on a worker. in that mode observers must be thread safe and the observer lists
+	// of the subjects posting to the queue are frozen: they are read on the worker without a lock, so add_observer and
+	// remove_observer must not be called while notifications are pending or being flushed
+	class notification_queue
+	{
+	public:
+		notification_queue();
+		explicit notification_queue(thread_pool& pool);
+
+		// waits for a running automatic flush, pending notifications are dropped
+		~notification_queue();
+
+		notification_queue(const notification_queue&) = delete;
+		notification_queue& operator=(const notification_queue&) = delete;
+
+		template<typename t_method>
+		void post(const void* subject, t_method method, function<void()> call);
+
+		// drops the pending notifications of a subject, waits if they are being dispatched on another thread
+		void cancel(const void* subject);
+
+		// dispatches at most max_count notifications, returns how many were dispatched.
+		// notifications posted by observers meanwhile wait for the next flush. when an observer throws, the exception
+		// propagates and the rest of the batch is dropped
+		size_t flush(size_t max_count = static_cast<size_t>(-1));
+
+		size_t pending() const;
+
+	private:
+		// identifies a (subject, method) pair: the method pointer bytes plus a tag per method pointer type
+		struct key
+		{
+			const void* subject;
+			const void* type;
+			uint64 method[3];
+
+			bool operator==(const key& other) const;
+		};
+
+		struct key_hash : hasher_base
+		{
+			size_t operator()(const key& k) const;
+		};
+
+		struct entry
+		{
+			key k;
+			function<void()> call;
+		};
+
+		template<typename t_method>
+		struct method_tag
+		{
+			static const char id;
+		};
+
+		void _post(const key& k, function<void()>&& call);
+		void _schedule();
+		void _reindex();
+
+		mutable mutex _mutex;
+		std::vector<entry> _pending;
+		flat_hash_map<key, size_t, key_hash> _index; // pending entry of each key
+
+		std::recursive_mutex _flush_mutex; // held while dispatching, cancel may be called from an observer
+		std::vector<entry> _batch;
+		bool _flushing;
+
+		thread_pool* _pool;
+		atomic<bool> _scheduled;
+		atomic<int> _running;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
 	template<typename t_observer>
 	class subject_base
 	{
 		friend class observer_base<t_observer>;
 
 	public:
+		subject_base();
 		virtual ~subject_base();
 
 		virtual void add_observer(t_observer* observer);
 		virtual void remove_observer(t_observer* observer);
 
+		// deferred mode: notify() copies its arguments into queue instead of calling the observers, nullptr goes back to
+		// immediate calls. the queue must outlive the subject, or the subject must detach first with nullptr, because
+		// switching queues and destroying the subject cancel its pending notifications on the old queue
+		void set_notification_queue(notification_queue* queue);
+
 	protected:
 		template<typename t_observer_method, typename ...t_args>
 		void notify(t_observer_method method, t_args&& ...args);
 
+		// calls the observers at once, also in deferred mode
+		template<typename t_observer_method, typename ...t_args>
+		void notify_now(t_observer_method method, t_args&& ...args);
+
 	private:
-		array<t_observer*> _observers;
+		std::vector<t_observer*> _observers;
+		notification_queue* _queue;
 	};
 
 	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -39,14 +139,77 @@ namespace bl
 		void _add_subject(subject_base<t_observer>* subject);
 		void _remove_subject(subject_base<t_observer>* subject);
 
-		array<subject_base<t_observer>*> _subjects;
+		std::vector<subject_base<t_observer>*> _subjects;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// subject whose observers can be added, removed and notified from any thread. the observer list is an immutable
+	// snapshot replaced on every change (copy on write), notify() walks the current one inside an rcu read section without
+	// taking a lock. observers are not linked back to the subject: remove them before destroying them
+	template<typename t_observer>
+	class concurrent_subject
+	{
+	public:
+		concurrent_subject();
+		virtual ~concurrent_subject();
+
+		concurrent_subject(const concurrent_subject&) = delete;
+		concurrent_subject& operator=(const concurrent_subject&) = delete;
+
+		void add_observer(t_observer* observer);
+
+		// once it returned no notify() is calling the observer any more, so it may be destroyed.
+		// from inside a notification (or any rcu read section) it returns at once without that guarantee: other threads
+		// may still be notifying the observer, destroy it with rcu_retire()
+		void remove_observer(t_observer* observer);
+
+		size_t observer_count() const;
+
+	protected:
+		// lock free, the arguments are passed as lvalues to every observer
+		template<typename t_observer_method, typename ...t_args>
+		void notify(t_observer_method method, t_args&& ...args) const;
+
+	private:
+		typedef std::vector<t_observer*> snapshot;
+
+		mutex _write_mutex;
+		atomic<const snapshot*> _observers;
 	};
 
 	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
 
+	template<typename t_method>
+	const char notification_queue::method_tag<t_method>::id = 0;
+
+	template<typename t_method>
+	void notification_queue::post(const void* subject, t_method method, function<void()> call)
+	{
+		key k;
+		static_assert(sizeof(method) <= sizeof(k.method), "method pointer too large");
+		k.subject = subject;
+		k.type = &method_tag<t_method>::id;
+		std::memset(k.method, 0, sizeof(k.method));
+		std::memcpy(k.method, &method, sizeof(method));
+		_post(k, std::move(call));
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_observer>
+	subject_base<t_observer>::subject_base()
+		: _queue(nullptr)
+	{
+	}
+
 	template<typename t_observer>
 	subject_base<t_observer>::~subject_base()
 	{
+		if(_queue != nullptr)
+		{
+			_queue->cancel(this);
+		}
 		for(auto observer : _observers)
 		{
 			reinterpret_cast<observer_base<t_observer>*>(observer)->_remove_subject(this);
@@ -57,19 +220,45 @@ namespace bl
 	void subject_base<t_observer>::add_observer(t_observer* observer)
 	{
 		reinterpret_cast<observer_base<t_observer>*>(observer)->_add_subject(this);
-		_observers.add(observer);
+		_observers.push_back(observer);
 	}
 
 	template<typename t_observer>
 	void subject_base<t_observer>::remove_observer(t_observer* observer)
 	{
 		reinterpret_cast<observer_base<t_observer>*>(observer)->_remove_subject(this);
-		_observers.remove_all(observer);
+		_observers.erase(std::remove(_observers.begin(), _observers.end(), observer), _observers.end());
+	}
+
+	template<typename t_observer>
+	void subject_base<t_observer>::set_notification_queue(notification_queue* queue)
+	{
+		if(_queue != nullptr && _queue != queue)
+		{
+			_queue->cancel(this);
+		}
+		_queue = queue;
 	}
 
 	template<typename t_observer>
 	template<typename t_observer_method, typename ...t_args>
 	void subject_base<t_observer>::notify(t_observer_method method, t_args&& ...args)
+	{
+		if(_queue == nullptr)
+		{
+			notify_now(method, std::forward<t_args>(args)...);
+			return;
+		}
+
+		_queue->post(this, method, [this, method, args...]()
+		{
+			notify_now(method, args...);
+		});
+	}
+
+	template<typename t_observer>
+	template<typename t_observer_method, typename ...t_args>
+	void subject_base<t_observer>::notify_now(t_observer_method method, t_args&& ...args)
 	{
 		typename decltype(_observers)::size_type i = 0;
 		while(i < _observers.size())
@@ -90,10 +279,86 @@ namespace bl
 
 	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
 
+	template<typename t_observer>
+	concurrent_subject<t_observer>::concurrent_subject()
+		: _observers(new snapshot())
+	{
+	}
+
+	template<typename t_observer>
+	concurrent_subject<t_observer>::~concurrent_subject()
+	{
+		rcu_retire(_observers.load(std::memory_order_relaxed));
+	}
+
+	template<typename t_observer>
+	void concurrent_subject<t_observer>::add_observer(t_observer* observer)
+	{
+		const snapshot* current;
+		{
+			mutex_lock l(_write_mutex);
+			current = _observers.load(std::memory_order_relaxed);
+			snapshot* next = new snapshot(*current);
+			next->push_back(observer);
+			_observers.store(next, std::memory_order_seq_cst);
+		}
+		// outside the lock, retiring may synchronize with notifications that call add_observer
+		rcu_retire(current);
+	}
+
+	template<typename t_observer>
+	void concurrent_subject<t_observer>::remove_observer(t_observer* observer)
+	{
+		const snapshot* current;
+		{
+			mutex_lock l(_write_mutex);
+			current = _observers.load(std::memory_order_relaxed);
+			if(std::find(current->begin(), current->end(), observer) == current->end())
+			{
+				return;
+			}
+			snapshot* next = new snapshot(*current);
+			next->erase(std::remove(next->begin(), next->end(), observer), next->end());
+			_observers.store(next, std::memory_order_seq_cst);
+		}
+		rcu_retire(current);
+
+		// notifications that still see the old snapshot may be calling the observer. waiting inside a read section could
+		// deadlock with another thread doing the same
+		if(!rcu_in_read_section())
+		{
+			rcu_synchronize();
+		}
+	}
+
+	template<typename t_observer>
+	size_t concurrent_subject<t_observer>::observer_count() const
+	{
+		rcu_read_guard g;
+		return _observers.load(std::memory_order_seq_cst)->size();
+	}
+
+	template<typename t_observer>
+	template<typename t_observer_method, typename ...t_args>
+	void concurrent_subject<t_observer>::notify(t_observer_method method, t_args&& ...args) const
+	{
+		rcu_read_guard g;
+		const snapshot& observers = *_observers.load(std::memory_order_seq_cst);
+		for(t_observer* observer : observers)
+		{
+			(observer->*method)(args...);
+		}
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
 	template<typename t_observer>
 	observer_base<t_observer>::~observer_base()
 	{
-		for(auto subject : _subjects)
+		// remove_observer() calls back into _remove_subject(), walk a copy
+		const std::vector<subject_base<t_observer>*> subjects = std::move(_subjects);
+		_subjects.clear();
+		for(auto subject : subjects)
 		{
 			subject->remove_observer(static_cast<t_observer*>(this));
 		}
@@ -102,12 +367,12 @@ namespace bl
 	template<typename t_observer>
 	void observer_base<t_observer>::_add_subject(subject_base<t_observer>* subject)
 	{
-		_subjects.add(subject);
+		_subjects.push_back(subject);
 	}
 
 	template<typename t_observer>
 	void observer_base<t_observer>::_remove_subject(subject_base<t_observer>* subject)
 	{
-		_subjects.remove_all(subject);
+		_subjects.erase(std::remove(_subjects.begin(), _subjects.end(), subject), _subjects.end());
 	}
 } // namespace bl
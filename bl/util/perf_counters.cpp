@@ -0,0 +1,195 @@
+#include <bl/util/perf_counters.h>
+
+#if defined(BL_OS_LINUX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace bl
+{
+	static size_t s_index(perf_counters::event e)
+	{
+		return static_cast<size_t>(e);
+	}
+
+#if defined(BL_OS_LINUX)
+	static int s_open(uint32 type, uint64 config)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	static uint64 s_cache_miss(uint64 cache)
+	{
+		return cache | (uint64(PERF_COUNT_HW_CACHE_OP_READ) << 8) | (uint64(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+	}
+#endif
+
+	perf_counters::sample::sample()
+	{
+		for(size_t i = 0; i < event_count; ++i)
+		{
+			values[i] = 0;
+			available[i] = false;
+		}
+	}
+
+	uint64 perf_counters::sample::operator[](event e) const
+	{
+		return values[s_index(e)];
+	}
+
+	bool perf_counters::sample::valid(event e) const
+	{
+		return available[s_index(e)];
+	}
+
+	double perf_counters::sample::ipc() const
+	{
+		if(!valid(event::cycles) || !valid(event::instructions) || (*this)[event::cycles] == 0)
+		{
+			return 0;
+		}
+		return static_cast<double>((*this)[event::instructions]) / static_cast<double>((*this)[event::cycles]);
+	}
+
+	perf_counters::sample& perf_counters::sample::operator+=(const sample& other)
+	{
+		for(size_t i = 0; i < event_count; ++i)
+		{
+			values[i] += other.values[i];
+			available[i] = available[i] || other.available[i];
+		}
+		return *this;
+	}
+
+	perf_counters::perf_counters()
+	{
+		for(int& fd : _fds)
+		{
+			fd = -1;
+		}
+	#if defined(BL_OS_LINUX)
+		_fds[s_index(event::cycles)] = s_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		_fds[s_index(event::instructions)] = s_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		_fds[s_index(event::branch_misses)] = s_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+		_fds[s_index(event::l1d_misses)] = s_open(PERF_TYPE_HW_CACHE, s_cache_miss(PERF_COUNT_HW_CACHE_L1D));
+		_fds[s_index(event::llc_misses)] = s_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		_fds[s_index(event::dtlb_misses)] = s_open(PERF_TYPE_HW_CACHE, s_cache_miss(PERF_COUNT_HW_CACHE_DTLB));
+	#endif
+	}
+
+	perf_counters::~perf_counters()
+	{
+	#if defined(BL_OS_LINUX)
+		for(int fd : _fds)
+		{
+			if(fd >= 0)
+			{
+				close(fd);
+			}
+		}
+	#endif
+	}
+
+	void perf_counters::start()
+	{
+	#if defined(BL_OS_LINUX)
+		for(int fd : _fds)
+		{
+			if(fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+	#endif
+	}
+
+	void perf_counters::stop()
+	{
+	#if defined(BL_OS_LINUX)
+		for(int fd : _fds)
+		{
+			if(fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			}
+		}
+	#endif
+	}
+
+	perf_counters::sample perf_counters::read() const
+	{
+		sample s;
+	#if defined(BL_OS_LINUX)
+		for(size_t i = 0; i < event_count; ++i)
+		{
+			// value, time enabled, time running
+			uint64 data[3];
+			if(_fds[i] < 0 || ::read(_fds[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)))
+			{
+				continue;
+			}
+			if(data[2] == 0)
+			{
+				// enabled but never scheduled on the pmu
+				s.available[i] = data[1] == 0;
+				continue;
+			}
+			s.values[i] = data[2] < data[1] ? static_cast<uint64>(static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2])) : data[0];
+			s.available[i] = true;
+		}
+	#endif
+		return s;
+	}
+
+	bool perf_counters::available() const
+	{
+		for(int fd : _fds)
+		{
+			if(fd >= 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool perf_counters::available(event e) const
+	{
+		return _fds[s_index(e)] >= 0;
+	}
+
+	const char* perf_counters::name(event e)
+	{
+		switch(e)
+		{
+			case event::cycles:
+				return "cycles";
+			case event::instructions:
+				return "instructions";
+			case event::branch_misses:
+				return "branch-misses";
+			case event::l1d_misses:
+				return "L1d-misses";
+			case event::llc_misses:
+				return "LLC-misses";
+			case event::dtlb_misses:
+				return "dTLB-misses";
+			default:
+				return "unknown";
+		}
+	}
+} // namespace bl
@@ -0,0 +1,60 @@
+#pragma once
+#include <bl/util/integer.h>
+#include <bl/util/platform.h>
+#include <cstddef>
+
+namespace bl
+{
+	// hardware event counters of the calling thread (user space only), opened for the lifetime of the object.
+	// on linux every event is its own perf_event_open counter, so an event the cpu or the kernel refuses (no pmu in a vm,
+	// perf_event_paranoid too strict) is just unavailable and reads as 0. elsewhere nothing is available
+	class perf_counters
+	{
+	public:
+		enum class event
+		{
+			cycles,
+			instructions,
+			branch_misses,
+			l1d_misses,
+			llc_misses,
+			dtlb_misses
+		};
+
+		static const size_t event_count = 6;
+
+		struct sample
+		{
+			sample();
+
+			uint64 operator[](event e) const;
+			bool valid(event e) const;
+			double ipc() const; // instructions per cycle, 0 without both counters
+			sample& operator+=(const sample& other);
+
+			uint64 values[event_count];
+			bool available[event_count];
+		};
+
+		perf_counters();
+		~perf_counters();
+
+		perf_counters(const perf_counters&) = delete;
+		perf_counters& operator=(const perf_counters&) = delete;
+
+		// zero and enable the counters
+		void start();
+		void stop();
+
+		// counts since start(), scaled up when the kernel had to multiplex the counters
+		sample read() const;
+
+		bool available() const;
+		bool available(event e) const;
+
+		static const char* name(event e);
+
+	private:
+		int _fds[event_count];
+	};
+} // namespace bl
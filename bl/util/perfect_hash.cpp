@@ -0,0 +1,474 @@
+#include <bl/util/perfect_hash.h>
+#include <bl/util/atomic.h>
+#include <bl/util/thread.h>
+#include <algorithm>
+
+namespace bl
+{
+	static const uint64 s_magic = 0x314850484c42ULL; // "BLHPH1"
+	static const size_t s_partition_keys = 4096;
+	static const uint64 s_max_pilot = 0xffff;
+	static const uint64 s_max_attempts = 64;
+
+	static uint64 mul_hi(uint64 a, uint64 b)
+	{
+	#if defined(__SIZEOF_INT128__)
+		__extension__ typedef unsigned __int128 uint128;
+		return static_cast<uint64>((static_cast<uint128>(a) * b) >> 64);
+	#else
+		const uint64 ha = a >> 32, hb = b >> 32, la = static_cast<uint32>(a), lb = static_cast<uint32>(b);
+		const uint64 rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+		const uint64 mid = (rl >> 32) + static_cast<uint32>(rm0) + static_cast<uint32>(rm1);
+		return ha * hb + (rm0 >> 32) + (rm1 >> 32) + (mid >> 32);
+	#endif
+	}
+
+	static size_t pad8(size_t bytes)
+	{
+		return (bytes + 7) & ~static_cast<size_t>(7);
+	}
+
+	// three independent hashes: partition, bucket and position
+	static uint64 hash_partition(uint64 key, uint64 seed) { return hash_int(key, seed); }
+	static uint64 hash_bucket(uint64 key, uint64 seed) { return hash_int(key, seed + 1); }
+	static uint64 hash_position(uint64 key, uint64 seed) { return hash_int(key, seed + 2); }
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	perfect_hash::perfect_hash()
+	{
+		_reset();
+	}
+
+	perfect_hash::perfect_hash(perfect_hash&& other)
+		: _storage(std::move(other._storage)), _data(other._data), _data_size(other._data_size),
+		  _header(other._header), _partitions(other._partitions), _pilots(other._pilots), _remap(other._remap)
+	{
+		other._reset();
+	}
+
+	perfect_hash& perfect_hash::operator=(perfect_hash&& other)
+	{
+		if(this != &other)
+		{
+			_storage = std::move(other._storage);
+			_data = other._data;
+			_data_size = other._data_size;
+			_header = other._header;
+			_partitions = other._partitions;
+			_pilots = other._pilots;
+			_remap = other._remap;
+			other._reset();
+		}
+		return *this;
+	}
+
+	bool perfect_hash::build(const uint64* keys, size_t count, unsigned threads)
+	{
+		if(!_build(keys, count, threads, hash_int(count, s_magic)))
+		{
+			_reset();
+			return false;
+		}
+		return true;
+	}
+
+	size_t perfect_hash::operator()(uint64 key) const
+	{
+		const size_t p = static_cast<size_t>(mul_hi(hash_partition(key, _header->seed), _header->partitions));
+		const partition& part = _partitions[p];
+		const uint64 seed = part.seed;
+		const size_t n = static_cast<size_t>(_partitions[p+1].offset - part.offset);
+		if(n == 0)
+		{
+			return 0;
+		}
+
+		const size_t bucket = _bucket(hash_bucket(key, seed), _bucket_count(n));
+		const uint64 pilot = _pilots[part.pilot_begin + bucket];
+		size_t pos = static_cast<size_t>(mul_hi(hash_position(key, seed) ^ hash_int(pilot, seed), _table_size(n)));
+		if(pos >= n)
+		{
+			pos = _remap[part.remap_begin + pos - n];
+		}
+		return static_cast<size_t>(part.offset) + pos;
+	}
+
+	size_t perfect_hash::size() const
+	{
+		return static_cast<size_t>(_header->count);
+	}
+
+	size_t perfect_hash::size_bytes() const
+	{
+		return _data_size;
+	}
+
+	void perfect_hash::serialize(std::vector<uint8>& out) const
+	{
+		out.assign(_data, _data + _data_size);
+	}
+
+	bool perfect_hash::deserialize(const void* data, size_t size)
+	{
+		if(data == nullptr || size < sizeof(header) || size % 8 != 0)
+		{
+			return false;
+		}
+		std::vector<uint64> storage(size / 8);
+		std::memcpy(storage.data(), data, size);
+		if(!_use(storage.data(), size))
+		{
+			_reset();
+			return false;
+		}
+		_storage.swap(storage);
+		return true;
+	}
+
+	bool perfect_hash::attach(const void* data, size_t size)
+	{
+		if(reinterpret_cast<uintptr_t>(data) % 8 != 0 || !_use(data, size))
+		{
+			_reset();
+			return false;
+		}
+		_storage.clear();
+		return true;
+	}
+
+	size_t perfect_hash::_table_size(size_t n)
+	{
+		// load factor ~0.94, integer math so every platform derives the same layout
+		return n + n / 16 + 1;
+	}
+
+	size_t perfect_hash::_bucket_count(size_t n)
+	{
+		// ~5 n / log2(n) buckets
+		size_t bits = 1;
+		while((static_cast<size_t>(1) << bits) < n)
+		{
+			++bits;
+		}
+		return (5 * n + bits - 1) / bits;
+	}
+
+	size_t perfect_hash::_bucket(uint64 h, size_t buckets)
+	{
+		// skewed assignment: 60% of the keys go to 30% of the buckets, the big buckets are placed first while the table is empty
+		const size_t dense = buckets * 3 / 10;
+		if(dense == 0)
+		{
+			return static_cast<size_t>(((h >> 32) * buckets) >> 32);
+		}
+		if(static_cast<uint32>(h) < 2576980378U)
+		{
+			return static_cast<size_t>(((h >> 32) * dense) >> 32);
+		}
+		return dense + static_cast<size_t>(((h >> 32) * (buckets - dense)) >> 32);
+	}
+
+	bool perfect_hash::_build(const uint64* keys, size_t count, unsigned threads, uint64 seed)
+	{
+		// group keys by partition
+		const size_t partitions = count > 0 ? (count + s_partition_keys - 1) / s_partition_keys : 1;
+		std::vector<uint64> offsets(partitions + 1, 0);
+		for(size_t i = 0; i < count; ++i)
+		{
+			++offsets[static_cast<size_t>(mul_hi(hash_partition(keys[i], seed), partitions)) + 1];
+		}
+		for(size_t p = 0; p < partitions; ++p)
+		{
+			offsets[p+1] += offsets[p];
+		}
+		std::vector<uint64> grouped(count);
+		{
+			std::vector<uint64> cursor(offsets.begin(), offsets.end() - 1);
+			for(size_t i = 0; i < count; ++i)
+			{
+				grouped[cursor[static_cast<size_t>(mul_hi(hash_partition(keys[i], seed), partitions))]++] = keys[i];
+			}
+		}
+
+		// lay out the blob
+		std::vector<partition> parts(partitions + 1);
+		uint64 pilots = 0;
+		uint64 remaps = 0;
+		for(size_t p = 0; p <= partitions; ++p)
+		{
+			parts[p].offset = offsets[p];
+			parts[p].pilot_begin = pilots;
+			parts[p].remap_begin = remaps;
+			parts[p].seed = 0;
+			if(p < partitions)
+			{
+				const size_t n = static_cast<size_t>(offsets[p+1] - offsets[p]);
+				pilots += n > 0 ? _bucket_count(n) : 0;
+				remaps += n > 0 ? _table_size(n) - n : 0;
+			}
+		}
+
+		const size_t parts_at = sizeof(header);
+		const size_t pilots_at = parts_at + parts.size() * sizeof(partition);
+		const size_t remap_at = pilots_at + pad8(static_cast<size_t>(pilots) * sizeof(uint16));
+		const size_t total = remap_at + pad8(static_cast<size_t>(remaps) * sizeof(uint32));
+
+		std::vector<uint64> storage(total / 8, 0);
+		uint8* blob = reinterpret_cast<uint8*>(storage.data());
+		uint16* pilot_out = reinterpret_cast<uint16*>(blob + pilots_at);
+		uint32* remap_out = reinterpret_cast<uint32*>(blob + remap_at);
+
+		// build partitions in parallel
+		atomic<size_t> next(0);
+		atomic<bool> failed(false);
+		auto worker = [&]()
+		{
+			std::vector<std::pair<size_t, uint64>> items;
+			std::vector<size_t> bucket_begin;
+			std::vector<size_t> order;
+			std::vector<uint64> taken;
+			std::vector<size_t> placed;
+
+			for(size_t p = next++; p < partitions && !failed; p = next++)
+			{
+				const size_t n = static_cast<size_t>(offsets[p+1] - offsets[p]);
+				if(n == 0)
+				{
+					continue;
+				}
+				const size_t m = _table_size(n);
+				const size_t buckets = _bucket_count(n);
+
+				// duplicate keys can never be separated
+				const auto keys_begin = grouped.begin() + static_cast<ptrdiff_t>(offsets[p]);
+				std::sort(keys_begin, keys_begin + static_cast<ptrdiff_t>(n));
+				if(std::adjacent_find(keys_begin, keys_begin + static_cast<ptrdiff_t>(n)) != keys_begin + static_cast<ptrdiff_t>(n))
+				{
+					failed = true;
+					break;
+				}
+
+				uint16* part_pilots = pilot_out + parts[p].pilot_begin;
+				bool placed_all = false;
+				for(uint64 attempt = 0; attempt < s_max_attempts && !placed_all; ++attempt)
+				{
+					const uint64 part_seed = hash_int(seed ^ p, attempt);
+					parts[p].seed = part_seed;
+
+					// (bucket, position hash) sorted by bucket, equal entries can only come from equal keys
+					items.resize(n);
+					for(size_t i = 0; i < n; ++i)
+					{
+						const uint64 key = grouped[static_cast<size_t>(offsets[p]) + i];
+						items[i] = std::make_pair(_bucket(hash_bucket(key, part_seed), buckets), hash_position(key, part_seed));
+					}
+					std::sort(items.begin(), items.end());
+					if(std::adjacent_find(items.begin(), items.end()) != items.end())
+					{
+						// 128 bit collision of two distinct keys, a new seed separates them
+						continue;
+					}
+
+					bucket_begin.assign(buckets + 1, 0);
+					for(const auto& item : items)
+					{
+						++bucket_begin[item.first + 1];
+					}
+					for(size_t b = 0; b < buckets; ++b)
+					{
+						bucket_begin[b+1] += bucket_begin[b];
+					}
+
+					// largest buckets first
+					order.resize(buckets);
+					for(size_t b = 0; b < buckets; ++b)
+					{
+						order[b] = b;
+					}
+					std::stable_sort(order.begin(), order.end(), [&bucket_begin](size_t a, size_t b)
+					{
+						return bucket_begin[a+1] - bucket_begin[a] > bucket_begin[b+1] - bucket_begin[b];
+					});
+
+					taken.assign((m + 63) / 64, 0);
+					std::fill(part_pilots, part_pilots + buckets, 0);
+					placed_all = true;
+					for(size_t b : order)
+					{
+						const size_t begin = bucket_begin[b];
+						const size_t end = bucket_begin[b+1];
+						if(begin == end)
+						{
+							break;
+						}
+
+						uint64 pilot = 0;
+						for(; pilot <= s_max_pilot; ++pilot)
+						{
+							const uint64 ph = hash_int(pilot, part_seed);
+							placed.clear();
+							for(size_t i = begin; i < end; ++i)
+							{
+								const size_t pos = static_cast<size_t>(mul_hi(items[i].second ^ ph, m));
+								const uint64 bit = static_cast<uint64>(1) << (pos % 64);
+								if(taken[pos / 64] & bit)
+								{
+									break;
+								}
+								taken[pos / 64] |= bit;
+								placed.push_back(pos);
+							}
+							if(placed.size() == end - begin)
+							{
+								break;
+							}
+							for(size_t pos : placed)
+							{
+								taken[pos / 64] &= ~(static_cast<uint64>(1) << (pos % 64));
+							}
+						}
+						if(pilot > s_max_pilot)
+						{
+							placed_all = false;
+							break;
+						}
+						part_pilots[b] = static_cast<uint16>(pilot);
+					}
+				}
+				if(!placed_all)
+				{
+					failed = true;
+					break;
+				}
+
+				// positions past n are redirected to the holes below n
+				uint32* part_remap = remap_out + parts[p].remap_begin;
+				size_t hole = 0;
+				for(size_t pos = n; pos < m; ++pos)
+				{
+					if(taken[pos / 64] & (static_cast<uint64>(1) << (pos % 64)))
+					{
+						while(taken[hole / 64] & (static_cast<uint64>(1) << (hole % 64)))
+						{
+							++hole;
+						}
+						part_remap[pos - n] = static_cast<uint32>(hole++);
+					}
+				}
+			}
+		};
+
+		if(threads == 0)
+		{
+			threads = std::thread::hardware_concurrency();
+		}
+		threads = static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), partitions));
+		std::vector<thread> pool;
+		for(unsigned t = 1; t < threads; ++t)
+		{
+			pool.emplace_back(worker);
+		}
+		worker();
+		for(auto& t : pool)
+		{
+			t.join();
+		}
+
+		if(failed)
+		{
+			return false;
+		}
+
+		const header h = {s_magic, count, seed, partitions, pilots, remaps};
+		std::memcpy(blob, &h, sizeof(h));
+		std::memcpy(blob + parts_at, parts.data(), parts.size() * sizeof(partition));
+		_storage.swap(storage);
+		return _use(_storage.data(), total);
+	}
+
+	bool perfect_hash::_use(const void* data, size_t size)
+	{
+		header h;
+		if(size < sizeof(h))
+		{
+			return false;
+		}
+		std::memcpy(&h, data, sizeof(h));
+
+		// bound the counts by the blob size first so the layout arithmetic below cannot wrap. every partition of n keys
+		// has more than n / 16 remap entries, which bounds the key count too
+		if(h.magic != s_magic || h.partitions == 0 || h.partitions >= (size - sizeof(header)) / sizeof(partition) ||
+		   h.pilots > size / sizeof(uint16) || h.remaps > size / sizeof(uint32) || h.count / 16 > h.remaps)
+		{
+			return false;
+		}
+		const size_t pilots_at = sizeof(header) + static_cast<size_t>(h.partitions + 1) * sizeof(partition);
+		const size_t remap_at = pilots_at + pad8(static_cast<size_t>(h.pilots) * sizeof(uint16));
+		if(size != remap_at + pad8(static_cast<size_t>(h.remaps) * sizeof(uint32)))
+		{
+			return false;
+		}
+
+		// lookups index pilots and remaps through the partition table and take remap entries as positions, so a corrupt
+		// blob must be rejected here: the table has to match the layout _build() writes and every remap entry must stay
+		// inside its partition. linear in partitions + remaps, a small fraction of the keys
+		const uint8* bytes = static_cast<const uint8*>(data);
+		const partition* parts = reinterpret_cast<const partition*>(bytes + sizeof(header));
+		const uint32* remap = reinterpret_cast<const uint32*>(bytes + remap_at);
+		const size_t partitions = static_cast<size_t>(h.partitions);
+		if(parts[0].offset != 0 || parts[0].pilot_begin != 0 || parts[0].remap_begin != 0)
+		{
+			return false;
+		}
+		for(size_t p = 0; p < partitions; ++p)
+		{
+			const partition& part = parts[p];
+			const partition& next = parts[p+1];
+			if(next.offset < part.offset || next.offset > h.count)
+			{
+				return false;
+			}
+			const size_t n = static_cast<size_t>(next.offset - part.offset);
+			const uint64 pilots = n > 0 ? _bucket_count(n) : 0;
+			const uint64 remaps = n > 0 ? _table_size(n) - n : 0;
+			if(next.pilot_begin != part.pilot_begin + pilots || next.remap_begin != part.remap_begin + remaps || next.remap_begin > h.remaps)
+			{
+				return false;
+			}
+			for(uint64 r = part.remap_begin; r < next.remap_begin; ++r)
+			{
+				if(remap[r] >= n)
+				{
+					return false;
+				}
+			}
+		}
+		if(parts[partitions].offset != h.count || parts[partitions].pilot_begin != h.pilots || parts[partitions].remap_begin != h.remaps)
+		{
+			return false;
+		}
+
+		_data = bytes;
+		_data_size = size;
+		_header = reinterpret_cast<const header*>(_data);
+		_partitions = parts;
+		_pilots = reinterpret_cast<const uint16*>(_data + pilots_at);
+		_remap = remap;
+		return true;
+	}
+
+	void perfect_hash::_reset()
+	{
+		// an empty function over zero keys, so lookups and size() work before build: the header, then one partition and
+		// the entry closing it, no pilots and no remaps. it passes _use(), so it also round trips through serialize()
+		static const uint64 s_empty[(sizeof(header) + 2 * sizeof(partition)) / sizeof(uint64)] = {s_magic, 0, 0, 1};
+		_storage.clear();
+		_data = reinterpret_cast<const uint8*>(s_empty);
+		_data_size = sizeof(s_empty);
+		_header = reinterpret_cast<const header*>(s_empty);
+		_partitions = reinterpret_cast<const partition*>(s_empty + 6);
+		_pilots = nullptr;
+		_remap = nullptr;
+	}
+} // namespace bl
@@ -0,0 +1,262 @@
+#pragma once
+#include <bl/util/hash_function.h>
+#include <bl/util/integer.h>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bl
+{
+	// minimal perfect hash over a static set of 64 bit key hashes (pthash style): maps the n keys to distinct
+	// indices in [0, n). a lookup reads one partition descriptor and one 16 bit pilot, ~6% of keys one more remap entry.
+	// keys are split into small partitions built independently in parallel.
+	// all state lives in one flat blob, so a serialized function can be used straight from a memory mapped file
+	// ref: https://arxiv.org/abs/2104.10402
+	class perfect_hash
+	{
+	public:
+		perfect_hash();
+		perfect_hash(perfect_hash&& other);
+		perfect_hash& operator=(perfect_hash&& other);
+
+		perfect_hash(const perfect_hash&) = delete;
+		perfect_hash& operator=(const perfect_hash&) = delete;
+
+		// keys must be distinct, returns false otherwise. threads = 0 uses every hardware thread
+		bool build(const uint64* keys, size_t count, unsigned threads = 0);
+
+		// index of a key of the set, an arbitrary index in [0, size()) for any other key
+		size_t operator()(uint64 key) const;
+
+		size_t size() const;
+		size_t size_bytes() const;
+
+		void serialize(std::vector<uint8>& out) const;
+		bool deserialize(const void* data, size_t size);
+
+		// uses data in place without copying, it must stay valid and be 8 byte aligned
+		bool attach(const void* data, size_t size);
+
+	private:
+		struct header
+		{
+			uint64 magic;
+			uint64 count;
+			uint64 seed;
+			uint64 partitions;
+			uint64 pilots;
+			uint64 remaps;
+		};
+
+		// one extra entry closes the last partition
+		struct partition
+		{
+			uint64 offset;      // index of the first key of the partition
+			uint64 pilot_begin; // first pilot of the partition
+			uint64 remap_begin; // first remap entry of the partition
+			uint64 seed;        // retried per partition until every bucket finds a pilot
+		};
+
+		static size_t _table_size(size_t n);
+		static size_t _bucket_count(size_t n);
+		static size_t _bucket(uint64 h, size_t buckets);
+
+		bool _build(const uint64* keys, size_t count, unsigned threads, uint64 seed);
+		bool _use(const void* data, size_t size);
+		void _reset();
+
+		std::vector<uint64> _storage;
+		const uint8* _data;
+		size_t _data_size;
+		const header* _header;
+		const partition* _partitions;
+		const uint16* _pilots;
+		const uint32* _remap;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// read-only map over a static key set: one perfect_hash lookup, one key comparison, no probing.
+	// t_hash must be constructible from a uint64 seed so the layout does not depend on the process hash seed
+	template<typename t_key, typename t_value, typename t_hash = hash<t_key>>
+	class static_map
+	{
+	public:
+		typedef t_key key_type;
+		typedef t_value mapped_type;
+		typedef std::pair<t_key, t_value> value_type;
+
+		static_map();
+
+		// keys must be unique, returns false otherwise
+		bool build(const std::vector<value_type>& items, unsigned threads = 0);
+
+		const t_value* find(const t_key& key) const;
+		bool contains(const t_key& key) const;
+
+		size_t size() const;
+		const value_type* begin() const;
+		const value_type* end() const;
+
+		// binary layout: perfect hash blob, then the items in index order. requires trivially copyable keys and values
+		void serialize(std::vector<uint8>& out) const;
+		bool deserialize(const void* data, size_t size);
+
+		// uses data in place without copying, it must stay valid and be 8 byte aligned
+		bool attach(const void* data, size_t size);
+
+	private:
+		static const uint64 key_seed = 0x5ca1ab1e0ddba11ULL;
+
+		bool _use(const void* data, size_t size, bool copy);
+
+		perfect_hash _index;
+		std::vector<value_type> _items;
+		const value_type* _view;
+		size_t _size;
+		t_hash _hash;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_key, typename t_value, typename t_hash>
+	static_map<t_key, t_value, t_hash>::static_map()
+		: _view(nullptr), _size(0), _hash(key_seed)
+	{
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	bool static_map<t_key, t_value, t_hash>::build(const std::vector<value_type>& items, unsigned threads)
+	{
+		std::vector<uint64> keys(items.size());
+		for(size_t i = 0; i < items.size(); ++i)
+		{
+			keys[i] = static_cast<uint64>(_hash(items[i].first));
+		}
+		// built aside, a failed build leaves the map as it was
+		perfect_hash index;
+		if(!index.build(keys.data(), keys.size(), threads))
+		{
+			return false;
+		}
+
+		std::vector<value_type> placed(items.size());
+		for(size_t i = 0; i < items.size(); ++i)
+		{
+			placed[index(keys[i])] = items[i];
+		}
+		_index = std::move(index);
+		_items.swap(placed);
+		_view = _items.data();
+		_size = _items.size();
+		return true;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	const t_value* static_map<t_key, t_value, t_hash>::find(const t_key& key) const
+	{
+		if(_size == 0)
+		{
+			return nullptr;
+		}
+		const value_type& item = _view[_index(static_cast<uint64>(_hash(key)))];
+		return item.first == key ? &item.second : nullptr;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	bool static_map<t_key, t_value, t_hash>::contains(const t_key& key) const
+	{
+		return find(key) != nullptr;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	size_t static_map<t_key, t_value, t_hash>::size() const
+	{
+		return _size;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	const typename static_map<t_key, t_value, t_hash>::value_type* static_map<t_key, t_value, t_hash>::begin() const
+	{
+		return _view;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	const typename static_map<t_key, t_value, t_hash>::value_type* static_map<t_key, t_value, t_hash>::end() const
+	{
+		return _view + _size;
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	void static_map<t_key, t_value, t_hash>::serialize(std::vector<uint8>& out) const
+	{
+		static_assert(std::is_trivially_copyable<t_key>::value && std::is_trivially_copyable<t_value>::value, "static_map serialization needs trivially copyable keys and values");
+
+		std::vector<uint8> index;
+		_index.serialize(index);
+		const size_t index_bytes = (index.size() + 7) & ~static_cast<size_t>(7);
+		const uint64 header[2] = {index_bytes, _size};
+
+		out.assign(sizeof(header) + index_bytes + _size * sizeof(value_type), 0);
+		std::memcpy(out.data(), header, sizeof(header));
+		std::memcpy(out.data() + sizeof(header), index.data(), index.size());
+		if(_size > 0)
+		{
+			std::memcpy(out.data() + sizeof(header) + index_bytes, _view, _size * sizeof(value_type));
+		}
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	bool static_map<t_key, t_value, t_hash>::deserialize(const void* data, size_t size)
+	{
+		return _use(data, size, true);
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	bool static_map<t_key, t_value, t_hash>::attach(const void* data, size_t size)
+	{
+		return _use(data, size, false);
+	}
+
+	template<typename t_key, typename t_value, typename t_hash>
+	bool static_map<t_key, t_value, t_hash>::_use(const void* data, size_t size, bool copy)
+	{
+		static_assert(std::is_trivially_copyable<t_key>::value && std::is_trivially_copyable<t_value>::value, "static_map serialization needs trivially copyable keys and values");
+
+		uint64 header[2];
+		if(data == nullptr || size < sizeof(header))
+		{
+			return false;
+		}
+		std::memcpy(header, data, sizeof(header));
+		const uint64 index_bytes = header[0];
+		const uint64 count = header[1];
+		if(index_bytes % 8 != 0 || index_bytes > size - sizeof(header) || (size - sizeof(header) - index_bytes) % sizeof(value_type) != 0 ||
+		   count != (size - sizeof(header) - index_bytes) / sizeof(value_type))
+		{
+			return false;
+		}
+
+		// loaded aside, a rejected blob leaves the map as it was
+		const uint8* bytes = static_cast<const uint8*>(data);
+		perfect_hash index;
+		const bool ok = copy ? index.deserialize(bytes + sizeof(header), static_cast<size_t>(index_bytes)) : index.attach(bytes + sizeof(header), static_cast<size_t>(index_bytes));
+		if(!ok || index.size() != count)
+		{
+			return false;
+		}
+
+		const value_type* items = reinterpret_cast<const value_type*>(bytes + sizeof(header) + index_bytes);
+		std::vector<value_type> copied;
+		if(copy)
+		{
+			copied.assign(items, items + count);
+		}
+		_index = std::move(index);
+		_items.swap(copied);
+		_view = copy ? _items.data() : items;
+		_size = static_cast<size_t>(count);
+		return true;
+	}
+} // namespace bl
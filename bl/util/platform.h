@@ -33,3 +33,10 @@
 #else
 	#error Operating system unknown or unsupported.
 #endif
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+	#define BL_CPU_X86
+#endif
+
+// destructive interference size used to keep independently written data on separate cache lines
+#define BL_CACHE_LINE_SIZE 64
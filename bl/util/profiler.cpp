@@ -0,0 +1,325 @@
+#include <bl/util/profiler.h>
+#include <bl/util/ring_buffer.h>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#if defined(BL_OS_WIN)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(BL_OS_LINUX)
+#include <pthread.h>
+#endif
+
+namespace bl
+{
+	// per thread ring, the pending subtrees are only touched by collect(). once its thread exited and the ring was
+	// drained the ring is handed to the next thread that registers, so only the peak number of threads costs memory
+	struct profiler::thread_data
+	{
+		thread_data()
+			: ring(ring_capacity), thread(this_thread_index()), exited(false), dropped(0)
+		{
+		}
+
+		spsc_ring_buffer<profile_event> ring;
+		unsigned thread;
+		bool exited; // guarded by the profiler mutex
+		atomic<uint64> dropped;
+		std::vector<tree_node> pending; // finished scopes whose parent did not end yet, depth never decreases upwards
+	};
+
+	struct profiler::tree_node
+	{
+		const char* name;
+		uint32 depth;
+		uint64 count;
+		uint64 ticks;
+		std::vector<tree_node> children;
+	};
+
+	thread_local profiler::thread_data* profiler::_thread;
+	thread_local uint32 profile_scope::_depth;
+
+#if defined(BL_OS_WIN)
+	static DWORD s_exit_key;
+#elif defined(BL_OS_LINUX)
+	static pthread_key_t s_exit_key;
+#endif
+
+	// runs when a thread that recorded something exits
+#if defined(BL_OS_WIN)
+	static VOID NTAPI s_thread_exit(PVOID data)
+#else
+	static void s_thread_exit(void* data)
+#endif
+	{
+		profiler::release(data);
+	}
+
+	static bool s_same_name(const char* a, const char* b)
+	{
+		return a == b || std::strcmp(a, b) == 0;
+	}
+
+	static void s_write_string(std::ostream& out, const char* s)
+	{
+		out << '"';
+		for(; *s != '\0'; ++s)
+		{
+			const unsigned char c = static_cast<unsigned char>(*s);
+			if(c == '"' || c == '\\')
+			{
+				out << '\\' << *s;
+			}
+			else if(c < 0x20)
+			{
+				char buffer[8];
+				std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+				out << buffer;
+			}
+			else
+			{
+				out << *s;
+			}
+		}
+		out << '"';
+	}
+
+	profiler::profiler()
+		: _trace_limit(1 << 20), _trace_dropped(0), _epoch(cycle_timer::now())
+	{
+	#if defined(BL_OS_WIN)
+		s_exit_key = FlsAlloc(s_thread_exit);
+	#elif defined(BL_OS_LINUX)
+		pthread_key_create(&s_exit_key, s_thread_exit);
+	#endif
+	}
+
+	profiler& profiler::global()
+	{
+		// intentionally never destroyed, threads may still record while the process exits
+		static profiler* p = new profiler();
+		return *p;
+	}
+
+	profiler::thread_data* profiler::_register()
+	{
+		profiler& p = global();
+		thread_data* t = nullptr;
+		{
+			mutex_lock l(p._mutex);
+			for(thread_data* candidate : p._threads)
+			{
+				// events still in the ring belong to the exited thread, wait for collect() to take them
+				if(candidate->exited && candidate->ring.empty())
+				{
+					t = candidate;
+					t->exited = false;
+					t->thread = this_thread_index();
+					break;
+				}
+			}
+			if(t == nullptr)
+			{
+				t = new thread_data();
+				p._threads.push_back(t);
+			}
+		}
+
+	#if defined(BL_OS_WIN)
+		FlsSetValue(s_exit_key, t);
+	#elif defined(BL_OS_LINUX)
+		pthread_setspecific(s_exit_key, t);
+	#endif
+		return t;
+	}
+
+	void profiler::release(void* data)
+	{
+		profiler& p = global();
+		mutex_lock l(p._mutex);
+		static_cast<thread_data*>(data)->exited = true;
+	}
+
+	void profiler::record(const char* name, uint64 start, uint64 end, uint32 depth)
+	{
+		thread_data* t = _thread;
+		if(t == nullptr)
+		{
+			t = _thread = _register();
+		}
+		const profile_event e = {name, start, end, depth};
+		if(!t->ring.try_push(e))
+		{
+			t->dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void profiler::_merge(std::vector<tree_node>& into, tree_node&& from)
+	{
+		for(tree_node& n : into)
+		{
+			if(s_same_name(n.name, from.name))
+			{
+				n.count += from.count;
+				n.ticks += from.ticks;
+				for(tree_node& child : from.children)
+				{
+					_merge(n.children, std::move(child));
+				}
+				return;
+			}
+		}
+		into.push_back(std::move(from));
+	}
+
+	void profiler::collect()
+	{
+		mutex_lock l(_mutex);
+		for(thread_data* t : _threads)
+		{
+			profile_event e;
+			while(t->ring.try_pop(e))
+			{
+				if(_trace.size() < _trace_limit)
+				{
+					_trace.push_back(trace_event{e, t->thread});
+				}
+				else
+				{
+					++_trace_dropped;
+				}
+
+				// scopes end before their parent, so its children are the deeper subtrees on top of the pending stack
+				tree_node n = {e.name, e.depth, 1, e.end - e.start, std::vector<tree_node>()};
+				size_t first = t->pending.size();
+				while(first > 0 && t->pending[first - 1].depth > e.depth)
+				{
+					--first;
+				}
+				for(size_t i = first; i < t->pending.size(); ++i)
+				{
+					_merge(n.children, std::move(t->pending[i]));
+				}
+				t->pending.erase(t->pending.begin() + static_cast<std::ptrdiff_t>(first), t->pending.end());
+
+				// fold repeated calls into the earlier sibling of the same name so the stack stays as small as the tree
+				bool merged = false;
+				for(size_t i = t->pending.size(); i > 0 && t->pending[i - 1].depth == e.depth; --i)
+				{
+					if(s_same_name(t->pending[i - 1].name, e.name))
+					{
+						std::vector<tree_node> siblings;
+						siblings.push_back(std::move(t->pending[i - 1]));
+						_merge(siblings, std::move(n));
+						t->pending[i - 1] = std::move(siblings.front());
+						merged = true;
+						break;
+					}
+				}
+				if(!merged)
+				{
+					t->pending.push_back(std::move(n));
+				}
+			}
+		}
+	}
+
+	profiler::node profiler::_export(const tree_node& n)
+	{
+		node result;
+		result.name = n.name;
+		result.count = n.count;
+		result.inclusive_seconds = cycle_timer::to_seconds(n.ticks);
+		result.exclusive_seconds = result.inclusive_seconds;
+		for(const tree_node& child : n.children)
+		{
+			result.children.push_back(_export(child));
+			result.exclusive_seconds -= result.children.back().inclusive_seconds;
+		}
+		return result;
+	}
+
+	profiler::node profiler::call_tree() const
+	{
+		std::vector<tree_node> roots;
+		{
+			mutex_lock l(_mutex);
+			for(const thread_data* t : _threads)
+			{
+				for(const tree_node& n : t->pending)
+				{
+					if(n.depth == 0)
+					{
+						_merge(roots, tree_node(n));
+					}
+				}
+			}
+		}
+
+		node root;
+		root.count = 0;
+		root.inclusive_seconds = 0;
+		for(const tree_node& n : roots)
+		{
+			root.children.push_back(_export(n));
+			root.inclusive_seconds += root.children.back().inclusive_seconds;
+		}
+		root.exclusive_seconds = 0;
+		return root;
+	}
+
+	void profiler::write_chrome_trace(std::ostream& out) const
+	{
+		mutex_lock l(_mutex);
+		const double us_per_tick = cycle_timer::to_nanoseconds(1000000) * 1e-9;
+		out << "{\"traceEvents\":[";
+		for(size_t i = 0; i < _trace.size(); ++i)
+		{
+			const trace_event& t = _trace[i];
+			const double ts = static_cast<double>(static_cast<int64>(t.event.start - _epoch)) * us_per_tick;
+			const double dur = static_cast<double>(t.event.end - t.event.start) * us_per_tick;
+			char buffer[96];
+			std::snprintf(buffer, sizeof(buffer), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", t.thread, ts, dur);
+			out << (i == 0 ? "\n{\"name\":" : ",\n{\"name\":");
+			s_write_string(out, t.event.name);
+			out << buffer;
+		}
+		out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	}
+
+	void profiler::set_trace_limit(size_t events)
+	{
+		mutex_lock l(_mutex);
+		_trace_limit = events;
+	}
+
+	uint64 profiler::dropped() const
+	{
+		mutex_lock l(_mutex);
+		uint64 count = _trace_dropped;
+		for(const thread_data* t : _threads)
+		{
+			count += t->dropped.load(std::memory_order_relaxed);
+		}
+		return count;
+	}
+
+	void profiler::clear()
+	{
+		mutex_lock l(_mutex);
+		for(thread_data* t : _threads)
+		{
+			profile_event e;
+			while(t->ring.try_pop(e))
+			{
+			}
+			t->pending.clear();
+			t->dropped.store(0, std::memory_order_relaxed);
+		}
+		_trace.clear();
+		_trace_dropped = 0;
+		_epoch = cycle_timer::now();
+	}
+} // namespace bl
@@ -0,0 +1,134 @@
+#pragma once
+#include <bl/util/cycle_timer.h>
+#include <bl/util/integer.h>
+#include <bl/util/thread.h>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// scoped profiling, compiled in only when BL_PROFILE is defined (e.g. DEFINES += BL_PROFILE), otherwise the macros
+// expand to nothing. names must outlive the profiler: string literals or __func__
+#define BL_PROFILE_CONCAT_(a, b) a##b
+#define BL_PROFILE_CONCAT(a, b) BL_PROFILE_CONCAT_(a, b)
+
+#if defined(BL_PROFILE)
+	#define BL_PROFILE_SCOPE(name) ::bl::profile_scope BL_PROFILE_CONCAT(_bl_profile_scope_, __COUNTER__)(name)
+	#define BL_PROFILE_FUNCTION() BL_PROFILE_SCOPE(__func__)
+#else
+	#define BL_PROFILE_SCOPE(name)
+	#define BL_PROFILE_FUNCTION()
+#endif
+
+namespace bl
+{
+	// one finished scope, times in cycle_timer ticks
+	struct profile_event
+	{
+		const char* name;
+		uint64 start;
+		uint64 end;
+		uint32 depth;
+	};
+
+	// every thread records its scopes into its own ring without locking, collect() drains the rings into a trace and a
+	// call tree. a full ring drops events until it is collected again
+	class profiler
+	{
+	public:
+		// aggregate of every call of a scope reached through the same path of enclosing scopes
+		struct node
+		{
+			std::string name;
+			uint64 count;
+			double inclusive_seconds;
+			double exclusive_seconds;
+			std::vector<node> children;
+		};
+
+		// events per thread ring, about 512 KB for each thread that records at the same time
+		static const size_t ring_capacity = 16384;
+
+		static profiler& global();
+
+		// moves what the threads recorded since the last call into the trace and the call tree
+		void collect();
+
+		// unnamed root whose children are the outermost scopes of every thread, as of the last collect(). a scope shows
+		// up once its outermost enclosing scope ended
+		node call_tree() const;
+
+		// chrome trace event format, loads in chrome://tracing and ui.perfetto.dev
+		// ref: https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+		void write_chrome_trace(std::ostream& out) const;
+
+		// events kept for the trace, later ones are dropped (default 1 << 20). the call tree is not limited
+		void set_trace_limit(size_t events);
+
+		// events lost to full rings or the trace limit
+		uint64 dropped() const;
+
+		void clear();
+
+		// called by profile_scope
+		static void record(const char* name, uint64 start, uint64 end, uint32 depth);
+
+		// called when a recording thread exits, its ring becomes free for reuse
+		static void release(void* data);
+
+	private:
+		struct thread_data;
+		struct tree_node;
+
+		struct trace_event
+		{
+			profile_event event;
+			unsigned thread;
+		};
+
+		profiler();
+
+		static thread_data* _register();
+		static void _merge(std::vector<tree_node>& into, tree_node&& from);
+		static node _export(const tree_node& n);
+
+		static thread_local thread_data* _thread;
+
+		mutable mutex _mutex;
+		std::vector<thread_data*> _threads;
+		std::vector<trace_event> _trace;
+		size_t _trace_limit;
+		uint64 _trace_dropped;
+		uint64 _epoch;
+	};
+
+	class profile_scope
+	{
+	public:
+		explicit profile_scope(const char* name);
+		~profile_scope();
+
+		profile_scope(const profile_scope&) = delete;
+		profile_scope& operator=(const profile_scope&) = delete;
+
+	private:
+		static thread_local uint32 _depth;
+
+		const char* _name;
+		uint64 _start;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline profile_scope::profile_scope(const char* name)
+		: _name(name), _start(cycle_timer::now())
+	{
+		++_depth;
+	}
+
+	inline profile_scope::~profile_scope()
+	{
+		--_depth;
+		profiler::record(_name, _start, cycle_timer::now(), _depth);
+	}
+} // namespace bl
@@ -0,0 +1,581 @@
+#include <bl/util/random.h>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BL_RANDOM_AVX2
+#endif
+
+namespace bl
+{
+	static const uint64 s_xoshiro_jump[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+	static const uint64 s_xoshiro_long_jump[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+	static const double s_pi2 = 6.283185307179586476925;
+	static const double s_ln2 = 0.693147180559945309417;
+	static const double s_sqrt2 = 1.414213562373095048802;
+
+	// log(m) = 2 atanh(s) = 2 s (1 + s^2 / 3 + s^4 / 5 + ...) with s = (m - 1) / (m + 1), |s| < 0.172 for m in [sqrt(2) / 2, sqrt(2)]
+	static const int s_log_terms = 11;
+	static const double s_log_series[s_log_terms] = {1.0, 1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13, 1.0 / 15, 1.0 / 17, 1.0 / 19, 1.0 / 21};
+
+	// taylor series of sin(a) / a and cos(a) in a^2 for |a| <= pi / 4
+	static const int s_sincos_terms = 9;
+	static const double s_sin_series[s_sincos_terms] = {1.0, -1.0 / 6, 1.0 / 120, -1.0 / 5040, 1.0 / 362880, -1.0 / 39916800, 1.0 / 6227020800.0,
+														-1.0 / 1307674368000.0, 1.0 / 355687428096000.0};
+	static const double s_cos_series[s_sincos_terms] = {1.0, -1.0 / 2, 1.0 / 24, -1.0 / 720, 1.0 / 40320, -1.0 / 3628800, 1.0 / 479001600,
+														-1.0 / 87178291200.0, 1.0 / 20922789888000.0};
+
+	// words generated at once by the buffered fills, small enough to stay in l1
+	static const size_t s_buffer_words = 256;
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// scalar math shared by every path, the avx2 versions below perform the same operations
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	double unit_double(uint64 bits)
+	{
+		const uint64 one = (bits >> 12) | 0x3ff0000000000000ULL;
+		double value;
+		std::memcpy(&value, &one, sizeof(value));
+		return value - 1.0;
+	}
+
+	float unit_float(uint32 bits)
+	{
+		const uint32 one = (bits >> 9) | 0x3f800000U;
+		float value;
+		std::memcpy(&value, &one, sizeof(value));
+		return value - 1.0f;
+	}
+
+	// positive normal x
+	static double log_positive(double x)
+	{
+		uint64 bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		double e = static_cast<double>(bits >> 52);
+		const uint64 mantissa = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+		double m;
+		std::memcpy(&m, &mantissa, sizeof(m));
+		if(m > s_sqrt2)
+		{
+			m = m * 0.5;
+			e = e + 1.0;
+		}
+		e = e - 1023.0;
+		const double s = (m - 1.0) / (m + 1.0);
+		const double s2 = s * s;
+		double p = s_log_series[s_log_terms - 1];
+		for(int i = s_log_terms - 2; i >= 0; --i)
+		{
+			p = p * s2 + s_log_series[i];
+		}
+		return e * s_ln2 + (s + s) * p;
+	}
+
+	// sin and cos of 2 pi u for u in [0, 1): reduced to a quarter turn around the nearest multiple of pi / 2
+	static void sincos_turn(double u, double& sin, double& cos)
+	{
+		const double q = std::floor(u * 4.0 + 0.5);
+		const double a = (u - q * 0.25) * s_pi2;
+		const double a2 = a * a;
+		double s = s_sin_series[s_sincos_terms - 1];
+		double c = s_cos_series[s_sincos_terms - 1];
+		for(int i = s_sincos_terms - 2; i >= 0; --i)
+		{
+			s = s * a2 + s_sin_series[i];
+			c = c * a2 + s_cos_series[i];
+		}
+		s = s * a;
+
+		const double quadrant = q - 4.0 * std::floor(q * 0.25);
+		const bool odd = quadrant == 1.0 || quadrant == 3.0;
+		sin = odd ? c : s;
+		cos = odd ? s : c;
+		sin = quadrant >= 2.0 ? -sin : sin;
+		cos = quadrant == 1.0 || quadrant == 2.0 ? -cos : cos;
+	}
+
+	void normal_pair(uint64 bits1, uint64 bits2, double& z1, double& z2)
+	{
+		// 1 - u is in (0, 1], the log stays finite
+		const double radius = std::sqrt(-2.0 * log_positive(1.0 - unit_double(bits1)));
+		double sin, cos;
+		sincos_turn(unit_double(bits2), sin, cos);
+		z1 = radius * cos;
+		z2 = radius * sin;
+	}
+
+	// 128 bit h:l = h:l * mh:ml + ah:al
+	static void multiply_add(uint64& h, uint64& l, uint64 mh, uint64 ml, uint64 ah, uint64 al)
+	{
+		uint64 low;
+		const uint64 high = multiply_high(l, ml, low) + h * ml + l * mh;
+		l = low + al;
+		h = high + ah + (l < low ? 1 : 0);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// avx2
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(BL_RANDOM_AVX2)
+	template<int t_bits>
+	static __m256i rotl_avx2(__m256i x)
+	{
+		return _mm256_or_si256(_mm256_slli_epi64(x, t_bits), _mm256_srli_epi64(x, 64 - t_bits));
+	}
+
+	static __m256d unit_double_avx2(__m256i bits)
+	{
+		const __m256i one = _mm256_or_si256(_mm256_srli_epi64(bits, 12), _mm256_set1_epi64x(0x3ff0000000000000LL));
+		return _mm256_sub_pd(_mm256_castsi256_pd(one), _mm256_set1_pd(1.0));
+	}
+
+	static __m256 unit_float_avx2(__m256i bits)
+	{
+		const __m256i one = _mm256_or_si256(_mm256_srli_epi32(bits, 9), _mm256_set1_epi32(0x3f800000));
+		return _mm256_sub_ps(_mm256_castsi256_ps(one), _mm256_set1_ps(1.0f));
+	}
+
+	static __m256d log_positive_avx2(__m256d x)
+	{
+		// the biased exponent becomes a double by placing it in the mantissa of 2^52
+		const __m256i bits = _mm256_castpd_si256(x);
+		const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+		__m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_castpd_si256(two52))), two52);
+		const __m256i mantissa = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL)),
+												 _mm256_set1_epi64x(0x3ff0000000000000LL));
+		__m256d m = _mm256_castsi256_pd(mantissa);
+		const __m256d above = _mm256_cmp_pd(m, _mm256_set1_pd(s_sqrt2), _CMP_GT_OQ);
+		m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), above);
+		e = _mm256_blendv_pd(e, _mm256_add_pd(e, _mm256_set1_pd(1.0)), above);
+		e = _mm256_sub_pd(e, _mm256_set1_pd(1023.0));
+
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d s = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+		const __m256d s2 = _mm256_mul_pd(s, s);
+		__m256d p = _mm256_set1_pd(s_log_series[s_log_terms - 1]);
+		for(int i = s_log_terms - 2; i >= 0; --i)
+		{
+			p = _mm256_add_pd(_mm256_mul_pd(p, s2), _mm256_set1_pd(s_log_series[i]));
+		}
+		return _mm256_add_pd(_mm256_mul_pd(e, _mm256_set1_pd(s_ln2)), _mm256_mul_pd(_mm256_add_pd(s, s), p));
+	}
+
+	static void sincos_turn_avx2(__m256d u, __m256d& sin, __m256d& cos)
+	{
+		const __m256d q = _mm256_floor_pd(_mm256_add_pd(_mm256_mul_pd(u, _mm256_set1_pd(4.0)), _mm256_set1_pd(0.5)));
+		const __m256d a = _mm256_mul_pd(_mm256_sub_pd(u, _mm256_mul_pd(q, _mm256_set1_pd(0.25))), _mm256_set1_pd(s_pi2));
+		const __m256d a2 = _mm256_mul_pd(a, a);
+		__m256d s = _mm256_set1_pd(s_sin_series[s_sincos_terms - 1]);
+		__m256d c = _mm256_set1_pd(s_cos_series[s_sincos_terms - 1]);
+		for(int i = s_sincos_terms - 2; i >= 0; --i)
+		{
+			s = _mm256_add_pd(_mm256_mul_pd(s, a2), _mm256_set1_pd(s_sin_series[i]));
+			c = _mm256_add_pd(_mm256_mul_pd(c, a2), _mm256_set1_pd(s_cos_series[i]));
+		}
+		s = _mm256_mul_pd(s, a);
+
+		const __m256d quadrant = _mm256_sub_pd(q, _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_floor_pd(_mm256_mul_pd(q, _mm256_set1_pd(0.25)))));
+		const __m256d first = _mm256_cmp_pd(quadrant, _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+		const __m256d second = _mm256_cmp_pd(quadrant, _mm256_set1_pd(2.0), _CMP_EQ_OQ);
+		const __m256d odd = _mm256_or_pd(first, _mm256_cmp_pd(quadrant, _mm256_set1_pd(3.0), _CMP_EQ_OQ));
+		const __m256d sign = _mm256_set1_pd(-0.0);
+		sin = _mm256_blendv_pd(s, c, odd);
+		cos = _mm256_blendv_pd(c, s, odd);
+		sin = _mm256_xor_pd(sin, _mm256_and_pd(_mm256_cmp_pd(quadrant, _mm256_set1_pd(2.0), _CMP_GE_OQ), sign));
+		cos = _mm256_xor_pd(cos, _mm256_and_pd(_mm256_or_pd(first, second), sign));
+	}
+
+	static void normal_pair_avx2(__m256i bits1, __m256i bits2, __m256d& z1, __m256d& z2)
+	{
+		const __m256d u1 = _mm256_sub_pd(_mm256_set1_pd(1.0), unit_double_avx2(bits1));
+		const __m256d radius = _mm256_sqrt_pd(_mm256_mul_pd(_mm256_set1_pd(-2.0), log_positive_avx2(u1)));
+		__m256d sin, cos;
+		sincos_turn_avx2(unit_double_avx2(bits2), sin, cos);
+		z1 = _mm256_mul_pd(radius, cos);
+		z2 = _mm256_mul_pd(radius, sin);
+	}
+
+	static __m256i load_avx2(const uint64* p)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+#endif
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// engines
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	xoshiro256ss::xoshiro256ss(uint64 seed)
+	{
+		this->seed(seed);
+	}
+
+	void xoshiro256ss::seed(uint64 seed)
+	{
+		splitmix64 expand(seed);
+		for(uint64& s : _s)
+		{
+			s = expand();
+		}
+	}
+
+	void xoshiro256ss::discard(uint64 count)
+	{
+		for(uint64 i = 0; i < count; ++i)
+		{
+			(*this)();
+		}
+	}
+
+	void xoshiro256ss::jump()
+	{
+		_jump(s_xoshiro_jump);
+	}
+
+	void xoshiro256ss::long_jump()
+	{
+		_jump(s_xoshiro_long_jump);
+	}
+
+	// the state after the jump is the sum of the states selected by the bits of the jump polynomial
+	void xoshiro256ss::_jump(const uint64* polynomial)
+	{
+		uint64 s[4] = {0, 0, 0, 0};
+		for(int i = 0; i < 4; ++i)
+		{
+			for(int b = 0; b < 64; ++b)
+			{
+				if(polynomial[i] & (uint64(1) << b))
+				{
+					for(int w = 0; w < 4; ++w)
+					{
+						s[w] ^= _s[w];
+					}
+				}
+				(*this)();
+			}
+		}
+		std::memcpy(_s, s, sizeof(_s));
+	}
+
+	pcg64::pcg64(uint64 seed, uint64 stream)
+	{
+		this->seed(seed, stream);
+	}
+
+	void pcg64::seed(uint64 seed, uint64 stream)
+	{
+		// seeding of the reference implementation, with the increment odd
+		splitmix64 expand(seed);
+		const uint64 initial_high = expand();
+		const uint64 initial_low = expand();
+		_increment_high = stream >> 63;
+		_increment_low = (stream << 1) | 1;
+		_state_high = 0;
+		_state_low = 0;
+		_step(s_multiplier_high, s_multiplier_low, _increment_high, _increment_low);
+		multiply_add(_state_high, _state_low, 0, 1, initial_high, initial_low);
+		_step(s_multiplier_high, s_multiplier_low, _increment_high, _increment_low);
+	}
+
+	// distance steps composed by squaring: step^(2^i) is again x * m + c, brown's algorithm
+	// ref: https://www.osti.gov/biblio/89100
+	void pcg64::advance(uint64 distance)
+	{
+		uint64 multiplier_high = 0, multiplier_low = 1, increment_high = 0, increment_low = 0;
+		uint64 step_multiplier_high = s_multiplier_high, step_multiplier_low = s_multiplier_low;
+		uint64 step_increment_high = _increment_high, step_increment_low = _increment_low;
+		while(distance > 0)
+		{
+			if(distance & 1)
+			{
+				multiply_add(multiplier_high, multiplier_low, step_multiplier_high, step_multiplier_low, 0, 0);
+				multiply_add(increment_high, increment_low, step_multiplier_high, step_multiplier_low, step_increment_high, step_increment_low);
+			}
+			// c = (m + 1) * c, m = m * m
+			uint64 h = step_multiplier_high, l = step_multiplier_low + 1;
+			h += l == 0 ? 1 : 0;
+			multiply_add(step_increment_high, step_increment_low, h, l, 0, 0);
+			multiply_add(step_multiplier_high, step_multiplier_low, step_multiplier_high, step_multiplier_low, 0, 0);
+			distance >>= 1;
+		}
+		_step(multiplier_high, multiplier_low, increment_high, increment_low);
+	}
+
+	xoshiro256ss_x4::xoshiro256ss_x4(uint64 seed)
+	{
+		this->seed(seed);
+	}
+
+	void xoshiro256ss_x4::seed(uint64 seed)
+	{
+		xoshiro256ss lane(seed);
+		for(size_t k = 0; k < lanes; ++k)
+		{
+			for(int w = 0; w < 4; ++w)
+			{
+				_s[w][k] = lane._s[w];
+			}
+			lane.jump();
+		}
+	}
+
+	void xoshiro256ss_x4::next(uint64* out)
+	{
+		for(size_t k = 0; k < lanes; ++k)
+		{
+			out[k] = xoshiro256ss::_rotate_left(_s[1][k] * 5, 7) * 9;
+			const uint64 t = _s[1][k] << 17;
+			_s[2][k] ^= _s[0][k];
+			_s[3][k] ^= _s[1][k];
+			_s[1][k] ^= _s[2][k];
+			_s[0][k] ^= _s[3][k];
+			_s[2][k] ^= t;
+			_s[3][k] = xoshiro256ss::_rotate_left(_s[3][k], 45);
+		}
+	}
+
+	void xoshiro256ss_x4::generate(uint64* out, size_t count)
+	{
+		size_t i = 0;
+	#if defined(BL_RANDOM_AVX2)
+		if(count >= lanes)
+		{
+			__m256i* state = reinterpret_cast<__m256i*>(_s);
+			__m256i s0 = _mm256_loadu_si256(state), s1 = _mm256_loadu_si256(state + 1);
+			__m256i s2 = _mm256_loadu_si256(state + 2), s3 = _mm256_loadu_si256(state + 3);
+			for(; i + lanes <= count; i += lanes)
+			{
+				// x * 5 and x * 9 as shifts and adds, avx2 has no 64 bit multiply
+				const __m256i r = rotl_avx2<7>(_mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(_mm256_slli_epi64(r, 3), r));
+				const __m256i t = _mm256_slli_epi64(s1, 17);
+				s2 = _mm256_xor_si256(s2, s0);
+				s3 = _mm256_xor_si256(s3, s1);
+				s1 = _mm256_xor_si256(s1, s2);
+				s0 = _mm256_xor_si256(s0, s3);
+				s2 = _mm256_xor_si256(s2, t);
+				s3 = rotl_avx2<45>(s3);
+			}
+			_mm256_storeu_si256(state, s0);
+			_mm256_storeu_si256(state + 1, s1);
+			_mm256_storeu_si256(state + 2, s2);
+			_mm256_storeu_si256(state + 3, s3);
+		}
+	#endif
+		for(; i + lanes <= count; i += lanes)
+		{
+			next(out + i);
+		}
+		if(i < count)
+		{
+			uint64 last[lanes];
+			next(last);
+			std::memcpy(out + i, last, (count - i) * sizeof(uint64));
+		}
+	}
+
+	void xoshiro256ss_x4::long_jump()
+	{
+		xoshiro256ss lane;
+		for(size_t k = 0; k < lanes; ++k)
+		{
+			for(int w = 0; w < 4; ++w)
+			{
+				lane._s[w] = _s[w][k];
+			}
+			lane.long_jump();
+			for(int w = 0; w < 4; ++w)
+			{
+				_s[w][k] = lane._s[w];
+			}
+		}
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// bulk fills of xoshiro256ss_x4: words are generated in blocks of s_buffer_words, then converted
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// words of the rounds needed for count values taking per_word values of a word
+	static size_t buffer_words(size_t count, size_t per_word)
+	{
+		const size_t words = (count + per_word - 1) / per_word;
+		const size_t rounds = (words + xoshiro256ss_x4::lanes - 1) / xoshiro256ss_x4::lanes;
+		return std::min(s_buffer_words, rounds * xoshiro256ss_x4::lanes);
+	}
+
+	void fill_uniform(xoshiro256ss_x4& generator, float* out, size_t count, float min, float max)
+	{
+		const float range = max - min;
+		uint64 words[s_buffer_words];
+		for(size_t i = 0; i < count;)
+		{
+			const size_t n = std::min(count - i, 2 * buffer_words(count - i, 2));
+			generator.generate(words, buffer_words(n, 2));
+			size_t j = 0;
+		#if defined(BL_RANDOM_AVX2)
+			const __m256 vmin = _mm256_set1_ps(min), vrange = _mm256_set1_ps(range);
+			for(; j + 8 <= n; j += 8)
+			{
+				const __m256 u = unit_float_avx2(load_avx2(words + j / 2));
+				_mm256_storeu_ps(out + i + j, _mm256_add_ps(vmin, _mm256_mul_ps(u, vrange)));
+			}
+		#endif
+			for(; j < n; ++j)
+			{
+				out[i + j] = min + unit_float(static_cast<uint32>(words[j / 2] >> (j % 2 * 32))) * range;
+			}
+			i += n;
+		}
+	}
+
+	void fill_uniform(xoshiro256ss_x4& generator, double* out, size_t count, double min, double max)
+	{
+		const double range = max - min;
+		uint64 words[s_buffer_words];
+		for(size_t i = 0; i < count;)
+		{
+			const size_t n = std::min(count - i, s_buffer_words);
+			generator.generate(words, buffer_words(n, 1));
+			size_t j = 0;
+		#if defined(BL_RANDOM_AVX2)
+			const __m256d vmin = _mm256_set1_pd(min), vrange = _mm256_set1_pd(range);
+			for(; j + 4 <= n; j += 4)
+			{
+				const __m256d u = unit_double_avx2(load_avx2(words + j));
+				_mm256_storeu_pd(out + i + j, _mm256_add_pd(vmin, _mm256_mul_pd(u, vrange)));
+			}
+		#endif
+			for(; j < n; ++j)
+			{
+				out[i + j] = min + unit_double(words[j]) * range;
+			}
+			i += n;
+		}
+	}
+
+	// words from the generator in rounds, for the rejection loop of bounded_random
+	class buffered_words
+	{
+	public:
+		buffered_words(xoshiro256ss_x4& generator, size_t expected)
+			: _generator(generator), _expected(expected), _size(0), _position(0)
+		{
+		}
+
+		uint64 operator()()
+		{
+			if(_position == _size)
+			{
+				// at least a round once the expected words are used up by rejections
+				_size = buffer_words(std::max<size_t>(_expected, 1), 1);
+				_generator.generate(_words, _size);
+				_expected -= std::min(_expected, _size);
+				_position = 0;
+			}
+			return _words[_position++];
+		}
+
+	private:
+		xoshiro256ss_x4& _generator;
+		size_t _expected;
+		size_t _size;
+		size_t _position;
+		uint64 _words[s_buffer_words];
+	};
+
+	template<typename t_value>
+	static void fill_bounded(xoshiro256ss_x4& generator, t_value* out, size_t count, t_value min, t_value max)
+	{
+		const uint64 range = static_cast<uint64>(max) - static_cast<uint64>(min) + 1;
+		buffered_words words(generator, count);
+		for(size_t i = 0; i < count; ++i)
+		{
+			out[i] = static_cast<t_value>(static_cast<uint64>(min) + bounded_random(words, range));
+		}
+	}
+
+	void fill_uniform(xoshiro256ss_x4& generator, int32* out, size_t count, int32 min, int32 max)
+	{
+		fill_bounded(generator, out, count, min, max);
+	}
+
+	void fill_uniform(xoshiro256ss_x4& generator, uint32* out, size_t count, uint32 min, uint32 max)
+	{
+		fill_bounded(generator, out, count, min, max);
+	}
+
+	void fill_uniform(xoshiro256ss_x4& generator, int64* out, size_t count, int64 min, int64 max)
+	{
+		fill_bounded(generator, out, count, min, max);
+	}
+
+	void fill_uniform(xoshiro256ss_x4& generator, uint64* out, size_t count, uint64 min, uint64 max)
+	{
+		fill_bounded(generator, out, count, min, max);
+	}
+
+	// a pair of rounds gives 8 values: lane k takes words k and k + 4, its normals go to k and k + 4
+	template<typename t_value>
+	static void fill_gaussian(xoshiro256ss_x4& generator, t_value* out, size_t count, t_value mean, t_value stddev)
+	{
+		uint64 words[s_buffer_words];
+		t_value last[8];
+		for(size_t i = 0; i < count;)
+		{
+			const size_t n = std::min(count - i, s_buffer_words);
+			const size_t pairs = (n + 7) / 8;
+			generator.generate(words, pairs * 8);
+			for(size_t p = 0; p < pairs; ++p)
+			{
+				// the last pair may be cut
+				t_value* values = i + p * 8 + 8 <= count ? out + i + p * 8 : last;
+				const uint64* bits = words + p * 8;
+			#if defined(BL_RANDOM_AVX2)
+				__m256d z1, z2;
+				normal_pair_avx2(load_avx2(bits), load_avx2(bits + 4), z1, z2);
+				if(sizeof(t_value) == sizeof(float))
+				{
+					const __m128 vmean = _mm_set1_ps(static_cast<float>(mean)), vstddev = _mm_set1_ps(static_cast<float>(stddev));
+					_mm_storeu_ps(reinterpret_cast<float*>(values), _mm_add_ps(vmean, _mm_mul_ps(_mm256_cvtpd_ps(z1), vstddev)));
+					_mm_storeu_ps(reinterpret_cast<float*>(values) + 4, _mm_add_ps(vmean, _mm_mul_ps(_mm256_cvtpd_ps(z2), vstddev)));
+				}
+				else
+				{
+					const __m256d vmean = _mm256_set1_pd(static_cast<double>(mean)), vstddev = _mm256_set1_pd(static_cast<double>(stddev));
+					_mm256_storeu_pd(reinterpret_cast<double*>(values), _mm256_add_pd(vmean, _mm256_mul_pd(z1, vstddev)));
+					_mm256_storeu_pd(reinterpret_cast<double*>(values) + 4, _mm256_add_pd(vmean, _mm256_mul_pd(z2, vstddev)));
+				}
+			#else
+				for(size_t k = 0; k < xoshiro256ss_x4::lanes; ++k)
+				{
+					double z1, z2;
+					normal_pair(bits[k], bits[k + 4], z1, z2);
+					values[k] = mean + static_cast<t_value>(z1) * stddev;
+					values[k + 4] = mean + static_cast<t_value>(z2) * stddev;
+				}
+			#endif
+				if(values == last)
+				{
+					std::copy(last, last + (count - i - p * 8), out + i + p * 8);
+				}
+			}
+			i += n;
+		}
+	}
+
+	void fill_normal(xoshiro256ss_x4& generator, float* out, size_t count, float mean, float stddev)
+	{
+		fill_gaussian(generator, out, count, mean, stddev);
+	}
+
+	void fill_normal(xoshiro256ss_x4& generator, double* out, size_t count, double mean, double stddev)
+	{
+		fill_gaussian(generator, out, count, mean, stddev);
+	}
+} // namespace bl
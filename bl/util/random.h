@@ -1,6 +1,12 @@
 #pragma once
 #include <bl/util/function.h>
+#include <bl/util/integer.h>
+#include <bl/util/thread_pool.h>
+#include <algorithm>
+#include <cstddef>
 #include <random>
+#include <type_traits>
+#include <vector>
 
 namespace bl
 {
@@ -30,4 +36,388 @@ namespace bl
 		}
 		return make_random(min, max, seed);
 	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// engines, all produce 64 bits per call and work with the std distributions
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// high 64 bits of a * b, the low ones in low
+	inline uint64 multiply_high(uint64 a, uint64 b, uint64& low)
+	{
+	#if defined(__SIZEOF_INT128__)
+		__extension__ typedef unsigned __int128 uint128;
+		const uint128 r = static_cast<uint128>(a) * b;
+		low = static_cast<uint64>(r);
+		return static_cast<uint64>(r >> 64);
+	#else
+		const uint64 ha = a >> 32, hb = b >> 32, la = static_cast<uint32>(a), lb = static_cast<uint32>(b);
+		const uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+		low = t + (rm1 << 32);
+		return rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl ? 1 : 0) + (low < t ? 1 : 0);
+	#endif
+	}
+
+	// weyl sequence through a 64 bit finalizer, only meant to expand seeds into engine states
+	// ref: https://prng.di.unimi.it/splitmix64.c
+	class splitmix64
+	{
+	public:
+		typedef uint64 result_type;
+
+		explicit splitmix64(uint64 seed = 0)
+			: _state(seed)
+		{
+		}
+
+		void seed(uint64 seed)
+		{
+			_state = seed;
+		}
+
+		uint64 operator()()
+		{
+			uint64 z = (_state += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return z ^ (z >> 31);
+		}
+
+		void discard(uint64 count)
+		{
+			_state += count * 0x9e3779b97f4a7c15ULL;
+		}
+
+		static constexpr uint64 min() { return 0; }
+		static constexpr uint64 max() { return ~uint64(0); }
+
+	private:
+		uint64 _state;
+	};
+
+	// 256 bit xorshift generator with the ** scrambler, the fastest of the three.
+	// jump() advances by 2^128 numbers and long_jump() by 2^192, to give threads or blocks non overlapping sequences
+	// ref: https://prng.di.unimi.it/xoshiro256starstar.c
+	class xoshiro256ss
+	{
+	public:
+		typedef uint64 result_type;
+
+		explicit xoshiro256ss(uint64 seed = 0);
+
+		// the state is expanded from seed by splitmix64
+		void seed(uint64 seed);
+
+		uint64 operator()()
+		{
+			const uint64 result = _rotate_left(_s[1] * 5, 7) * 9;
+			const uint64 t = _s[1] << 17;
+			_s[2] ^= _s[0];
+			_s[3] ^= _s[1];
+			_s[1] ^= _s[2];
+			_s[0] ^= _s[3];
+			_s[2] ^= t;
+			_s[3] = _rotate_left(_s[3], 45);
+			return result;
+		}
+
+		void discard(uint64 count);
+		void jump();
+		void long_jump();
+
+		static constexpr uint64 min() { return 0; }
+		static constexpr uint64 max() { return ~uint64(0); }
+
+	private:
+		friend class xoshiro256ss_x4;
+
+		static uint64 _rotate_left(uint64 x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+		void _jump(const uint64* polynomial);
+
+		uint64 _s[4];
+	};
+
+	// 128 bit lcg with the xsl rr output function (pcg64 of numpy and the pcg library). stream selects one of 2^63
+	// independent sequences, advance() jumps any distance in O(log distance)
+	// ref: https://www.pcg-random.org/pdf/hmc-cs-2014-0905.pdf
+	class pcg64
+	{
+	public:
+		typedef uint64 result_type;
+
+		explicit pcg64(uint64 seed = 0, uint64 stream = 0);
+
+		// the 128 bit initial state is expanded from seed by splitmix64
+		void seed(uint64 seed, uint64 stream = 0);
+
+		uint64 operator()()
+		{
+			_step(s_multiplier_high, s_multiplier_low, _increment_high, _increment_low);
+			const uint64 x = _state_high ^ _state_low;
+			const int rotation = static_cast<int>(_state_high >> 58);
+			return (x >> rotation) | (x << ((64 - rotation) & 63));
+		}
+
+		void advance(uint64 distance);
+
+		void discard(uint64 count)
+		{
+			advance(count);
+		}
+
+		static constexpr uint64 min() { return 0; }
+		static constexpr uint64 max() { return ~uint64(0); }
+
+	private:
+		static const uint64 s_multiplier_high = 0x2360ed051fc65da4ULL;
+		static const uint64 s_multiplier_low = 0x4385df649fccf645ULL;
+
+		// state = state * multiplier + increment, modulo 2^128
+		void _step(uint64 multiplier_high, uint64 multiplier_low, uint64 increment_high, uint64 increment_low)
+		{
+			uint64 low;
+			const uint64 high = multiply_high(_state_low, multiplier_low, low) + _state_high * multiplier_low + _state_low * multiplier_high;
+			_state_low = low + increment_low;
+			_state_high = high + increment_high + (_state_low < low ? 1 : 0);
+		}
+
+		uint64 _state_high;
+		uint64 _state_low;
+		uint64 _increment_high;
+		uint64 _increment_low;
+	};
+
+	// 4 xoshiro256** streams advanced together, lane k is xoshiro256ss(seed) jumped k times. the bulk fills below use
+	// avx2 when compiled with it and draw the same numbers without: integers are identical, floating point values may
+	// differ by rounding. a fill consumes whole rounds (one number of every lane) so splitting a fill into several calls
+	// gives other numbers unless the counts are multiples of 8
+	class xoshiro256ss_x4
+	{
+	public:
+		static const size_t lanes = 4;
+
+		// numbers per block of the parallel fills
+		static const size_t parallel_block = size_t(1) << 18;
+
+		explicit xoshiro256ss_x4(uint64 seed = 0);
+
+		void seed(uint64 seed);
+
+		// one round, out[k] from lane k
+		void next(uint64* out);
+
+		// round after round, the last one is cut at count
+		void generate(uint64* out, size_t count);
+
+		// long jump of every lane, used between the blocks of a parallel fill
+		void long_jump();
+
+	private:
+		uint64 _s[4][lanes]; // word, lane
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// bulk generation. uniform reals are in [min, max), integers in [min, max] without bias (lemire's method with
+	// rejection), normals use box-muller on two uniforms
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// [0, 1) from the high 52 or 23 bits, by filling the mantissa of a value in [1, 2)
+	double unit_double(uint64 bits);
+	float unit_float(uint32 bits);
+
+	// two independent standard normals from two random words
+	void normal_pair(uint64 bits1, uint64 bits2, double& z1, double& z2);
+
+	// uniform in [0, range), range = 0 means every 64 bit value
+	// ref: https://arxiv.org/abs/1805.10941
+	template<typename t_next>
+	uint64 bounded_random(t_next& next, uint64 range);
+
+	// any engine producing 64 bits, one number at a time
+	template<typename t_engine>
+	void fill_uniform(t_engine& engine, float* out, size_t count, float min, float max);
+
+	template<typename t_engine>
+	void fill_uniform(t_engine& engine, double* out, size_t count, double min, double max);
+
+	template<typename t_engine, typename t_value>
+	typename std::enable_if<std::is_integral<t_value>::value>::type fill_uniform(t_engine& engine, t_value* out, size_t count, t_value min, t_value max);
+
+	template<typename t_engine>
+	void fill_normal(t_engine& engine, float* out, size_t count, float mean, float stddev);
+
+	template<typename t_engine>
+	void fill_normal(t_engine& engine, double* out, size_t count, double mean, double stddev);
+
+	// vectorized
+	void fill_uniform(xoshiro256ss_x4& generator, float* out, size_t count, float min, float max);
+	void fill_uniform(xoshiro256ss_x4& generator, double* out, size_t count, double min, double max);
+	void fill_uniform(xoshiro256ss_x4& generator, int32* out, size_t count, int32 min, int32 max);
+	void fill_uniform(xoshiro256ss_x4& generator, uint32* out, size_t count, uint32 min, uint32 max);
+	void fill_uniform(xoshiro256ss_x4& generator, int64* out, size_t count, int64 min, int64 max);
+	void fill_uniform(xoshiro256ss_x4& generator, uint64* out, size_t count, uint64 min, uint64 max);
+	void fill_normal(xoshiro256ss_x4& generator, float* out, size_t count, float mean, float stddev);
+	void fill_normal(xoshiro256ss_x4& generator, double* out, size_t count, double mean, double stddev);
+
+	// calls fill(block_generator, out + first, n) on blocks of xoshiro256ss_x4::parallel_block numbers on the pool.
+	// block b draws from generator long jumped b times, so the output does not depend on the number of threads.
+	// generator ends long jumped once per block
+	template<typename t_value, typename t_fill>
+	void parallel_fill(xoshiro256ss_x4& generator, t_value* out, size_t count, t_fill fill, thread_pool& pool = thread_pool::global());
+
+	template<typename t_value>
+	void parallel_fill_uniform(xoshiro256ss_x4& generator, t_value* out, size_t count, t_value min, t_value max, thread_pool& pool = thread_pool::global());
+
+	template<typename t_value>
+	void parallel_fill_normal(xoshiro256ss_x4& generator, t_value* out, size_t count, t_value mean, t_value stddev, thread_pool& pool = thread_pool::global());
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_next>
+	uint64 bounded_random(t_next& next, uint64 range)
+	{
+		if(range == 0)
+		{
+			return next();
+		}
+		uint64 low;
+		uint64 high = multiply_high(next(), range, low);
+		if(low < range)
+		{
+			const uint64 threshold = (0 - range) % range;
+			while(low < threshold)
+			{
+				high = multiply_high(next(), range, low);
+			}
+		}
+		return high;
+	}
+
+	template<typename t_engine>
+	void fill_uniform(t_engine& engine, float* out, size_t count, float min, float max)
+	{
+		// two numbers per call
+		const float range = max - min;
+		size_t i = 0;
+		for(; i + 2 <= count; i += 2)
+		{
+			const uint64 bits = engine();
+			out[i] = min + unit_float(static_cast<uint32>(bits)) * range;
+			out[i + 1] = min + unit_float(static_cast<uint32>(bits >> 32)) * range;
+		}
+		if(i < count)
+		{
+			out[i] = min + unit_float(static_cast<uint32>(engine())) * range;
+		}
+	}
+
+	template<typename t_engine>
+	void fill_uniform(t_engine& engine, double* out, size_t count, double min, double max)
+	{
+		const double range = max - min;
+		for(size_t i = 0; i < count; ++i)
+		{
+			out[i] = min + unit_double(engine()) * range;
+		}
+	}
+
+	template<typename t_engine, typename t_value>
+	typename std::enable_if<std::is_integral<t_value>::value>::type fill_uniform(t_engine& engine, t_value* out, size_t count, t_value min, t_value max)
+	{
+		// wraps to 0 for the full 64 bit range
+		const uint64 range = static_cast<uint64>(max) - static_cast<uint64>(min) + 1;
+		for(size_t i = 0; i < count; ++i)
+		{
+			out[i] = static_cast<t_value>(static_cast<uint64>(min) + bounded_random(engine, range));
+		}
+	}
+
+	template<typename t_engine>
+	void fill_normal(t_engine& engine, float* out, size_t count, float mean, float stddev)
+	{
+		for(size_t i = 0; i < count; i += 2)
+		{
+			const uint64 bits1 = engine();
+			const uint64 bits2 = engine();
+			double z1, z2;
+			normal_pair(bits1, bits2, z1, z2);
+			out[i] = mean + static_cast<float>(z1) * stddev;
+			if(i + 1 < count)
+			{
+				out[i + 1] = mean + static_cast<float>(z2) * stddev;
+			}
+		}
+	}
+
+	template<typename t_engine>
+	void fill_normal(t_engine& engine, double* out, size_t count, double mean, double stddev)
+	{
+		for(size_t i = 0; i < count; i += 2)
+		{
+			const uint64 bits1 = engine();
+			const uint64 bits2 = engine();
+			double z1, z2;
+			normal_pair(bits1, bits2, z1, z2);
+			out[i] = mean + z1 * stddev;
+			if(i + 1 < count)
+			{
+				out[i + 1] = mean + z2 * stddev;
+			}
+		}
+	}
+
+	template<typename t_value, typename t_fill>
+	void parallel_fill(xoshiro256ss_x4& generator, t_value* out, size_t count, t_fill fill, thread_pool& pool)
+	{
+		const size_t block = xoshiro256ss_x4::parallel_block;
+		const size_t blocks = (count + block - 1) / block;
+		const size_t blocks_per_task = std::max<size_t>(1, blocks / (pool.size() * 4));
+		const size_t tasks = (blocks + blocks_per_task - 1) / blocks_per_task;
+
+		// the jumps to the first block of every task, the generator ends past the last block
+		std::vector<xoshiro256ss_x4> starts(tasks);
+		for(size_t t = 0; t < tasks; ++t)
+		{
+			starts[t] = generator;
+			for(size_t b = t * blocks_per_task; b < std::min(blocks, (t + 1) * blocks_per_task); ++b)
+			{
+				generator.long_jump();
+			}
+		}
+
+		pool.parallel_for(0, tasks, 1, [&](size_t first, size_t last)
+		{
+			for(size_t t = first; t < last; ++t)
+			{
+				xoshiro256ss_x4 block_generator = starts[t];
+				for(size_t b = t * blocks_per_task; b < std::min(blocks, (t + 1) * blocks_per_task); ++b)
+				{
+					xoshiro256ss_x4 g = block_generator;
+					fill(g, out + b * block, std::min(block, count - b * block));
+					block_generator.long_jump();
+				}
+			}
+		});
+	}
+
+	template<typename t_value>
+	void parallel_fill_uniform(xoshiro256ss_x4& generator, t_value* out, size_t count, t_value min, t_value max, thread_pool& pool)
+	{
+		parallel_fill(generator, out, count, [min, max](xoshiro256ss_x4& g, t_value* first, size_t n)
+		{
+			fill_uniform(g, first, n, min, max);
+		}, pool);
+	}
+
+	template<typename t_value>
+	void parallel_fill_normal(xoshiro256ss_x4& generator, t_value* out, size_t count, t_value mean, t_value stddev, thread_pool& pool)
+	{
+		parallel_fill(generator, out, count, [mean, stddev](xoshiro256ss_x4& g, t_value* first, size_t n)
+		{
+			fill_normal(g, first, n, mean, stddev);
+		}, pool);
+	}
 } // namespace bl
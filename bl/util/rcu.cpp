@@ -0,0 +1,183 @@
+#include <bl/util/rcu.h>
+#include <bl/util/atomic.h>
+#include <bl/util/integer.h>
+#include <bl/util/thread.h>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace bl
+{
+	// readers count themselves on one of two epoch slots, spread over stripes so they do not share cache lines
+	struct rcu_stripe
+	{
+		atomic<int64> readers[2];
+		char pad[BL_CACHE_LINE_SIZE - 2 * sizeof(atomic<int64>)];
+	};
+
+	struct rcu_retired
+	{
+		void (*destroy)(void*);
+		void* ptr;
+	};
+
+	static const unsigned s_stripe_count = 32;
+	static const size_t s_retire_threshold = 256; // pending reclamations that trigger a synchronize
+
+	static rcu_stripe s_stripes[s_stripe_count];
+	static atomic<unsigned> s_epoch(0);
+	static mutex s_synchronize_mutex;
+	static mutex s_retired_mutex;
+	static std::vector<rcu_retired>* s_retired = nullptr; // created on first use, never destroyed
+	static thread_local int t_depth[2];                   // read sections of this thread per slot
+
+	unsigned rcu_read_lock()
+	{
+		const unsigned slot = s_epoch.load(std::memory_order_seq_cst) & 1;
+		s_stripes[this_thread_index() % s_stripe_count].readers[slot].fetch_add(1, std::memory_order_seq_cst);
+		++t_depth[slot];
+		return slot;
+	}
+
+	void rcu_read_unlock(unsigned epoch)
+	{
+		--t_depth[epoch];
+		s_stripes[this_thread_index() % s_stripe_count].readers[epoch].fetch_sub(1, std::memory_order_release);
+	}
+
+	bool rcu_in_read_section()
+	{
+		return t_depth[0] + t_depth[1] != 0;
+	}
+
+	static void s_wait_slot(unsigned slot)
+	{
+		int spins = 0;
+		for(;;)
+		{
+			int64 readers = 0;
+			for(const rcu_stripe& s : s_stripes)
+			{
+				readers += s.readers[slot].load(std::memory_order_seq_cst);
+			}
+			if(readers == 0)
+			{
+				return;
+			}
+			if(++spins < 64)
+			{
+				cpu_pause();
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void rcu_synchronize()
+	{
+		if(rcu_in_read_section())
+		{
+			throw std::logic_error("rcu_synchronize inside a read section");
+		}
+
+		std::vector<rcu_retired> batch;
+		{
+			mutex_lock l(s_retired_mutex);
+			if(s_retired != nullptr)
+			{
+				batch.swap(*s_retired);
+			}
+		}
+
+		{
+			// two flips: a reader may have read the epoch before the previous flip and counted itself on the slot
+			// that is current now, after the new version was published
+			mutex_lock l(s_synchronize_mutex);
+			for(int flip = 0; flip < 2; ++flip)
+			{
+				const unsigned old_slot = s_epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+				s_wait_slot(old_slot);
+			}
+		}
+
+		for(const rcu_retired& r : batch)
+		{
+			r.destroy(r.ptr);
+		}
+	}
+
+	// runs the synchronize that writers inside read sections must not, so neither they nor the readers wait for it.
+	// created on first use and never destroyed, like s_retired: rcu may still be used by static destructors
+	class rcu_reclaimer
+	{
+	public:
+		rcu_reclaimer()
+			: _requested(false)
+		{
+			thread([this]()
+			{
+				_run();
+			}).detach();
+		}
+
+		void request()
+		{
+			{
+				mutex_lock l(_mutex);
+				_requested = true;
+			}
+			_condition.notify_one();
+		}
+
+	private:
+		void _run()
+		{
+			unique_mutex_lock l(_mutex);
+			for(;;)
+			{
+				_condition.wait(l, [this]{ return _requested; });
+				_requested = false;
+				l.unlock();
+				rcu_synchronize();
+				l.lock();
+			}
+		}
+
+		mutex _mutex;
+		condition_variable _condition;
+		bool _requested;
+	};
+
+	static rcu_reclaimer& s_reclaimer()
+	{
+		static rcu_reclaimer* reclaimer = new rcu_reclaimer();
+		return *reclaimer;
+	}
+
+	void rcu_defer(void (*destroy)(void*), void* ptr)
+	{
+		bool full;
+		{
+			mutex_lock l(s_retired_mutex);
+			if(s_retired == nullptr)
+			{
+				s_retired = new std::vector<rcu_retired>();
+			}
+			s_retired->push_back(rcu_retired{destroy, ptr});
+			full = s_retired->size() >= s_retire_threshold;
+		}
+		if(full)
+		{
+			if(rcu_in_read_section())
+			{
+				s_reclaimer().request();
+			}
+			else
+			{
+				rcu_synchronize();
+			}
+		}
+	}
+} // namespace bl
@@ -0,0 +1,66 @@
+#pragma once
+#include <bl/util/platform.h>
+#include <cstddef>
+
+// process wide read-copy-update: readers of a shared structure announce themselves on a striped counter of the current
+// epoch and never block, writers publish a new version and then either wait for the readers of the old one to leave
+// (rcu_synchronize) or hand the old version over for deferred reclamation (rcu_retire)
+// ref: https://www.kernel.org/doc/html/latest/RCU/whatisRCU.html
+namespace bl
+{
+	// read side section, may nest. the pointers loaded inside stay valid until it ends
+	unsigned rcu_read_lock();
+	void rcu_read_unlock(unsigned epoch);
+
+	class rcu_read_guard
+	{
+	public:
+		rcu_read_guard();
+		~rcu_read_guard();
+
+		rcu_read_guard(const rcu_read_guard&) = delete;
+		rcu_read_guard& operator=(const rcu_read_guard&) = delete;
+
+	private:
+		unsigned _epoch;
+	};
+
+	// true between rcu_read_lock() and the matching rcu_read_unlock() of the calling thread
+	bool rcu_in_read_section();
+
+	// waits until every read section begun before the call ended, then reclaims what was retired before the call.
+	// throws std::logic_error inside a read section: two threads waiting there for each other would never return
+	void rcu_synchronize();
+
+	// destroy(ptr) runs once every reader that may still see ptr has left, the caller does not wait. once enough is
+	// pending, a call outside of a read section synchronizes (so do not call it holding a lock that readers take inside
+	// their read sections), a call inside of one hands that to a background thread. read sections never reclaim
+	void rcu_defer(void (*destroy)(void*), void* ptr);
+
+	template<typename t_value>
+	void rcu_retire(t_value* ptr);
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline rcu_read_guard::rcu_read_guard()
+		: _epoch(rcu_read_lock())
+	{
+	}
+
+	inline rcu_read_guard::~rcu_read_guard()
+	{
+		rcu_read_unlock(_epoch);
+	}
+
+	template<typename t_value>
+	void rcu_retire(t_value* ptr)
+	{
+		if(ptr != nullptr)
+		{
+			rcu_defer([](void* p)
+			{
+				delete static_cast<t_value*>(p);
+			}, const_cast<void*>(static_cast<const void*>(ptr)));
+		}
+	}
+} // namespace bl
@@ -0,0 +1,574 @@
+#pragma once
+#include <bl/util/atomic.h>
+#include <bl/util/memory.h>
+#include <bl/util/platform.h>
+#include <bl/util/thread.h>
+#include <cstdint>
+#include <new>
+
+namespace bl
+{
+	// round up to the next power of two (at least 2)
+	inline size_t ring_capacity(size_t requested)
+	{
+		size_t capacity = 2;
+		while(capacity < requested)
+		{
+			capacity <<= 1;
+		}
+		return capacity;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// single producer / single consumer ring buffer
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	class spsc_ring_buffer
+	{
+	public:
+		typedef t_value value_type;
+		typedef size_t size_type;
+
+		// capacity is rounded up to a power of two
+		explicit spsc_ring_buffer(size_t capacity);
+		~spsc_ring_buffer();
+
+		spsc_ring_buffer(const spsc_ring_buffer&) = delete;
+		spsc_ring_buffer& operator=(const spsc_ring_buffer&) = delete;
+
+		// producer side
+		bool try_push(const t_value& value);
+		bool try_push(t_value&& value);
+		size_t try_push_n(const t_value* values, size_t count);
+		void push(const t_value& value);
+		void push(t_value&& value);
+
+		// wakes w once there is room, see spin_waiter::park. false when there is room already
+		bool park_push(spin_waiter::parked& w);
+
+		// consumer side
+		bool try_pop(t_value& value);
+		size_t try_pop_n(t_value* values, size_t count);
+		void pop(t_value& value);
+
+		// wakes w once there is a value, false when there is one already
+		bool park_pop(spin_waiter::parked& w);
+
+		// approximate when called concurrently
+		bool empty() const;
+		size_t size() const;
+		size_t capacity() const;
+
+	private:
+		// without notifying
+		template<typename t_arg>
+		bool _try_push(t_arg&& value);
+		bool _try_pop(t_value& value);
+
+		t_value* _values;
+		size_t _mask;
+
+		// consumer owned
+		char _pad0[BL_CACHE_LINE_SIZE];
+		atomic<size_t> _head;
+		size_t _tail_cache;
+
+		// producer owned
+		char _pad1[BL_CACHE_LINE_SIZE - sizeof(atomic<size_t>) - sizeof(size_t)];
+		atomic<size_t> _tail;
+		size_t _head_cache;
+		char _pad2[BL_CACHE_LINE_SIZE - sizeof(atomic<size_t>) - sizeof(size_t)];
+
+		spin_waiter _not_empty;
+		spin_waiter _not_full;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// bounded multiple producer / multiple consumer queue
+	// ref: http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	class mpmc_queue
+	{
+	public:
+		typedef t_value value_type;
+		typedef size_t size_type;
+
+		// capacity is rounded up to a power of two
+		explicit mpmc_queue(size_t capacity);
+		~mpmc_queue();
+
+		mpmc_queue(const mpmc_queue&) = delete;
+		mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+		bool try_push(const t_value& value);
+		bool try_push(t_value&& value);
+		size_t try_push_n(const t_value* values, size_t count);
+		void push(const t_value& value);
+		void push(t_value&& value);
+
+		bool try_pop(t_value& value);
+		size_t try_pop_n(t_value* values, size_t count);
+		void pop(t_value& value);
+
+		// wakes w once there is room / a value, see spin_waiter::park. false when there is already.
+		// a woken w may still lose the slot to another thread
+		bool park_push(spin_waiter::parked& w);
+		bool park_pop(spin_waiter::parked& w);
+
+		// approximate when called concurrently
+		bool empty() const;
+		size_t size() const;
+		size_t capacity() const;
+
+	private:
+		struct cell
+		{
+			atomic<size_t> sequence;
+			t_value value;
+		};
+
+		// without notifying
+		template<typename t_arg>
+		bool _try_push(t_arg&& value);
+		size_t _try_pop_n(t_value* values, size_t count);
+
+		// claims up to count consecutive positions from the given counter, returns the first position in pos
+		size_t _claim(atomic<size_t>& counter, size_t& pos, size_t count, size_t ready_offset);
+
+		cell* _cells;
+		size_t _mask;
+
+		char _pad0[BL_CACHE_LINE_SIZE];
+		atomic<size_t> _enqueue_pos;
+		char _pad1[BL_CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+		atomic<size_t> _dequeue_pos;
+		char _pad2[BL_CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+
+		spin_waiter _not_empty;
+		spin_waiter _not_full;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	spsc_ring_buffer<t_value>::spsc_ring_buffer(size_t capacity)
+		: _values(nullptr), _mask(ring_capacity(capacity) - 1), _head(0), _tail_cache(0), _tail(0), _head_cache(0)
+	{
+		_values = static_cast<t_value*>(aligned_malloc(sizeof(t_value) * (_mask + 1), BL_CACHE_LINE_SIZE));
+		if(_values == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		for(size_t i = 0; i <= _mask; ++i)
+		{
+			new(_values + i) t_value();
+		}
+	}
+
+	template<typename t_value>
+	spsc_ring_buffer<t_value>::~spsc_ring_buffer()
+	{
+		for(size_t i = 0; i <= _mask; ++i)
+		{
+			_values[i].~t_value();
+		}
+		aligned_free(_values);
+	}
+
+	template<typename t_value>
+	template<typename t_arg>
+	bool spsc_ring_buffer<t_value>::_try_push(t_arg&& value)
+	{
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		if(tail - _head_cache > _mask)
+		{
+			_head_cache = _head.load(std::memory_order_acquire);
+			if(tail - _head_cache > _mask)
+			{
+				return false;
+			}
+		}
+		_values[tail & _mask] = std::forward<t_arg>(value);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	template<typename t_value>
+	bool spsc_ring_buffer<t_value>::try_push(const t_value& value)
+	{
+		if(!_try_push(value))
+		{
+			return false;
+		}
+		_not_empty.notify_one_relaxed();
+		return true;
+	}
+
+	template<typename t_value>
+	bool spsc_ring_buffer<t_value>::try_push(t_value&& value)
+	{
+		if(!_try_push(std::move(value)))
+		{
+			return false;
+		}
+		_not_empty.notify_one_relaxed();
+		return true;
+	}
+
+	template<typename t_value>
+	size_t spsc_ring_buffer<t_value>::try_push_n(const t_value* values, size_t count)
+	{
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		size_t space = _mask + 1 - (tail - _head_cache);
+		if(space < count)
+		{
+			_head_cache = _head.load(std::memory_order_acquire);
+			space = _mask + 1 - (tail - _head_cache);
+		}
+		const size_t n = count < space ? count : space;
+		for(size_t i = 0; i < n; ++i)
+		{
+			_values[(tail + i) & _mask] = values[i];
+		}
+		if(n > 0)
+		{
+			_tail.store(tail + n, std::memory_order_release);
+			_not_empty.notify_all_relaxed();
+		}
+		return n;
+	}
+
+	template<typename t_value>
+	void spsc_ring_buffer<t_value>::push(const t_value& value)
+	{
+		// the consumer may only use try_pop, whose notification can miss us while we go to sleep
+		while(!_try_push(value))
+		{
+			_not_full.wait_relaxed([this]{ return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_acquire) <= _mask; });
+		}
+		_not_empty.notify_one();
+	}
+
+	template<typename t_value>
+	void spsc_ring_buffer<t_value>::push(t_value&& value)
+	{
+		while(!_try_push(std::move(value)))
+		{
+			_not_full.wait_relaxed([this]{ return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_acquire) <= _mask; });
+		}
+		_not_empty.notify_one();
+	}
+
+	template<typename t_value>
+	bool spsc_ring_buffer<t_value>::try_pop(t_value& value)
+	{
+		if(!_try_pop(value))
+		{
+			return false;
+		}
+		_not_full.notify_one_relaxed();
+		return true;
+	}
+
+	template<typename t_value>
+	bool spsc_ring_buffer<t_value>::_try_pop(t_value& value)
+	{
+		const size_t head = _head.load(std::memory_order_relaxed);
+		if(head == _tail_cache)
+		{
+			_tail_cache = _tail.load(std::memory_order_acquire);
+			if(head == _tail_cache)
+			{
+				return false;
+			}
+		}
+		value = std::move(_values[head & _mask]);
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	template<typename t_value>
+	size_t spsc_ring_buffer<t_value>::try_pop_n(t_value* values, size_t count)
+	{
+		const size_t head = _head.load(std::memory_order_relaxed);
+		size_t available = _tail_cache - head;
+		if(available < count)
+		{
+			_tail_cache = _tail.load(std::memory_order_acquire);
+			available = _tail_cache - head;
+		}
+		const size_t n = count < available ? count : available;
+		for(size_t i = 0; i < n; ++i)
+		{
+			values[i] = std::move(_values[(head + i) & _mask]);
+		}
+		if(n > 0)
+		{
+			_head.store(head + n, std::memory_order_release);
+			_not_full.notify_all_relaxed();
+		}
+		return n;
+	}
+
+	template<typename t_value>
+	void spsc_ring_buffer<t_value>::pop(t_value& value)
+	{
+		while(!_try_pop(value))
+		{
+			_not_empty.wait_relaxed([this]{ return _tail.load(std::memory_order_acquire) != _head.load(std::memory_order_relaxed); });
+		}
+		_not_full.notify_one();
+	}
+
+	template<typename t_value>
+	bool spsc_ring_buffer<t_value>::park_push(spin_waiter::parked& w)
+	{
+		return _not_full.park(w, [this]{ return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_acquire) <= _mask; });
+	}
+
+	template<typename t_value>
+	bool spsc_ring_buffer<t_value>::park_pop(spin_waiter::parked& w)
+	{
+		return _not_empty.park(w, [this]{ return _tail.load(std::memory_order_acquire) != _head.load(std::memory_order_relaxed); });
+	}
+
+	template<typename t_value>
+	bool spsc_ring_buffer<t_value>::empty() const
+	{
+		return size() == 0;
+	}
+
+	template<typename t_value>
+	size_t spsc_ring_buffer<t_value>::size() const
+	{
+		return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+	}
+
+	template<typename t_value>
+	size_t spsc_ring_buffer<t_value>::capacity() const
+	{
+		return _mask + 1;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	mpmc_queue<t_value>::mpmc_queue(size_t capacity)
+		: _cells(nullptr), _mask(ring_capacity(capacity) - 1), _enqueue_pos(0), _dequeue_pos(0)
+	{
+		_cells = static_cast<cell*>(aligned_malloc(sizeof(cell) * (_mask + 1), BL_CACHE_LINE_SIZE));
+		if(_cells == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		for(size_t i = 0; i <= _mask; ++i)
+		{
+			new(_cells + i) cell();
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	template<typename t_value>
+	mpmc_queue<t_value>::~mpmc_queue()
+	{
+		for(size_t i = 0; i <= _mask; ++i)
+		{
+			_cells[i].~cell();
+		}
+		aligned_free(_cells);
+	}
+
+	template<typename t_value>
+	size_t mpmc_queue<t_value>::_claim(atomic<size_t>& counter, size_t& pos, size_t count, size_t ready_offset)
+	{
+		// a cell is ready for us at position p when its sequence equals p + ready_offset
+		// (0 for producers waiting on an empty cell, 1 for consumers waiting on a full one)
+		pos = counter.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			size_t n = 0;
+			intptr_t dif = 0;
+			while(n < count)
+			{
+				const size_t seq = _cells[(pos + n) & _mask].sequence.load(std::memory_order_acquire);
+				dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + n + ready_offset);
+				if(dif != 0)
+				{
+					break;
+				}
+				++n;
+			}
+
+			if(n == 0)
+			{
+				if(dif < 0)
+				{
+					// full for producers, empty for consumers
+					return 0;
+				}
+				// another thread moved the counter past us
+				pos = counter.load(std::memory_order_relaxed);
+			}
+			else if(counter.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+			{
+				return n;
+			}
+		}
+	}
+
+	template<typename t_value>
+	template<typename t_arg>
+	bool mpmc_queue<t_value>::_try_push(t_arg&& value)
+	{
+		size_t pos;
+		if(_claim(_enqueue_pos, pos, 1, 0) == 0)
+		{
+			return false;
+		}
+		cell& c = _cells[pos & _mask];
+		c.value = std::forward<t_arg>(value);
+		c.sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	template<typename t_value>
+	bool mpmc_queue<t_value>::try_push(const t_value& value)
+	{
+		if(!_try_push(value))
+		{
+			return false;
+		}
+		_not_empty.notify_one_relaxed();
+		return true;
+	}
+
+	template<typename t_value>
+	bool mpmc_queue<t_value>::try_push(t_value&& value)
+	{
+		if(!_try_push(std::move(value)))
+		{
+			return false;
+		}
+		_not_empty.notify_one_relaxed();
+		return true;
+	}
+
+	template<typename t_value>
+	size_t mpmc_queue<t_value>::try_push_n(const t_value* values, size_t count)
+	{
+		size_t pos;
+		const size_t n = _claim(_enqueue_pos, pos, count, 0);
+		for(size_t i = 0; i < n; ++i)
+		{
+			cell& c = _cells[(pos + i) & _mask];
+			c.value = values[i];
+			c.sequence.store(pos + i + 1, std::memory_order_release);
+		}
+		if(n > 0)
+		{
+			_not_empty.notify_all_relaxed();
+		}
+		return n;
+	}
+
+	template<typename t_value>
+	void mpmc_queue<t_value>::push(const t_value& value)
+	{
+		// consumers may only use try_pop, whose notification can miss us while we go to sleep
+		while(!_try_push(value))
+		{
+			_not_full.wait_relaxed([this]{ return !(_enqueue_pos.load(std::memory_order_relaxed) - _dequeue_pos.load(std::memory_order_acquire) > _mask); });
+		}
+		_not_empty.notify_one();
+	}
+
+	template<typename t_value>
+	void mpmc_queue<t_value>::push(t_value&& value)
+	{
+		while(!_try_push(std::move(value)))
+		{
+			_not_full.wait_relaxed([this]{ return !(_enqueue_pos.load(std::memory_order_relaxed) - _dequeue_pos.load(std::memory_order_acquire) > _mask); });
+		}
+		_not_empty.notify_one();
+	}
+
+	template<typename t_value>
+	bool mpmc_queue<t_value>::try_pop(t_value& value)
+	{
+		return try_pop_n(&value, 1) == 1;
+	}
+
+	template<typename t_value>
+	size_t mpmc_queue<t_value>::try_pop_n(t_value* values, size_t count)
+	{
+		const size_t n = _try_pop_n(values, count);
+		if(n == 1)
+		{
+			_not_full.notify_one_relaxed();
+		}
+		else if(n > 1)
+		{
+			_not_full.notify_all_relaxed();
+		}
+		return n;
+	}
+
+	template<typename t_value>
+	size_t mpmc_queue<t_value>::_try_pop_n(t_value* values, size_t count)
+	{
+		size_t pos;
+		const size_t n = _claim(_dequeue_pos, pos, count, 1);
+		for(size_t i = 0; i < n; ++i)
+		{
+			cell& c = _cells[(pos + i) & _mask];
+			values[i] = std::move(c.value);
+			c.sequence.store(pos + i + _mask + 1, std::memory_order_release);
+		}
+		return n;
+	}
+
+	template<typename t_value>
+	void mpmc_queue<t_value>::pop(t_value& value)
+	{
+		while(_try_pop_n(&value, 1) == 0)
+		{
+			_not_empty.wait_relaxed([this]{ return _enqueue_pos.load(std::memory_order_acquire) != _dequeue_pos.load(std::memory_order_relaxed); });
+		}
+		_not_full.notify_one();
+	}
+
+	template<typename t_value>
+	bool mpmc_queue<t_value>::park_push(spin_waiter::parked& w)
+	{
+		return _not_full.park(w, [this]{ return !(_enqueue_pos.load(std::memory_order_relaxed) - _dequeue_pos.load(std::memory_order_acquire) > _mask); });
+	}
+
+	template<typename t_value>
+	bool mpmc_queue<t_value>::park_pop(spin_waiter::parked& w)
+	{
+		return _not_empty.park(w, [this]{ return _enqueue_pos.load(std::memory_order_acquire) != _dequeue_pos.load(std::memory_order_relaxed); });
+	}
+
+	template<typename t_value>
+	bool mpmc_queue<t_value>::empty() const
+	{
+		return size() == 0;
+	}
+
+	template<typename t_value>
+	size_t mpmc_queue<t_value>::size() const
+	{
+		const size_t dequeue_pos = _dequeue_pos.load(std::memory_order_acquire);
+		const size_t enqueue_pos = _enqueue_pos.load(std::memory_order_acquire);
+		return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+	}
+
+	template<typename t_value>
+	size_t mpmc_queue<t_value>::capacity() const
+	{
+		return _mask + 1;
+	}
+} // namespace bl
@@ -0,0 +1,226 @@
+#include <bl/util/task_graph.h>
+#include <stdexcept>
+
+namespace bl
+{
+	task_graph::node::node(task_graph& g, task_id i, function<void()>&& w)
+		: graph(g), id(i), work(std::move(w)), predecessors(0), pending(0), skip(false), start(0), seconds(0)
+	{
+	}
+
+	void task_graph::node::run()
+	{
+		bool failed = skip.load(std::memory_order_relaxed);
+		start = graph._clock.seconds();
+		if(!failed)
+		{
+			try
+			{
+				work();
+			}
+			catch(...)
+			{
+				failed = true;
+				if(!graph._failed.exchange(true))
+				{
+					graph._error = std::current_exception();
+				}
+			}
+		}
+		seconds = graph._clock.seconds() - start;
+		graph._finish(*this, failed);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	task_graph::task_graph(thread_pool& pool)
+		: _pool(pool), _sorted(true), _run_seconds(0), _remaining(0), _failed(false)
+	{
+	}
+
+	void task_graph::precede(task_id before, task_id after)
+	{
+		_nodes.at(before)->successors.push_back(_nodes.at(after).get());
+		++_nodes[after]->predecessors;
+		_sorted = false;
+	}
+
+	void task_graph::precede(task_id before, std::initializer_list<task_id> after)
+	{
+		for(task_id a : after)
+		{
+			precede(before, a);
+		}
+	}
+
+	void task_graph::succeed(task_id after, std::initializer_list<task_id> before)
+	{
+		for(task_id b : before)
+		{
+			precede(b, after);
+		}
+	}
+
+	void task_graph::set_timing_hook(timing_hook hook)
+	{
+		_hook = std::move(hook);
+	}
+
+	void task_graph::run()
+	{
+		if(!_sorted)
+		{
+			_sort();
+		}
+		if(_nodes.empty())
+		{
+			_run_seconds = 0;
+			return;
+		}
+
+		for(unique_ptr<node>& n : _nodes)
+		{
+			n->pending.store(n->predecessors, std::memory_order_relaxed);
+			n->skip.store(false, std::memory_order_relaxed);
+		}
+		_failed.store(false, std::memory_order_relaxed);
+		_error = nullptr;
+		_remaining.store(_nodes.size(), std::memory_order_release);
+
+		_clock.restart();
+		for(unique_ptr<node>& n : _nodes)
+		{
+			if(n->predecessors == 0)
+			{
+				_pool.push(*n);
+			}
+		}
+		_pool.wait_until([this]()
+		{
+			return _remaining.load(std::memory_order_acquire) == 0;
+		});
+		_run_seconds = _clock.seconds();
+
+		if(_error)
+		{
+			std::rethrow_exception(_error);
+		}
+	}
+
+	void task_graph::clear()
+	{
+		_nodes.clear();
+		_order.clear();
+		_sorted = true;
+	}
+
+	size_t task_graph::size() const
+	{
+		return _nodes.size();
+	}
+
+	double task_graph::task_start(task_id id) const
+	{
+		return _nodes.at(id)->start;
+	}
+
+	double task_graph::task_seconds(task_id id) const
+	{
+		return _nodes.at(id)->seconds;
+	}
+
+	double task_graph::run_seconds() const
+	{
+		return _run_seconds;
+	}
+
+	std::vector<task_graph::task_id> task_graph::critical_path() const
+	{
+		if(_nodes.empty() || !_sorted)
+		{
+			return std::vector<task_id>();
+		}
+
+		// longest path ending at each node, walked in topological order
+		std::vector<double> length(_nodes.size(), 0);
+		std::vector<node*> from(_nodes.size(), nullptr);
+		node* last = nullptr;
+		for(node* n : _order)
+		{
+			length[n->id] += n->seconds;
+			if(last == nullptr || length[n->id] > length[last->id])
+			{
+				last = n;
+			}
+			for(node* s : n->successors)
+			{
+				if(from[s->id] == nullptr || length[n->id] > length[s->id])
+				{
+					length[s->id] = length[n->id];
+					from[s->id] = n;
+				}
+			}
+		}
+
+		std::vector<task_id> path;
+		for(node* n = last; n != nullptr; n = from[n->id])
+		{
+			path.push_back(n->id);
+		}
+		return std::vector<task_id>(path.rbegin(), path.rend());
+	}
+
+	void task_graph::_sort()
+	{
+		// kahn's algorithm, leftover nodes are on a cycle
+		std::vector<size_t> in(_nodes.size());
+		_order.clear();
+		for(unique_ptr<node>& n : _nodes)
+		{
+			in[n->id] = n->predecessors;
+			if(n->predecessors == 0)
+			{
+				_order.push_back(n.get());
+			}
+		}
+		for(size_t i = 0; i < _order.size(); ++i)
+		{
+			for(node* s : _order[i]->successors)
+			{
+				if(--in[s->id] == 0)
+				{
+					_order.push_back(s);
+				}
+			}
+		}
+		if(_order.size() != _nodes.size())
+		{
+			_order.clear();
+			throw std::logic_error("task_graph::run: dependency cycle");
+		}
+		_sorted = true;
+	}
+
+	void task_graph::_finish(node& n, bool failed)
+	{
+		if(_hook)
+		{
+			_hook(n.id, n.start, n.seconds);
+		}
+
+		for(node* s : n.successors)
+		{
+			if(failed)
+			{
+				s->skip.store(true, std::memory_order_relaxed);
+			}
+			if(s->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				_pool.push(*s);
+			}
+		}
+
+		// last access to the graph, run() may return right after
+		_remaining.fetch_sub(1, std::memory_order_acq_rel);
+	}
+} // namespace bl
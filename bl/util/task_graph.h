@@ -0,0 +1,100 @@
+#pragma once
+#include <bl/util/atomic.h>
+#include <bl/util/function.h>
+#include <bl/util/memory.h>
+#include <bl/util/thread_pool.h>
+#include <bl/util/timer.h>
+#include <exception>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace bl
+{
+	// dag of tasks run on a thread_pool: a task is pushed to the pool as soon as its last predecessor finished.
+	// the graph is built once and can be run any number of times, a run allocates nothing in the graph. the pool may:
+	// run() outside of a worker pushes the roots through its injection queue (a std::deque), and a worker deque grows
+	// the first time more tasks are ready at once than it holds.
+	// the start and duration of every task of the last run are kept to find the critical path
+	class task_graph
+	{
+	public:
+		typedef size_t task_id;
+
+		// called on the worker after each task with its start (seconds since run() began) and duration
+		typedef function<void(task_id id, double start, double seconds)> timing_hook;
+
+		explicit task_graph(thread_pool& pool = thread_pool::global());
+
+		task_graph(const task_graph&) = delete;
+		task_graph& operator=(const task_graph&) = delete;
+
+		template<typename t_function>
+		task_id add(t_function function);
+
+		// after starts once before finished
+		void precede(task_id before, task_id after);
+		void precede(task_id before, std::initializer_list<task_id> after);
+		void succeed(task_id after, std::initializer_list<task_id> before);
+
+		void set_timing_hook(timing_hook hook);
+
+		// runs every task and returns when all finished, rethrows the first exception a task threw (the tasks
+		// depending on it are skipped). throws std::logic_error when the dependencies contain a cycle.
+		// not reentrant: one run at a time per graph
+		void run();
+
+		void clear();
+		size_t size() const;
+
+		// timings of the last run, in seconds
+		double task_start(task_id id) const;
+		double task_seconds(task_id id) const;
+		double run_seconds() const;
+
+		// chain of dependent tasks with the largest total duration in the last run, first task first
+		std::vector<task_id> critical_path() const;
+
+	private:
+		struct node : public thread_pool::task
+		{
+			node(task_graph& graph, task_id id, function<void()>&& work);
+			void run() override;
+
+			task_graph& graph;
+			task_id id;
+			function<void()> work;
+			std::vector<node*> successors;
+			size_t predecessors;
+			atomic<size_t> pending;
+			atomic<bool> skip; // set by a failed predecessor
+			double start;
+			double seconds;
+		};
+
+		void _sort();
+		void _finish(node& n, bool failed);
+
+		thread_pool& _pool;
+		std::vector<unique_ptr<node>> _nodes;
+		std::vector<node*> _order; // topological order, rebuilt after changes
+		bool _sorted;
+		timing_hook _hook;
+		timer _clock;
+		double _run_seconds;
+		atomic<size_t> _remaining;
+		atomic<bool> _failed;
+		std::exception_ptr _error;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_function>
+	task_graph::task_id task_graph::add(t_function function)
+	{
+		const task_id id = _nodes.size();
+		_nodes.emplace_back(new node(*this, id, bl::function<void()>(std::move(function))));
+		_sorted = false;
+		return id;
+	}
+} // namespace bl
@@ -1,7 +1,120 @@
 #include <bl/util/thread.h>
 
+#if defined(BL_OS_LINUX)
+#include <climits>
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(BL_OS_WIN)
+#include <windows.h>
+#endif
+
 namespace bl
 {
+	static atomic<unsigned> s_thread_count(0);
+	static thread_local unsigned t_thread_index = 0; // 0 = unassigned, else index+1
+
+	unsigned this_thread_index()
+	{
+		if(t_thread_index == 0)
+		{
+			t_thread_index = s_thread_count.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+		return t_thread_index - 1;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	static_assert(sizeof(atomic<uint32>) == sizeof(uint32), "futex word must be a plain 32 bit integer");
+
+#if defined(BL_OS_LINUX)
+	static void s_futex(atomic<uint32>& word, int op, uint32 value)
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32*>(&word), op, value, nullptr, nullptr, 0);
+	}
+
+	void futex_wait(atomic<uint32>& word, uint32 expected)
+	{
+		s_futex(word, FUTEX_WAIT_PRIVATE, expected);
+	}
+
+	void futex_wake_one(atomic<uint32>& word)
+	{
+		s_futex(word, FUTEX_WAKE_PRIVATE, 1);
+	}
+
+	void futex_wake_all(atomic<uint32>& word)
+	{
+		s_futex(word, FUTEX_WAKE_PRIVATE, INT_MAX);
+	}
+#else
+	// waiters on the same bucket share a condition variable, wakes notify all of them
+	struct futex_bucket
+	{
+		mutex m;
+		condition_variable condition;
+	};
+
+	static futex_bucket& s_futex_bucket(const atomic<uint32>& word)
+	{
+		static futex_bucket buckets[64];
+		return buckets[(reinterpret_cast<size_t>(&word) / sizeof(uint32)) % 64];
+	}
+
+	void futex_wait(atomic<uint32>& word, uint32 expected)
+	{
+		futex_bucket& b = s_futex_bucket(word);
+		unique_mutex_lock l(b.m);
+		if(word.load(std::memory_order_acquire) == expected)
+		{
+			b.condition.wait(l);
+		}
+	}
+
+	void futex_wake_one(atomic<uint32>& word)
+	{
+		futex_wake_all(word);
+	}
+
+	void futex_wake_all(atomic<uint32>& word)
+	{
+		futex_bucket& b = s_futex_bucket(word);
+		mutex_lock l(b.m);
+		b.condition.notify_all();
+	}
+#endif
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(BL_OS_LINUX)
+	void process_fence()
+	{
+		static const bool expedited = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+		if(expedited && syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0)
+		{
+			return;
+		}
+
+		// kernels before 4.14: revoking access to a page we dirtied shoots down its tlb entry on every cpu running
+		// one of our threads, the interrupt serializes them
+		static mutex m;
+		static char* page = static_cast<char*>(mmap(nullptr, 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		mutex_lock l(m);
+		mprotect(page, 1, PROT_READ | PROT_WRITE);
+		*static_cast<volatile char*>(page) = 0;
+		mprotect(page, 1, PROT_READ);
+	}
+#else
+	void process_fence()
+	{
+		FlushProcessWriteBuffers();
+	}
+#endif
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
 	thread_control::thread_control()
 		: _need_loop(false),
 		  _in_loop(false),
@@ -16,7 +129,7 @@ namespace bl
 
 	void thread_control::quit()
 	{
-		_quit = true;
+		_quit.store(true, std::memory_order_release);
 		wake();
 	}
 
@@ -30,18 +143,177 @@ namespace bl
 	bool thread_control::loop()
 	{
 		unique_mutex_lock l(_mutex);
-		_in_loop = false;
+		_in_loop.store(false, std::memory_order_release);
 		if(!_need_loop)
 		{
 			_condition.wait(l);
 		}
 		_need_loop = false;
-		_in_loop = true;
-		return !_quit;
+		_in_loop.store(true, std::memory_order_release);
+		return !_quit.load(std::memory_order_acquire);
 	}
 
 	bool thread_control::in_loop() const
 	{
-		return _in_loop;
+		return _in_loop.load(std::memory_order_acquire);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	spin_thread_control::spin_thread_control(unsigned spin_count)
+		: _state(0),
+		  _in_loop(false),
+		  _quit(false),
+		  _spin_count(thread::hardware_concurrency() > 1 ? spin_count : 0) // spinning on a single cpu only delays the waker
+	{
+	}
+
+	spin_thread_control::~spin_thread_control()
+	{
+		quit();
+	}
+
+	void spin_thread_control::quit()
+	{
+		_quit.store(true, std::memory_order_release);
+		wake();
+	}
+
+	void spin_thread_control::wake()
+	{
+		if(_state.exchange(signaled, std::memory_order_acq_rel) & parked)
+		{
+			futex_wake_all(_state);
+		}
+	}
+
+	bool spin_thread_control::loop()
+	{
+		_in_loop.store(false, std::memory_order_release);
+
+		// read before exchanging, so spinning does not steal the cache line from wake()
+		bool woken = false;
+		for(unsigned i = 0; i < _spin_count && !woken; ++i)
+		{
+			woken = (_state.load(std::memory_order_relaxed) & signaled) != 0 && (_state.exchange(0, std::memory_order_acquire) & signaled) != 0;
+			if(!woken)
+			{
+				cpu_pause();
+			}
+		}
+
+		uint32 s = _state.load(std::memory_order_relaxed);
+		while(!woken)
+		{
+			if(s & signaled)
+			{
+				woken = (_state.exchange(0, std::memory_order_acquire) & signaled) != 0;
+			}
+			else if(s == parked || _state.compare_exchange_weak(s, parked, std::memory_order_relaxed))
+			{
+				futex_wait(_state, parked);
+			}
+			s = _state.load(std::memory_order_relaxed);
+		}
+
+		_in_loop.store(true, std::memory_order_release);
+		return !_quit.load(std::memory_order_acquire);
+	}
+
+	bool spin_thread_control::in_loop() const
+	{
+		return _in_loop.load(std::memory_order_acquire);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	spin_waiter::parked::~parked()
+	{
+	}
+
+	spin_waiter::spin_waiter()
+		: _sleepers(0), _parked_head(nullptr), _parked_tail(nullptr)
+	{
+	}
+
+	void spin_waiter::notify_one()
+	{
+		// pairs with the fence in wait(): either we see the sleeper or it sees the published state
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(_sleepers.load(std::memory_order_relaxed) > 0)
+		{
+			_wake(false);
+		}
+	}
+
+	void spin_waiter::notify_all()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(_sleepers.load(std::memory_order_relaxed) > 0)
+		{
+			_wake(true);
+		}
+	}
+
+	void spin_waiter::_wake(bool all)
+	{
+		parked* woken;
+		{
+			mutex_lock l(_mutex);
+			woken = _parked_head;
+			if(woken != nullptr)
+			{
+				parked* last = woken;
+				int count = 1;
+				for(; all && last->_next != nullptr; last = last->_next)
+				{
+					++count;
+				}
+				_parked_head = last->_next;
+				if(_parked_head == nullptr)
+				{
+					_parked_tail = nullptr;
+				}
+				last->_next = nullptr;
+				_sleepers.fetch_sub(count);
+			}
+
+			if(all)
+			{
+				_condition.notify_all();
+			}
+			else
+			{
+				_condition.notify_one();
+			}
+		}
+
+		// wake() may resume and destroy the callback, read the link first
+		while(woken != nullptr)
+		{
+			parked* next = woken->_next;
+			woken->wake();
+			woken = next;
+		}
+	}
+
+	bool spin_waiter::_unpark(parked& w)
+	{
+		mutex_lock l(_mutex);
+		parked* previous = nullptr;
+		for(parked* p = _parked_head; p != nullptr; previous = p, p = p->_next)
+		{
+			if(p == &w)
+			{
+				(previous != nullptr ? previous->_next : _parked_head) = w._next;
+				if(_parked_tail == &w)
+				{
+					_parked_tail = previous;
+				}
+				_sleepers.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
 	}
 } // namespace bl
@@ -1,8 +1,16 @@
 #pragma once
+#include <bl/util/atomic.h>
+#include <bl/util/integer.h>
+#include <bl/util/platform.h>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
 
+#if defined(BL_CPU_X86)
+#include <immintrin.h>
+#endif
+
 #ifdef __GNUG__
 #define thread_local __thread
 #elif defined(_MSC_VER)
@@ -17,6 +25,30 @@ namespace bl
 	typedef std::lock_guard<mutex> mutex_lock;
 	typedef std::unique_lock<mutex> unique_mutex_lock;
 
+	// hint the cpu that we are busy waiting
+	inline void cpu_pause()
+	{
+	#if defined(BL_CPU_X86)
+		_mm_pause();
+	#else
+		std::this_thread::yield();
+	#endif
+	}
+
+	// small dense id of the calling thread (0, 1, 2, ... in order of first call), never reused
+	unsigned this_thread_index();
+
+	// block while word == expected, may return spuriously. a futex on linux, hashed condition variables elsewhere
+	void futex_wait(atomic<uint32>& word, uint32 expected);
+
+	// wake threads blocked on word, call after changing it
+	void futex_wake_one(atomic<uint32>& word);
+	void futex_wake_all(atomic<uint32>& word);
+
+	// full memory barrier executed by every running thread of the process (membarrier, FlushProcessWriteBuffers).
+	// costs a few microseconds, so a rare slow path can pair with hot paths that only have a compiler barrier
+	void process_fence();
+
 	class thread_control
 	{
 	public:
@@ -29,9 +61,306 @@ namespace bl
 
 	private:
 		bool _need_loop;
-		bool _in_loop;
-		bool _quit;
+		atomic<bool> _in_loop;
+		atomic<bool> _quit;
 		mutex _mutex;
 		condition_variable _condition;
 	};
+
+	// thread_control for event loops woken at high rates: loop() spins on an atomic word for a while before parking
+	// on a futex, wake() is a single atomic exchange plus a syscall only when the loop thread is parked
+	class spin_thread_control
+	{
+	public:
+		explicit spin_thread_control(unsigned spin_count = 4096);
+		~spin_thread_control();
+
+		spin_thread_control(const spin_thread_control&) = delete;
+		spin_thread_control& operator=(const spin_thread_control&) = delete;
+
+		void wake();
+		bool loop();
+		bool in_loop() const;
+		void quit();
+
+	private:
+		static const uint32 signaled = 1;
+		static const uint32 parked = 2;
+
+		atomic<uint32> _state; // signaled and parked bits
+		atomic<bool> _in_loop;
+		atomic<bool> _quit;
+		unsigned _spin_count;
+	};
+
+	// spin-then-block wait on a lock-free condition: waiters spin for a while and then sleep on a condition variable,
+	// notifiers only touch the mutex when somebody is actually sleeping
+	class spin_waiter
+	{
+	public:
+		spin_waiter();
+
+		// ready() must read state published by the notifier before calling notify_*
+		template<typename t_predicate>
+		void wait(t_predicate ready);
+
+		void notify_one();
+		void notify_all();
+
+		// for hot paths: no fence, only wakes threads that are already asleep, so a waiter just going to sleep is missed.
+		// waits that may only be ended by these use wait_relaxed, which re-checks ready() every recheck_ms while asleep
+		void notify_one_relaxed();
+		void notify_all_relaxed();
+
+		template<typename t_predicate>
+		void wait_relaxed(t_predicate ready);
+
+		// callback woken by a notify instead of a sleeping thread, for waiting without holding one (coroutine awaiters)
+		class parked
+		{
+		public:
+			virtual ~parked();
+
+			// called once, from the notifying thread
+			virtual void wake() = 0;
+
+		private:
+			friend class spin_waiter;
+			parked* _next;
+		};
+
+		// parks w until the next notify, relaxed ones included, and returns true. returns false instead, with w not
+		// parked, when ready() holds once w is registered and no notify took w meanwhile. w must stay alive until woken
+		template<typename t_predicate>
+		bool park(parked& w, t_predicate ready);
+
+	private:
+		static const int spin_count = 256;
+		static const int yield_count = 16;
+		static const int recheck_ms = 1;
+
+		template<typename t_predicate>
+		bool _spin(t_predicate& ready);
+
+		// wakes sleeping threads and the first (or every) parked callback
+		void _wake(bool all);
+		bool _unpark(parked& w);
+
+		atomic<int> _sleepers; // sleeping threads + parked callbacks
+		mutex _mutex;
+		condition_variable _condition;
+		parked* _parked_head;
+		parked* _parked_tail;
+	};
+
+	// reader-writer spin lock for short critical sections: readers only share one atomic word,
+	// a waiting writer blocks new readers so it cannot starve. usable with std::unique_lock and shared_spin_lock
+	class rw_spin_lock
+	{
+	public:
+		rw_spin_lock();
+
+		rw_spin_lock(const rw_spin_lock&) = delete;
+		rw_spin_lock& operator=(const rw_spin_lock&) = delete;
+
+		void lock();
+		void unlock();
+		void lock_shared();
+		void unlock_shared();
+
+	private:
+		static const unsigned writer = 1u << 31;
+
+		static void _backoff(int& spins);
+
+		atomic<unsigned> _state; // writer bit + reader count
+	};
+
+	// scoped shared ownership of a rw_spin_lock
+	class shared_spin_lock
+	{
+	public:
+		explicit shared_spin_lock(rw_spin_lock& l);
+		~shared_spin_lock();
+
+		shared_spin_lock(const shared_spin_lock&) = delete;
+		shared_spin_lock& operator=(const shared_spin_lock&) = delete;
+
+	private:
+		rw_spin_lock& _lock;
+	};
+
+	typedef std::lock_guard<rw_spin_lock> unique_spin_lock;
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_predicate>
+	void spin_waiter::wait(t_predicate ready)
+	{
+		if(_spin(ready))
+		{
+			return;
+		}
+
+		unique_mutex_lock l(_mutex);
+		_sleepers.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while(!ready())
+		{
+			_condition.wait(l);
+		}
+		_sleepers.fetch_sub(1);
+	}
+
+	template<typename t_predicate>
+	void spin_waiter::wait_relaxed(t_predicate ready)
+	{
+		if(_spin(ready))
+		{
+			return;
+		}
+
+		unique_mutex_lock l(_mutex);
+		_sleepers.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while(!ready())
+		{
+			// unary + passes a copy: milliseconds binds a reference, which would need an out-of-class definition
+			_condition.wait_for(l, std::chrono::milliseconds(+recheck_ms));
+		}
+		_sleepers.fetch_sub(1);
+	}
+
+	inline void spin_waiter::notify_one_relaxed()
+	{
+		// keeps the compiler from hoisting the load above the caller's publishing store, the cpu may still do so.
+		// park() covers that with process_fence()
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+		if(_sleepers.load(std::memory_order_relaxed) > 0)
+		{
+			_wake(false);
+		}
+	}
+
+	inline void spin_waiter::notify_all_relaxed()
+	{
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+		if(_sleepers.load(std::memory_order_relaxed) > 0)
+		{
+			_wake(true);
+		}
+	}
+
+	template<typename t_predicate>
+	bool spin_waiter::park(parked& w, t_predicate ready)
+	{
+		{
+			mutex_lock l(_mutex);
+			w._next = nullptr;
+			(_parked_tail != nullptr ? _parked_tail->_next : _parked_head) = &w;
+			_parked_tail = &w;
+			_sleepers.fetch_add(1);
+		}
+
+		// after this either every notifier sees _sleepers or ready() sees what it published
+		process_fence();
+		if(!ready())
+		{
+			return true;
+		}
+
+		// a notifier that already took w wakes it anyway
+		return !_unpark(w);
+	}
+
+	template<typename t_predicate>
+	bool spin_waiter::_spin(t_predicate& ready)
+	{
+		for(int i = 0; i < spin_count; ++i)
+		{
+			if(ready())
+			{
+				return true;
+			}
+			cpu_pause();
+		}
+
+		for(int i = 0; i < yield_count; ++i)
+		{
+			if(ready())
+			{
+				return true;
+			}
+			std::this_thread::yield();
+		}
+		return false;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	inline rw_spin_lock::rw_spin_lock()
+		: _state(0)
+	{
+	}
+
+	inline void rw_spin_lock::lock()
+	{
+		int spins = 0;
+		while(_state.fetch_or(writer, std::memory_order_acquire) & writer)
+		{
+			_backoff(spins);
+		}
+		while(_state.load(std::memory_order_acquire) != writer)
+		{
+			_backoff(spins);
+		}
+	}
+
+	inline void rw_spin_lock::unlock()
+	{
+		_state.store(0, std::memory_order_release);
+	}
+
+	inline void rw_spin_lock::lock_shared()
+	{
+		int spins = 0;
+		unsigned s = _state.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			if((s & writer) == 0 && _state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return;
+			}
+			_backoff(spins);
+			s = _state.load(std::memory_order_relaxed);
+		}
+	}
+
+	inline void rw_spin_lock::unlock_shared()
+	{
+		_state.fetch_sub(1, std::memory_order_release);
+	}
+
+	inline void rw_spin_lock::_backoff(int& spins)
+	{
+		if(++spins < 64)
+		{
+			cpu_pause();
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	inline shared_spin_lock::shared_spin_lock(rw_spin_lock& l)
+		: _lock(l)
+	{
+		_lock.lock_shared();
+	}
+
+	inline shared_spin_lock::~shared_spin_lock()
+	{
+		_lock.unlock_shared();
+	}
 } // namespace bl
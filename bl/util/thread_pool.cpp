@@ -0,0 +1,198 @@
+#include <bl/util/thread_pool.h>
+#include <bl/util/topology.h>
+
+namespace bl
+{
+	thread_local thread_pool::worker* thread_pool::_current = nullptr;
+
+	thread_pool::task::~task()
+	{
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	thread_pool::thread_pool(unsigned threads)
+		: _injected_count(0), _queued(0), _quit(false)
+	{
+		if(threads == 0)
+		{
+			threads = std::max(1u, thread::hardware_concurrency());
+		}
+
+		// every deque exists before the first worker starts stealing
+		for(unsigned i = 0; i < threads; ++i)
+		{
+			_workers.emplace_back(new worker());
+			_workers.back()->pool = this;
+			_workers.back()->rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+		}
+		for(unsigned i = 0; i < threads; ++i)
+		{
+			worker* w = _workers[i].get();
+			w->handle = thread([this, w]()
+			{
+				_run(w);
+			});
+		}
+	}
+
+	thread_pool::~thread_pool()
+	{
+		_quit.store(true, std::memory_order_release);
+		_waiter.notify_all();
+		for(unique_ptr<worker>& w : _workers)
+		{
+			w->handle.join();
+		}
+	}
+
+	thread_pool& thread_pool::global()
+	{
+		static thread_pool pool;
+		return pool;
+	}
+
+	unsigned thread_pool::size() const
+	{
+		return static_cast<unsigned>(_workers.size());
+	}
+
+	bool thread_pool::in_worker() const
+	{
+		return _current != nullptr && _current->pool == this;
+	}
+
+	bool thread_pool::pin_workers()
+	{
+		const std::vector<unsigned> order = topology::system().spread_order();
+		bool pinned = !order.empty();
+		for(size_t i = 0; i < _workers.size() && pinned; ++i)
+		{
+			pinned = pin_thread(_workers[i]->handle, std::vector<unsigned>(1, order[i % order.size()]));
+		}
+		return pinned;
+	}
+
+	bool thread_pool::pin_workers_to_node(unsigned node)
+	{
+		bool pinned = true;
+		for(unique_ptr<worker>& w : _workers)
+		{
+			pinned = pin_thread_to_node(w->handle, node) && pinned;
+		}
+		return pinned;
+	}
+
+	void thread_pool::push(task& t)
+	{
+		// count first, a thief may take the task before push returns
+		_queued.fetch_add(1, std::memory_order_acq_rel);
+
+		if(in_worker())
+		{
+			_current->deque.push(&t);
+		}
+		else
+		{
+			mutex_lock l(_injected_mutex);
+			_injected.push_back(&t);
+			_injected_count.fetch_add(1, std::memory_order_release);
+		}
+		_waiter.notify_one();
+	}
+
+	size_t thread_pool::_auto_grain(size_t count) const
+	{
+		// a few pieces per thread leaves room to balance uneven work
+		return std::max<size_t>(1, count / (8 * (_workers.size() + 1)));
+	}
+
+	thread_pool::task* thread_pool::_take(worker* self)
+	{
+		task* t = nullptr;
+		if(self != nullptr)
+		{
+			t = self->deque.take();
+		}
+
+		if(t == nullptr && _injected_count.load(std::memory_order_acquire) > 0)
+		{
+			mutex_lock l(_injected_mutex);
+			if(!_injected.empty())
+			{
+				t = _injected.front();
+				_injected.pop_front();
+				_injected_count.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+		if(t == nullptr)
+		{
+			t = _steal(self);
+		}
+
+		if(t != nullptr)
+		{
+			_queued.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return t;
+	}
+
+	thread_pool::task* thread_pool::_steal(worker* self)
+	{
+		// xorshift pick of the first victim, then every other worker once
+		uint64 r;
+		if(self != nullptr)
+		{
+			r = self->rng;
+			r ^= r << 13;
+			r ^= r >> 7;
+			r ^= r << 17;
+			self->rng = r;
+		}
+		else
+		{
+			r = this_thread_index();
+		}
+
+		const size_t n = _workers.size();
+		const size_t start = static_cast<size_t>(r % n);
+		for(size_t i = 0; i < n; ++i)
+		{
+			worker* victim = _workers[(start + i) % n].get();
+			if(victim == self)
+			{
+				continue;
+			}
+			if(task* t = victim->deque.steal())
+			{
+				return t;
+			}
+		}
+		return nullptr;
+	}
+
+	void thread_pool::_run(worker* self)
+	{
+		_current = self;
+		for(;;)
+		{
+			if(task* t = _take(self))
+			{
+				t->run();
+				continue;
+			}
+
+			if(_quit.load(std::memory_order_acquire) && _queued.load(std::memory_order_acquire) <= 0)
+			{
+				break;
+			}
+
+			_waiter.wait([this]()
+			{
+				return _queued.load(std::memory_order_acquire) > 0 || _quit.load(std::memory_order_acquire);
+			});
+		}
+		_current = nullptr;
+	}
+} // namespace bl
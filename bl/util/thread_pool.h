@@ -0,0 +1,603 @@
+#pragma once
+#include <bl/util/atomic.h>
+#include <bl/util/integer.h>
+#include <bl/util/memory.h>
+#include <bl/util/platform.h>
+#include <bl/util/thread.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bl
+{
+	using std::future;
+
+	class thread_pool;
+
+	// std::future of a task queued on a thread_pool. waiting on a worker of that pool executes queued tasks meanwhile,
+	// so a task can wait for the tasks it spawned without blocking the worker they may be queued on
+	template<typename t_value>
+	class pool_future
+	{
+	public:
+		pool_future();
+		pool_future(thread_pool& pool, future<t_value>&& f);
+
+		bool valid() const;
+		void wait() const;
+		auto get() -> decltype(std::declval<future<t_value>&>().get());
+
+		template<typename t_rep, typename t_period>
+		std::future_status wait_for(const std::chrono::duration<t_rep, t_period>& timeout) const;
+
+		std::shared_future<t_value> share();
+
+	private:
+		thread_pool* _pool;
+		future<t_value> _future;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// chase-lev work stealing deque of pointers: the owner thread pushes and takes at the bottom (lifo),
+	// any other thread steals from the top (fifo). the array grows on demand, retired arrays are kept until destruction
+	// because a thief may still be reading them
+	// ref: https://fzn.fr/readings/ppopp13.pdf
+	template<typename t_value>
+	class work_stealing_deque
+	{
+	public:
+		explicit work_stealing_deque(size_t capacity = 256);
+
+		work_stealing_deque(const work_stealing_deque&) = delete;
+		work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+		// owner side
+		void push(t_value* value);
+		t_value* take();
+
+		// any thread, returns nullptr when empty or when it lost a race with another thread
+		t_value* steal();
+
+		// approximate when called concurrently
+		bool empty() const;
+
+	private:
+		struct ring
+		{
+			explicit ring(size_t capacity);
+
+			t_value* get(int64 i) const;
+			void put(int64 i, t_value* value);
+
+			size_t mask;
+			unique_ptr<atomic<t_value*>[]> items;
+		};
+
+		ring* _grow(ring* r, int64 top, int64 bottom);
+
+		atomic<int64> _top;
+		char _pad[BL_CACHE_LINE_SIZE]; // keeps thieves off the owner's cache line
+		atomic<int64> _bottom;
+		atomic<ring*> _ring;
+		std::vector<unique_ptr<ring>> _rings; // owner only
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// fixed set of worker threads, each with its own work stealing deque. tasks pushed by a worker go to its own deque,
+	// tasks from other threads go to a shared queue. idle workers steal from random victims and sleep after a short spin.
+	// threads waiting for a parallel algorithm execute pending tasks instead of blocking, so parallel calls can nest
+	class thread_pool
+	{
+	public:
+		// unit of work, not owned by the pool: it must stay alive until run() returns
+		class task
+		{
+		public:
+			virtual ~task();
+			virtual void run() = 0;
+		};
+
+		// threads = 0 uses every hardware thread
+		explicit thread_pool(unsigned threads = 0);
+
+		// finishes every queued task, then joins the workers
+		~thread_pool();
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		// pool shared by bl::async and the free parallel algorithms
+		static thread_pool& global();
+
+		unsigned size() const;
+
+		// true on a worker thread of this pool
+		bool in_worker() const;
+
+		// pins worker i to topology::spread_order()[i], so workers share as few cores and caches as possible
+		bool pin_workers();
+
+		// keeps every worker on the cpus of one numa node, pages they touch first are then allocated on that node
+		bool pin_workers_to_node(unsigned node);
+
+		void push(task& t);
+
+		// fire and forget, an exception escaping t_function terminates the program
+		template<typename t_function>
+		void submit(t_function function);
+
+		template<typename t_function, typename ...t_args>
+		pool_future<typename std::result_of<typename std::decay<t_function>::type(typename std::decay<t_args>::type...)>::type>
+		async(t_function&& function, t_args&& ...args);
+
+		// executes queued tasks on the calling thread until done() returns true
+		template<typename t_predicate>
+		void wait_until(t_predicate done);
+
+		// calls function(first, last) on disjoint subranges of at most grain indices covering [begin, end).
+		// grain = 0 picks one from the pool size. the first exception thrown is rethrown after every subrange finished
+		template<typename t_function>
+		void parallel_for(size_t begin, size_t end, size_t grain, t_function function);
+
+		// reduce(...reduce(reduce(identity, map(r0)), map(r1))..., map(rn)) over the subranges of [begin, end) in order,
+		// so for a fixed grain the result does not depend on the scheduling
+		template<typename t_value, typename t_map, typename t_reduce>
+		t_value parallel_reduce(size_t begin, size_t end, size_t grain, t_value identity, t_map map, t_reduce reduce);
+
+		template<typename ...t_functions>
+		void parallel_invoke(t_functions&& ...functions);
+
+	private:
+		struct worker
+		{
+			work_stealing_deque<task> deque;
+			thread_pool* pool;
+			thread handle;
+			uint64 rng;
+		};
+
+		template<typename t_function>
+		class function_task : public task
+		{
+		public:
+			explicit function_task(t_function&& function);
+			void run() override;
+
+		private:
+			t_function _function;
+		};
+
+		template<typename t_function>
+		struct for_state
+		{
+			for_state(thread_pool& p, t_function& f, size_t g);
+
+			thread_pool& pool;
+			t_function& function;
+			size_t grain;
+			atomic<size_t> done;
+			atomic<bool> failed;
+			std::exception_ptr error;
+		};
+
+		template<typename t_function>
+		class for_task : public task
+		{
+		public:
+			for_task(for_state<t_function>& state, size_t begin, size_t end);
+			void run() override;
+
+		private:
+			for_state<t_function>& _state;
+			size_t _begin;
+			size_t _end;
+		};
+
+		template<typename t_function>
+		static void _for_range(for_state<t_function>& state, size_t begin, size_t end);
+
+		size_t _auto_grain(size_t count) const;
+		task* _take(worker* self);
+		task* _steal(worker* self);
+		void _run(worker* self);
+
+		static thread_local worker* _current;
+
+		std::vector<unique_ptr<worker>> _workers;
+		mutex _injected_mutex;
+		std::deque<task*> _injected;
+		atomic<size_t> _injected_count;
+		atomic<int64> _queued; // tasks pushed and not taken yet, briefly ahead of the queues
+		atomic<bool> _quit;
+		spin_waiter _waiter;
+	};
+
+	// on the global pool
+	template<typename t_function>
+	void parallel_for(size_t begin, size_t end, size_t grain, t_function function);
+
+	template<typename t_value, typename t_map, typename t_reduce>
+	t_value parallel_reduce(size_t begin, size_t end, size_t grain, t_value identity, t_map map, t_reduce reduce);
+
+	template<typename ...t_functions>
+	void parallel_invoke(t_functions&& ...functions);
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	work_stealing_deque<t_value>::ring::ring(size_t capacity)
+		: mask(capacity - 1), items(new atomic<t_value*>[capacity])
+	{
+	}
+
+	template<typename t_value>
+	t_value* work_stealing_deque<t_value>::ring::get(int64 i) const
+	{
+		return items[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed);
+	}
+
+	template<typename t_value>
+	void work_stealing_deque<t_value>::ring::put(int64 i, t_value* value)
+	{
+		items[static_cast<size_t>(i) & mask].store(value, std::memory_order_relaxed);
+	}
+
+	template<typename t_value>
+	work_stealing_deque<t_value>::work_stealing_deque(size_t capacity)
+		: _top(0), _bottom(0), _ring(nullptr)
+	{
+		size_t c = 2;
+		while(c < capacity)
+		{
+			c <<= 1;
+		}
+		_rings.emplace_back(new ring(c));
+		_ring.store(_rings.back().get(), std::memory_order_relaxed);
+	}
+
+	template<typename t_value>
+	void work_stealing_deque<t_value>::push(t_value* value)
+	{
+		const int64 b = _bottom.load(std::memory_order_relaxed);
+		const int64 t = _top.load(std::memory_order_acquire);
+		ring* r = _ring.load(std::memory_order_relaxed);
+		if(static_cast<size_t>(b - t) > r->mask)
+		{
+			r = _grow(r, t, b);
+		}
+		r->put(b, value);
+		std::atomic_thread_fence(std::memory_order_release);
+		_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	template<typename t_value>
+	t_value* work_stealing_deque<t_value>::take()
+	{
+		const int64 b = _bottom.load(std::memory_order_relaxed) - 1;
+		ring* r = _ring.load(std::memory_order_relaxed);
+		_bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64 t = _top.load(std::memory_order_relaxed);
+		if(t > b)
+		{
+			_bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		t_value* value = r->get(b);
+		if(t == b)
+		{
+			// last item, race the thieves for it
+			if(!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				value = nullptr;
+			}
+			_bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return value;
+	}
+
+	template<typename t_value>
+	t_value* work_stealing_deque<t_value>::steal()
+	{
+		int64 t = _top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64 b = _bottom.load(std::memory_order_acquire);
+		if(t >= b)
+		{
+			return nullptr;
+		}
+
+		t_value* value = _ring.load(std::memory_order_acquire)->get(t);
+		if(!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return value;
+	}
+
+	template<typename t_value>
+	bool work_stealing_deque<t_value>::empty() const
+	{
+		return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+	}
+
+	template<typename t_value>
+	typename work_stealing_deque<t_value>::ring* work_stealing_deque<t_value>::_grow(ring* r, int64 top, int64 bottom)
+	{
+		_rings.emplace_back(new ring((r->mask + 1) * 2));
+		ring* bigger = _rings.back().get();
+		for(int64 i = top; i < bottom; ++i)
+		{
+			bigger->put(i, r->get(i));
+		}
+		_ring.store(bigger, std::memory_order_release);
+		return bigger;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_function>
+	thread_pool::function_task<t_function>::function_task(t_function&& function)
+		: _function(std::move(function))
+	{
+	}
+
+	template<typename t_function>
+	void thread_pool::function_task<t_function>::run()
+	{
+		_function();
+		delete this;
+	}
+
+	template<typename t_function>
+	void thread_pool::submit(t_function function)
+	{
+		push(*new function_task<t_function>(std::move(function)));
+	}
+
+	template<typename t_function, typename ...t_args>
+	pool_future<typename std::result_of<typename std::decay<t_function>::type(typename std::decay<t_args>::type...)>::type>
+	thread_pool::async(t_function&& function, t_args&& ...args)
+	{
+		typedef typename std::result_of<typename std::decay<t_function>::type(typename std::decay<t_args>::type...)>::type result_type;
+
+		std::packaged_task<result_type()> job(std::bind(std::forward<t_function>(function), std::forward<t_args>(args)...));
+		future<result_type> result = job.get_future();
+		submit(std::move(job));
+		return pool_future<result_type>(*this, std::move(result));
+	}
+
+	template<typename t_predicate>
+	void thread_pool::wait_until(t_predicate done)
+	{
+		worker* self = in_worker() ? _current : nullptr;
+		int idle = 0;
+		while(!done())
+		{
+			if(task* t = _take(self))
+			{
+				t->run();
+				idle = 0;
+			}
+			else if(++idle < 64)
+			{
+				cpu_pause();
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	template<typename t_function>
+	thread_pool::for_state<t_function>::for_state(thread_pool& p, t_function& f, size_t g)
+		: pool(p), function(f), grain(g), done(0), failed(false)
+	{
+	}
+
+	template<typename t_function>
+	thread_pool::for_task<t_function>::for_task(for_state<t_function>& state, size_t begin, size_t end)
+		: _state(state), _begin(begin), _end(end)
+	{
+	}
+
+	template<typename t_function>
+	void thread_pool::for_task<t_function>::run()
+	{
+		for_state<t_function>& state = _state;
+		const size_t begin = _begin;
+		const size_t end = _end;
+		delete this;
+		_for_range(state, begin, end);
+	}
+
+	template<typename t_function>
+	void thread_pool::_for_range(for_state<t_function>& state, size_t begin, size_t end)
+	{
+		// split in halves and hand the upper ones out, so thieves take the largest pieces
+		while(end - begin > state.grain)
+		{
+			const size_t middle = begin + (end - begin) / 2;
+			state.pool.push(*new for_task<t_function>(state, middle, end));
+			end = middle;
+		}
+
+		if(!state.failed.load(std::memory_order_relaxed))
+		{
+			try
+			{
+				state.function(begin, end);
+			}
+			catch(...)
+			{
+				if(!state.failed.exchange(true))
+				{
+					state.error = std::current_exception();
+				}
+			}
+		}
+
+		// last access to state, the waiting caller may return right after
+		state.done.fetch_add(end - begin, std::memory_order_acq_rel);
+	}
+
+	template<typename t_function>
+	void thread_pool::parallel_for(size_t begin, size_t end, size_t grain, t_function function)
+	{
+		if(begin >= end)
+		{
+			return;
+		}
+
+		const size_t count = end - begin;
+		for_state<t_function> state(*this, function, grain > 0 ? grain : _auto_grain(count));
+		_for_range(state, begin, end);
+		wait_until([&state, count]()
+		{
+			return state.done.load(std::memory_order_acquire) == count;
+		});
+
+		if(state.error)
+		{
+			std::rethrow_exception(state.error);
+		}
+	}
+
+	template<typename t_value, typename t_map, typename t_reduce>
+	t_value thread_pool::parallel_reduce(size_t begin, size_t end, size_t grain, t_value identity, t_map map, t_reduce reduce)
+	{
+		if(begin >= end)
+		{
+			return identity;
+		}
+
+		// one partial result per chunk, wrapped so that t_value = bool does not pick vector<bool>
+		struct partial
+		{
+			t_value value;
+		};
+
+		const size_t count = end - begin;
+		if(grain == 0)
+		{
+			grain = _auto_grain(count);
+		}
+		const size_t chunks = (count + grain - 1) / grain;
+		std::vector<partial> partials(chunks, partial{identity});
+
+		parallel_for(0, chunks, 1, [&](size_t first, size_t last)
+		{
+			for(size_t c = first; c < last; ++c)
+			{
+				const size_t b = begin + c * grain;
+				partials[c].value = map(b, b + std::min(grain, end - b));
+			}
+		});
+
+		t_value result = std::move(identity);
+		for(size_t c = 0; c < chunks; ++c)
+		{
+			result = reduce(std::move(result), std::move(partials[c].value));
+		}
+		return result;
+	}
+
+	template<typename ...t_functions>
+	void thread_pool::parallel_invoke(t_functions&& ...functions)
+	{
+		static_assert(sizeof...(t_functions) > 0, "parallel_invoke needs at least one function");
+		std::function<void()> calls[] = {std::function<void()>(std::ref(functions))...};
+		parallel_for(0, sizeof...(t_functions), 1, [&calls](size_t first, size_t last)
+		{
+			for(size_t i = first; i < last; ++i)
+			{
+				calls[i]();
+			}
+		});
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_value>
+	pool_future<t_value>::pool_future()
+		: _pool(nullptr)
+	{
+	}
+
+	template<typename t_value>
+	pool_future<t_value>::pool_future(thread_pool& pool, future<t_value>&& f)
+		: _pool(&pool), _future(std::move(f))
+	{
+	}
+
+	template<typename t_value>
+	bool pool_future<t_value>::valid() const
+	{
+		return _future.valid();
+	}
+
+	template<typename t_value>
+	void pool_future<t_value>::wait() const
+	{
+		if(_pool != nullptr && _pool->in_worker())
+		{
+			const future<t_value>& f = _future;
+			_pool->wait_until([&f]()
+			{
+				return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			});
+		}
+		_future.wait();
+	}
+
+	template<typename t_value>
+	auto pool_future<t_value>::get() -> decltype(std::declval<future<t_value>&>().get())
+	{
+		wait();
+		return _future.get();
+	}
+
+	template<typename t_value>
+	template<typename t_rep, typename t_period>
+	std::future_status pool_future<t_value>::wait_for(const std::chrono::duration<t_rep, t_period>& timeout) const
+	{
+		return _future.wait_for(timeout);
+	}
+
+	template<typename t_value>
+	std::shared_future<t_value> pool_future<t_value>::share()
+	{
+		// a shared_future can be waited on from anywhere, so it no longer runs tasks while waiting
+		return _future.share();
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	template<typename t_function>
+	void parallel_for(size_t begin, size_t end, size_t grain, t_function function)
+	{
+		thread_pool::global().parallel_for(begin, end, grain, std::move(function));
+	}
+
+	template<typename t_value, typename t_map, typename t_reduce>
+	t_value parallel_reduce(size_t begin, size_t end, size_t grain, t_value identity, t_map map, t_reduce reduce)
+	{
+		return thread_pool::global().parallel_reduce(begin, end, grain, std::move(identity), std::move(map), std::move(reduce));
+	}
+
+	template<typename ...t_functions>
+	void parallel_invoke(t_functions&& ...functions)
+	{
+		thread_pool::global().parallel_invoke(std::forward<t_functions>(functions)...);
+	}
+} // namespace bl
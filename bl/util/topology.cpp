@@ -0,0 +1,455 @@
+#include <bl/util/topology.h>
+#include <bl/util/integer.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+
+#if defined(BL_OS_WIN)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(BL_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#error "Unsupported operating system."
+#endif
+
+namespace bl
+{
+	static bool s_read_line(const std::string& path, std::string& line)
+	{
+		std::ifstream in(path.c_str());
+		return in && std::getline(in, line);
+	}
+
+	// "0-3,8,10-11"
+	static std::vector<unsigned> s_parse_list(const std::string& text)
+	{
+		std::vector<unsigned> values;
+		const char* p = text.c_str();
+		while(*p != '\0')
+		{
+			char* end = nullptr;
+			const unsigned long first = std::strtoul(p, &end, 10);
+			if(end == p)
+			{
+				break;
+			}
+			unsigned long last = first;
+			p = end;
+			if(*p == '-')
+			{
+				last = std::strtoul(p + 1, &end, 10);
+				p = end;
+			}
+			for(unsigned long v = first; v <= last; ++v)
+			{
+				values.push_back(static_cast<unsigned>(v));
+			}
+			if(*p == ',')
+			{
+				++p;
+			}
+		}
+		return values;
+	}
+
+	// "48K", "2048K", "1M"
+	static size_t s_parse_size(const std::string& text)
+	{
+		char* end = nullptr;
+		size_t size = std::strtoull(text.c_str(), &end, 10);
+		if(*end == 'K')
+		{
+			size <<= 10;
+		}
+		else if(*end == 'M')
+		{
+			size <<= 20;
+		}
+		else if(*end == 'G')
+		{
+			size <<= 30;
+		}
+		return size;
+	}
+
+	static unsigned s_read_unsigned(const std::string& path, unsigned fallback)
+	{
+		std::string line;
+		return s_read_line(path, line) ? static_cast<unsigned>(std::strtoul(line.c_str(), nullptr, 10)) : fallback;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	topology::topology()
+		: _cores(0), _packages(0)
+	{
+	#if defined(BL_OS_LINUX)
+		_read_linux();
+	#endif
+		if(_cpus.empty())
+		{
+			_flat();
+		}
+	}
+
+	const topology& topology::system()
+	{
+		static const topology t;
+		return t;
+	}
+
+	void topology::_read_linux()
+	{
+		const std::string root = "/sys/devices/system/";
+		std::string line;
+		if(!s_read_line(root + "cpu/online", line))
+		{
+			return;
+		}
+		const std::vector<unsigned> online = s_parse_list(line);
+
+		std::map<std::pair<unsigned, unsigned>, unsigned> cores; // (package id, core id) -> dense core
+		std::map<unsigned, unsigned> packages;                 // package id -> dense package
+		for(unsigned id : online)
+		{
+			const std::string dir = root + "cpu/cpu" + std::to_string(id) + "/";
+			const unsigned package_id = s_read_unsigned(dir + "topology/physical_package_id", 0);
+			const unsigned core_id = s_read_unsigned(dir + "topology/core_id", id);
+
+			cpu_info c;
+			c.id = id;
+			c.package = packages.insert(std::make_pair(package_id, static_cast<unsigned>(packages.size()))).first->second;
+			c.core = cores.insert(std::make_pair(std::make_pair(package_id, core_id), static_cast<unsigned>(cores.size()))).first->second;
+			c.node = 0;
+			c.smt_index = 0;
+			if(s_read_line(dir + "topology/thread_siblings_list", line))
+			{
+				const std::vector<unsigned> siblings = s_parse_list(line);
+				c.smt_index = static_cast<unsigned>(std::find(siblings.begin(), siblings.end(), id) - siblings.begin());
+			}
+			_cpus.push_back(c);
+
+			// caches are listed by every cpu sharing them, keep the first listing
+			for(unsigned index = 0; s_read_line(dir + "cache/index" + std::to_string(index) + "/shared_cpu_list", line); ++index)
+			{
+				const std::string cache_dir = dir + "cache/index" + std::to_string(index) + "/";
+				cache_info k;
+				k.cpus = s_parse_list(line);
+				k.level = s_read_unsigned(cache_dir + "level", 0);
+				k.line_size = s_read_unsigned(cache_dir + "coherency_line_size", BL_CACHE_LINE_SIZE);
+				k.size = s_read_line(cache_dir + "size", line) ? s_parse_size(line) : 0;
+				k.type = cache_type::unified;
+				if(s_read_line(cache_dir + "type", line))
+				{
+					k.type = line == "Data" ? cache_type::data : line == "Instruction" ? cache_type::instruction : cache_type::unified;
+				}
+
+				const bool known = std::any_of(_caches.begin(), _caches.end(), [&k](const cache_info& other)
+				{
+					return other.level == k.level && other.type == k.type && other.cpus == k.cpus;
+				});
+				if(!known)
+				{
+					_caches.push_back(std::move(k));
+				}
+			}
+		}
+		_cores = cores.size();
+		_packages = packages.size();
+
+		if(s_read_line(root + "node/online", line))
+		{
+			for(unsigned id : s_parse_list(line))
+			{
+				std::string cpulist;
+				if(s_read_line(root + "node/node" + std::to_string(id) + "/cpulist", cpulist))
+				{
+					node_info n;
+					n.id = id;
+					n.cpus = s_parse_list(cpulist);
+					_nodes.push_back(std::move(n));
+				}
+			}
+		}
+		if(_nodes.empty())
+		{
+			node_info n;
+			n.id = 0;
+			n.cpus = online;
+			_nodes.push_back(std::move(n));
+		}
+
+		for(size_t i = 0; i < _nodes.size(); ++i)
+		{
+			for(unsigned id : _nodes[i].cpus)
+			{
+				for(cpu_info& c : _cpus)
+				{
+					if(c.id == id)
+					{
+						c.node = static_cast<unsigned>(i);
+					}
+				}
+			}
+		}
+	}
+
+	void topology::_flat()
+	{
+		const unsigned count = std::max(1u, thread::hardware_concurrency());
+		node_info n;
+		n.id = 0;
+		for(unsigned i = 0; i < count; ++i)
+		{
+			cpu_info c;
+			c.id = i;
+			c.core = i;
+			c.package = 0;
+			c.node = 0;
+			c.smt_index = 0;
+			_cpus.push_back(c);
+			n.cpus.push_back(i);
+		}
+		_nodes.assign(1, n);
+		_cores = count;
+		_packages = 1;
+	}
+
+	const std::vector<topology::cpu_info>& topology::cpus() const
+	{
+		return _cpus;
+	}
+
+	const std::vector<topology::node_info>& topology::nodes() const
+	{
+		return _nodes;
+	}
+
+	const std::vector<topology::cache_info>& topology::caches() const
+	{
+		return _caches;
+	}
+
+	size_t topology::core_count() const
+	{
+		return _cores;
+	}
+
+	size_t topology::package_count() const
+	{
+		return _packages;
+	}
+
+	std::vector<unsigned> topology::core_cpus(unsigned core) const
+	{
+		std::vector<std::pair<unsigned, unsigned>> siblings;
+		for(const cpu_info& c : _cpus)
+		{
+			if(c.core == core)
+			{
+				siblings.push_back(std::make_pair(c.smt_index, c.id));
+			}
+		}
+		std::sort(siblings.begin(), siblings.end());
+
+		std::vector<unsigned> ids;
+		for(const std::pair<unsigned, unsigned>& s : siblings)
+		{
+			ids.push_back(s.second);
+		}
+		return ids;
+	}
+
+	std::vector<unsigned> topology::node_cpus(unsigned node) const
+	{
+		return node < _nodes.size() ? _nodes[node].cpus : std::vector<unsigned>();
+	}
+
+	const topology::cpu_info* topology::find_cpu(unsigned id) const
+	{
+		for(const cpu_info& c : _cpus)
+		{
+			if(c.id == id)
+			{
+				return &c;
+			}
+		}
+		return nullptr;
+	}
+
+	std::vector<unsigned> topology::spread_order() const
+	{
+		unsigned smt_levels = 0;
+		for(const cpu_info& c : _cpus)
+		{
+			smt_levels = std::max(smt_levels, c.smt_index + 1);
+		}
+
+		std::vector<unsigned> order;
+		for(unsigned level = 0; level < smt_levels; ++level)
+		{
+			// cpus of this smt level per node, by core
+			std::vector<std::vector<std::pair<unsigned, unsigned>>> per_node(_nodes.size());
+			for(const cpu_info& c : _cpus)
+			{
+				if(c.smt_index == level)
+				{
+					per_node[c.node].push_back(std::make_pair(c.core, c.id));
+				}
+			}
+
+			size_t longest = 0;
+			for(std::vector<std::pair<unsigned, unsigned>>& cpus : per_node)
+			{
+				std::sort(cpus.begin(), cpus.end());
+				longest = std::max(longest, cpus.size());
+			}
+			for(size_t i = 0; i < longest; ++i)
+			{
+				for(const std::vector<std::pair<unsigned, unsigned>>& cpus : per_node)
+				{
+					if(i < cpus.size())
+					{
+						order.push_back(cpus[i].second);
+					}
+				}
+			}
+		}
+		return order;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(BL_OS_LINUX)
+	static bool s_cpu_set(const std::vector<unsigned>& cpus, cpu_set_t& set)
+	{
+		CPU_ZERO(&set);
+		for(unsigned id : cpus)
+		{
+			if(id < CPU_SETSIZE)
+			{
+				CPU_SET(id, &set);
+			}
+		}
+		return CPU_COUNT(&set) > 0;
+	}
+#elif defined(BL_OS_WIN)
+	static DWORD_PTR s_cpu_mask(const std::vector<unsigned>& cpus)
+	{
+		DWORD_PTR mask = 0;
+		for(unsigned id : cpus)
+		{
+			if(id < sizeof(DWORD_PTR) * 8)
+			{
+				mask |= static_cast<DWORD_PTR>(1) << id;
+			}
+		}
+		return mask;
+	}
+#endif
+
+	bool pin_this_thread(const std::vector<unsigned>& cpus)
+	{
+	#if defined(BL_OS_LINUX)
+		cpu_set_t set;
+		return s_cpu_set(cpus, set) && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	#elif defined(BL_OS_WIN)
+		const DWORD_PTR mask = s_cpu_mask(cpus);
+		return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+	#else
+	#error "Unsupported operating system."
+	#endif
+	}
+
+	bool pin_thread(thread& t, const std::vector<unsigned>& cpus)
+	{
+	#if defined(BL_OS_LINUX)
+		cpu_set_t set;
+		return t.joinable() && s_cpu_set(cpus, set) && pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+	#elif defined(BL_OS_WIN)
+		const DWORD_PTR mask = s_cpu_mask(cpus);
+		return t.joinable() && mask != 0 && SetThreadAffinityMask(static_cast<HANDLE>(t.native_handle()), mask) != 0;
+	#else
+	#error "Unsupported operating system."
+	#endif
+	}
+
+	bool pin_this_thread_to_node(unsigned node)
+	{
+		return pin_this_thread(topology::system().node_cpus(node));
+	}
+
+	bool pin_thread_to_node(thread& t, unsigned node)
+	{
+		return pin_thread(t, topology::system().node_cpus(node));
+	}
+
+	unsigned current_cpu()
+	{
+	#if defined(BL_OS_LINUX)
+		const int cpu = sched_getcpu();
+		return cpu < 0 ? 0 : static_cast<unsigned>(cpu);
+	#elif defined(BL_OS_WIN)
+		return static_cast<unsigned>(GetCurrentProcessorNumber());
+	#else
+	#error "Unsupported operating system."
+	#endif
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	void* node_malloc(size_t size, unsigned node)
+	{
+		if(size == 0)
+		{
+			return nullptr;
+		}
+	#if defined(BL_OS_LINUX)
+		void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(ptr == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		// bind before the pages are touched, mbind fails harmlessly without numa support (plain pages then)
+		const std::vector<topology::node_info>& nodes = topology::system().nodes();
+		if(nodes.size() > 1 && node < nodes.size() && nodes[node].id < 1024)
+		{
+			const int mpol_bind = 2; // numaif.h
+			uint64 mask[1024 / 64] = {};
+			mask[nodes[node].id / 64] |= uint64(1) << (nodes[node].id % 64);
+			syscall(SYS_mbind, ptr, size, mpol_bind, mask, 1024 + 1, 0);
+		}
+		return ptr;
+	#elif defined(BL_OS_WIN)
+		(void)node;
+		return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	#else
+	#error "Unsupported operating system."
+	#endif
+	}
+
+	void node_free(void* ptr, size_t size)
+	{
+		if(ptr == nullptr)
+		{
+			return;
+		}
+	#if defined(BL_OS_LINUX)
+		munmap(ptr, size);
+	#elif defined(BL_OS_WIN)
+		(void)size;
+		VirtualFree(ptr, 0, MEM_RELEASE);
+	#else
+	#error "Unsupported operating system."
+	#endif
+	}
+} // namespace bl
@@ -0,0 +1,95 @@
+#pragma once
+#include <bl/util/platform.h>
+#include <bl/util/thread.h>
+#include <cstddef>
+#include <vector>
+
+namespace bl
+{
+	// processor layout of the machine: logical cpus, physical cores (smt siblings), packages, numa nodes and caches.
+	// on linux it is read once from /sys/devices/system, elsewhere it is one node and one core per hardware thread
+	class topology
+	{
+	public:
+		enum class cache_type
+		{
+			data,
+			instruction,
+			unified
+		};
+
+		struct cpu_info
+		{
+			unsigned id;        // os cpu number
+			unsigned core;      // dense physical core index
+			unsigned package;   // dense socket index
+			unsigned node;      // dense numa node index
+			unsigned smt_index; // position among the smt siblings of its core
+		};
+
+		struct cache_info
+		{
+			unsigned level;
+			cache_type type;
+			size_t size;
+			size_t line_size;
+			std::vector<unsigned> cpus; // cpus sharing this cache
+		};
+
+		struct node_info
+		{
+			unsigned id; // os node number
+			std::vector<unsigned> cpus;
+		};
+
+		static const topology& system();
+
+		const std::vector<cpu_info>& cpus() const;
+		const std::vector<node_info>& nodes() const;
+		const std::vector<cache_info>& caches() const;
+		size_t core_count() const;
+		size_t package_count() const;
+
+		// logical cpus of a physical core, first smt thread first
+		std::vector<unsigned> core_cpus(unsigned core) const;
+		std::vector<unsigned> node_cpus(unsigned node) const;
+		const cpu_info* find_cpu(unsigned id) const;
+
+		// every cpu, one per physical core round robin over the nodes first, then the remaining smt threads.
+		// the first n entries are the cpus for n threads that should share as little as possible
+		std::vector<unsigned> spread_order() const;
+
+	private:
+		topology();
+
+		void _read_linux();
+		void _flat();
+
+		std::vector<cpu_info> _cpus;
+		std::vector<node_info> _nodes;
+		std::vector<cache_info> _caches;
+		size_t _cores;
+		size_t _packages;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// affinity, all return false when the os refused or does not support it
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	bool pin_this_thread(const std::vector<unsigned>& cpus);
+	bool pin_thread(thread& t, const std::vector<unsigned>& cpus);
+	bool pin_this_thread_to_node(unsigned node);
+	bool pin_thread_to_node(thread& t, unsigned node);
+
+	// cpu the calling thread runs on, 0 when unknown
+	unsigned current_cpu();
+
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+	// node local memory
+	// ---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+	// page aligned memory whose pages are placed on the given numa node (dense index of topology::nodes()).
+	// without numa support it is plain memory, returns nullptr on failure. free with node_free and the same size
+	void* node_malloc(size_t size, unsigned node);
+	void node_free(void* ptr, size_t size);
+} // namespace bl
@@ -5,21 +5,41 @@
 #include <bl/sort/quick.h>
 #include <bl/sort/heap.h>
 
+#include <bl/util/bench.h>
+#include <bl/util/dataset.h>
 #include <bl/util/in_out.h>
+#include <bl/util/object_pool.h>
 #include <bl/util/random.h>
+#include <bl/util/thread.h>
 #include <bl/util/timer.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
 
 // global configuration
 static int g_seed = 13;
 static int g_numIter = 10;
 static int g_maxArraySize = 1e9;
 static int g_testSize = 1e4;
-static int* g_arrayInt = new int[g_maxArraySize];
-static unsigned int* g_arrayUInt = new unsigned int[g_maxArraySize];
-static float* g_arrayFloat = new float[g_maxArraySize];
-static double* g_arrayDouble = new double[g_maxArraySize];
+
+// sweep configuration, see parseArgs
+static bl::uint64 g_minSize = 1e2;
+static bl::uint64 g_maxSize = 1e6;
+static bl::uint64 g_maxQuadraticSize = 1e4; // bubble, cocktail and insertion sorts stop here
+static std::string g_filter;
+static std::string g_jsonPath;
+static std::string g_csvPath;
+static std::string g_baselinePath;
+static std::string g_saveBaselinePath;
+static double g_threshold = 0.05; // relative slowdown reported as a regression
+static double g_alpha = 0.05;     // significance level of the comparison
 
 // helper
 template<typename t_value, typename t_size>
@@ -35,240 +55,328 @@ bool checkOrdered(t_value* a, t_size size)
 	return true;
 }
 
-// case 1: random
-template<typename t_value, typename t_size, typename sort_t>
-double testRandom(t_value* a, t_size size, sort_t sortFunc)
+template<typename t_value>
+struct sortCase
 {
-	auto rand = bl::make_random<t_value>(0, size, g_seed);
-	for(t_size i = 0; i < size; ++i)
-	{
-		a[i] = rand();
-	}
-	bl::timer t;
-	sortFunc(a, size);
-	double e = t.milliseconds();
-	return e;
-}
+	const char* name;
+	bool quadratic;
+	void (*sort)(t_value*, int);
+};
 
-// case 2: ordered
-template<typename t_value, typename t_size, typename sort_t>
-double testOrdered(t_value* a, t_size size, sort_t sortFunc)
+// every input case x size x sort on one value type, named input/type/sort
+template<typename t_value>
+void runSorts(bl::bench& bench, bl::dataset& data, const char* typeName)
 {
-	for(t_size i = 0; i < size; ++i)
+	const sortCase<t_value> sorts[] =
 	{
-		a[i] = (t_value)i;
+		{"std", false, [](t_value* a2, int s2){std::sort(a2, a2 + s2);}},
+		{"bubble", true, [](t_value* a2, int s2){bl::bubble_sort(a2, s2);}},
+		{"cocktail", true, [](t_value* a2, int s2){bl::cocktail_sort(a2, s2);}},
+		{"insertion", true, [](t_value* a2, int s2){bl::insertion_sort(a2, s2);}},
+		{"insertion binary", true, [](t_value* a2, int s2){bl::insertion_sort_binary(a2, s2);}},
+		{"insertion binary move", true, [](t_value* a2, int s2){bl::insertion_sort_binary_move(a2, s2);}},
+		{"shell", false, [](t_value* a2, int s2){bl::shell_sort(a2, s2);}},
+		{"quick", false, [](t_value* a2, int s2){bl::quick_sort(a2, 0, s2-1);}},
+		{"heap", false, [](t_value* a2, int s2){bl::heap_sort(a2, s2);}}
+	};
+
+	std::vector<t_value> scratch;
+	for(size_t d = 0; d < bl::dataset::distribution_count; ++d)
+	{
+		const bl::distribution input = static_cast<bl::distribution>(d);
+		for(bl::uint64 size : bl::bench::geometric_sizes(g_minSize, g_maxSize))
+		{
+			bool printed = false;
+			for(const sortCase<t_value>& sort : sorts)
+			{
+				const std::string name = std::string(bl::dataset::name(input)) + "/" + typeName + "/" + sort.name;
+				if((sort.quadratic && size > g_maxQuadraticSize) || (!g_filter.empty() && name.find(g_filter) == std::string::npos))
+				{
+					continue;
+				}
+				if(!printed)
+				{
+					bl::print(); bl::print("-----", bl::dataset::name(input), "-", typeName, "-", size, "elements -----");
+					printed = true;
+				}
+				const int s = static_cast<int>(size);
+				t_value* a = nullptr;
+				bench.run(name, size,
+					[&]{a = data.copy<t_value>(input, size, scratch);},
+					[&]{sort.sort(a, s);},
+					[&]
+					{
+						if(!checkOrdered(a, s))
+						{
+							bl::print(name, "not sorted!");
+							exit(1);
+						}
+					});
+			}
+			// one input resident at a time, the large sizes do not fit together
+			data.clear();
+		}
 	}
-	bl::timer t;
-	sortFunc(a, size);
-	double e = t.milliseconds();
-	return e;
 }
 
-// case 3: reverse ordered
-template<typename t_value, typename t_size, typename sort_t>
-double testReverseOrdered(t_value* a, t_size size, sort_t sortFunc)
+// random number generation: make_random per call against the bulk fills, named rng/type/generator
+template<typename t_value>
+void runRandom(bl::bench& bench, const char* typeName)
 {
-	for(t_size i = 0; i < size; ++i)
+	const bl::uint64 size = 1 << 20;
+	std::vector<t_value> values(size);
+	t_value* a = values.data();
+	bl::xoshiro256ss xoshiro(g_seed);
+	bl::pcg64 pcg(g_seed);
+	bl::xoshiro256ss_x4 xoshiroX4(g_seed);
+	auto makeRandom = bl::make_random<t_value>(t_value(0), t_value(1), t_value(g_seed));
+
+	bl::print(); bl::print("----- random -", typeName, "-", size, "numbers -----");
+	const std::string prefix = std::string("rng/") + typeName + "/";
+	auto run = [&](const char* name, bl::function<void()> fill)
 	{
-		a[i] = (t_value)size-i;
-	}
-	bl::timer t;
-	sortFunc(a, size);
-	double e = t.milliseconds();
-	return e;
+		if(g_filter.empty() || (prefix + name).find(g_filter) != std::string::npos)
+		{
+			bench.run(prefix + name, size, [&]{fill(); bl::do_not_optimize(a[size - 1]);});
+		}
+	};
+	run("make_random", [&]{for(bl::uint64 i = 0; i < size; ++i) {a[i] = makeRandom();}});
+	run("xoshiro256ss", [&]{bl::fill_uniform(xoshiro, a, size, t_value(0), t_value(1));});
+	run("pcg64", [&]{bl::fill_uniform(pcg, a, size, t_value(0), t_value(1));});
+	run("xoshiro256ss_x4", [&]{bl::fill_uniform(xoshiroX4, a, size, t_value(0), t_value(1));});
+	run("xoshiro256ss_x4 parallel", [&]{bl::parallel_fill_uniform(xoshiroX4, a, size, t_value(0), t_value(1));});
+	run("xoshiro256ss_x4 normal", [&]{bl::fill_normal(xoshiroX4, a, size, t_value(0), t_value(1));});
 }
 
-// case 4: random nearby disorder
-template<typename t_value, typename t_size, typename sort_t>
-double testNearDisorder(t_value* a, t_size size, sort_t sortFunc)
+// allocator benchmark: each thread allocates size objects then frees them all
+struct poolItem
 {
-	for(t_size i = 0; i < size; ++i)
-	{
-		a[i] = (t_value)i;
-	}
-	auto rand = bl::make_random<float>(g_seed);
-	for(int k = 0; k < 5; ++k)
+	double values[4];
+};
+
+template<typename alloc_t, typename free_t>
+void runAllocTest(const char* name, int numThreads, int size, alloc_t allocFunc, free_t freeFunc)
+{
+	bl::timer t;
+	std::vector<bl::thread> threads;
+	for(int k = 0; k < numThreads; ++k)
 	{
-		for(t_size i = 1; i < size; ++i)
+		threads.emplace_back([=]()
 		{
-			if(rand() < 0.1f)
+			std::vector<poolItem*> items(size);
+			for(int iter = 0; iter < g_numIter; ++iter)
 			{
-				std::swap(a[i], a[i-1]);
+				for(int i = 0; i < size; ++i)
+				{
+					items[i] = allocFunc();
+				}
+				for(int i = 0; i < size; ++i)
+				{
+					freeFunc(items[i]);
+				}
 			}
-		}
+		});
 	}
-	bl::timer t;
-	sortFunc(a, size);
-	double e = t.milliseconds();
-	return e;
+	for(auto& th : threads)
+	{
+		th.join();
+	}
+	double avg = t.milliseconds() / g_numIter;
+	std::cout << std::fixed;
+	bl::print(name, "-", numThreads, "threads - average time (ms):", avg, "| million alloc+free/s:", numThreads * size / 1000 / avg);
 }
 
-// case 5: random far disorder
-template<typename t_value, typename t_size, typename sort_t>
-double testFarDisorder(t_value* a, t_size size, sort_t sortFunc)
+// speedup of every sort per input case, geometric mean over the sizes and types both runs have. '!' marks a cell
+// holding a regression
+void printSpeedupTable(const std::vector<bl::bench::comparison>& comparisons)
 {
-	auto rand = bl::make_random<t_value>(0, size, g_seed);
-	auto randf = bl::make_random<float>(g_seed);
-	for(t_size i = 0; i < size; ++i)
+	struct cell
+	{
+		double logSum;
+		int count;
+		bool slower;
+	};
+	std::vector<std::string> sorts;
+	std::vector<std::string> inputs;
+	std::map<std::string, cell> cells;
+	for(const bl::bench::comparison& c : comparisons)
 	{
-		if(randf() < 0.1f)
+		const std::string input = c.name.substr(0, c.name.find('/'));
+		const std::string sort = c.name.substr(c.name.rfind('/') + 1);
+		if(std::find(inputs.begin(), inputs.end(), input) == inputs.end())
 		{
-			a[i] = rand();
+			inputs.push_back(input);
 		}
-		else
+		if(std::find(sorts.begin(), sorts.end(), sort) == sorts.end())
 		{
-			a[i] = (t_value)i;
+			sorts.push_back(sort);
 		}
+		cell& e = cells.insert(std::make_pair(sort + "/" + input, cell{0, 0, false})).first->second;
+		e.logSum += std::log(c.speedup);
+		e.count += 1;
+		e.slower = e.slower || c.verdict == bl::bench::change::slower;
+	}
+
+	std::printf("\n%-22s", "speedup");
+	for(const std::string& input : inputs)
+	{
+		std::printf(" %17s", input.c_str());
+	}
+	std::printf("\n");
+	for(const std::string& sort : sorts)
+	{
+		std::printf("%-22s", sort.c_str());
+		for(const std::string& input : inputs)
+		{
+			auto it = cells.find(sort + "/" + input);
+			if(it == cells.end())
+			{
+				std::printf(" %17s", "-");
+			}
+			else
+			{
+				std::printf(" %15.3fx%s", std::exp(it->second.logSum / it->second.count), it->second.slower ? "!" : " ");
+			}
+		}
+		std::printf("\n");
 	}
-	bl::timer t;
-	sortFunc(a, size);
-	double e = t.milliseconds();
-	return e;
 }
 
-// case 6: repeated values
-template<typename t_value, typename t_size, typename sort_t>
-double testRandomDuplicate(t_value* a, t_size size, sort_t sortFunc)
+// compares the results with the baseline, returns the exit code: 0, 1 when the baseline cannot be read, 2 when a
+// benchmark regressed
+int compareBaseline(const bl::bench& bench)
 {
-	auto rand = bl::make_random<t_value>(0, size/100, g_seed);
-	for(t_size i = 0; i < size; ++i)
+	std::ifstream in(g_baselinePath);
+	std::vector<bl::bench::result> baseline;
+	if(!bl::bench::read_baseline(in, baseline))
 	{
-		a[i] = rand();
+		bl::print("cannot read baseline", g_baselinePath);
+		return 1;
 	}
-	bl::timer t;
-	sortFunc(a, size);
-	double e = t.milliseconds();
-	return e;
+
+	const std::vector<bl::bench::comparison> comparisons = bench.compare(baseline, g_alpha, g_threshold);
+	bl::print(); bl::print("----- comparison with", g_baselinePath, "-----");
+	bl::bench::write_comparison(std::cout, comparisons);
+	printSpeedupTable(comparisons);
+
+	int slower = 0;
+	int faster = 0;
+	for(const bl::bench::comparison& c : comparisons)
+	{
+		slower += c.verdict == bl::bench::change::slower ? 1 : 0;
+		faster += c.verdict == bl::bench::change::faster ? 1 : 0;
+	}
+	bl::print(); bl::print(comparisons.size(), "compared -", faster, "faster -", slower, "slower by more than", g_threshold * 100, "% at p <", g_alpha);
+	return slower == 0 ? 0 : 2;
 }
 
-// case 7: contiguous ordered and disordered
-template<typename t_value, typename t_size, typename sort_t>
-double testContiguous(t_value* a, t_size size, sort_t sortFunc)
+// --min-size n, --max-size n (up to 1e9), --max-quadratic-size n, --filter text, --json path, --csv path,
+// --save-baseline path, --baseline path, --threshold percent, --alpha p
+bool parseArgs(int argc, char** argv)
 {
-	auto rand = bl::make_random<t_value>(0, size, g_seed);
-	t_value v = 0;
-	t_size k = 0;
-	bool ordered = true;
-	for(t_size i = 0; i < size; ++i)
+	for(int i = 1; i < argc; ++i)
 	{
-		if(ordered)
+		const bool hasValue = i + 1 < argc;
+		if(hasValue && std::strcmp(argv[i], "--min-size") == 0)
 		{
-			a[i] = v++;
+			g_minSize = static_cast<bl::uint64>(std::atof(argv[++i]));
 		}
-		else
+		else if(hasValue && std::strcmp(argv[i], "--max-size") == 0)
+		{
+			g_maxSize = static_cast<bl::uint64>(std::atof(argv[++i]));
+		}
+		else if(hasValue && std::strcmp(argv[i], "--max-quadratic-size") == 0)
 		{
-			a[i] = rand();
+			g_maxQuadraticSize = static_cast<bl::uint64>(std::atof(argv[++i]));
 		}
-		if(k++ > size/100)
+		else if(hasValue && std::strcmp(argv[i], "--filter") == 0)
+		{
+			g_filter = argv[++i];
+		}
+		else if(hasValue && std::strcmp(argv[i], "--json") == 0)
+		{
+			g_jsonPath = argv[++i];
+		}
+		else if(hasValue && std::strcmp(argv[i], "--csv") == 0)
+		{
+			g_csvPath = argv[++i];
+		}
+		else if(hasValue && std::strcmp(argv[i], "--save-baseline") == 0)
+		{
+			g_saveBaselinePath = argv[++i];
+		}
+		else if(hasValue && std::strcmp(argv[i], "--baseline") == 0)
+		{
+			g_baselinePath = argv[++i];
+		}
+		else if(hasValue && std::strcmp(argv[i], "--threshold") == 0)
+		{
+			g_threshold = std::atof(argv[++i]) / 100;
+		}
+		else if(hasValue && std::strcmp(argv[i], "--alpha") == 0)
+		{
+			g_alpha = std::atof(argv[++i]);
+		}
+		else
 		{
-			ordered = !ordered;
-			k = 0;
+			bl::print("usage:", argv[0], "[--min-size n] [--max-size n] [--max-quadratic-size n] [--filter text] [--json path] [--csv path]",
+					  "[--save-baseline path] [--baseline path] [--threshold percent] [--alpha p]");
+			return false;
 		}
 	}
-	bl::timer t;
-	sortFunc(a, size);
-	double e = t.milliseconds();
-	return e;
+	if(g_maxSize > static_cast<bl::uint64>(g_maxArraySize))
+	{
+		g_maxSize = g_maxArraySize;
+	}
+	return true;
 }
 
-template<typename t_value, typename t_size, typename test_t>
-void runTest(const char* name, t_value* a, t_size size, test_t testCase)
+int main(int argc, char** argv)
 {
-	double total = 0.0;
-	for(int i = 0; i < g_numIter; ++i)
+	if(!parseArgs(argc, argv))
 	{
-		double dt = testCase(a, size);
-		if(!checkOrdered(a, size))
+		return 1;
+	}
+
+	if(g_filter.empty())
+	{
+		static bl::object_pool<poolItem> pool;
+		bl::print(); bl::print("----- alloc/free -", g_testSize, "objects -----");
+		for(int numThreads = 1; numThreads <= 4; numThreads *= 2)
 		{
-			bl::print("not sorted!");
-			exit(1);
+			runAllocTest("new/delete", numThreads, g_testSize, []{return new poolItem;}, [](poolItem* p){delete p;});
+			runAllocTest("object_pool", numThreads, g_testSize, []{return pool.create();}, [](poolItem* p){pool.destroy(p);});
 		}
-		//print("step:", i, "dt:", dt);
-		total += dt;
+		auto stats = pool.stats();
+		bl::print("object_pool - live:", stats.live, "peak checked out:", stats.peak_checked_out, "slabs:", stats.slabs);
 	}
-	double avg = total / g_numIter;
-	std::cout << std::fixed;
-	bl::print(name, "-", "average time (ms):", avg, "| million elem/s:", size / 1000 / avg);
-}
 
-int main()
-{
-	bl::print(); bl::print("----- random -", g_testSize, "elements -----");
-	runTest("std", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){std::sort(a2, a2 + s2);});});
-	runTest("bubble", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::bubble_sort(a2, s2);});});
-	runTest("cocktail", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::cocktail_sort(a2, s2);});});
-	runTest("insertion", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::insertion_sort(a2, s2);});});
-	runTest("insertion binary", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary(a2, s2);});});
-	runTest("insertion binary move", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary_move(a2, s2);});});
-	runTest("shell", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::shell_sort(a2, s2);});});
-	runTest("quick", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::quick_sort(a2, 0, s2-1);});});
-	runTest("heap", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandom(a1, s1, [](int* a2, int s2){bl::heap_sort(a2, s2);});});
+	bl::bench bench;
+	runRandom<float>(bench, "float");
+	runRandom<double>(bench, "double");
 
-	bl::print(); bl::print("----- ordered -", g_testSize, "elements -----");
-	runTest("std", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){std::sort(a2, a2 + s2);});});
-	runTest("bubble", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::bubble_sort(a2, s2);});});
-	runTest("cocktail", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::cocktail_sort(a2, s2);});});
-	runTest("insertion", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::insertion_sort(a2, s2);});});
-	runTest("insertion binary", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary(a2, s2);});});
-	runTest("insertion binary move", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary_move(a2, s2);});});
-	runTest("shell", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::shell_sort(a2, s2);});});
-	runTest("quick", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::quick_sort(a2, 0, s2-1);});});
-	runTest("heap", g_arrayInt, g_testSize, [](int* a1, int s1){return testOrdered(a1, s1, [](int* a2, int s2){bl::heap_sort(a2, s2);});});
+	bl::dataset data(g_seed);
+	runSorts<int>(bench, data, "int");
+	runSorts<unsigned int>(bench, data, "unsigned");
+	runSorts<float>(bench, data, "float");
+	runSorts<double>(bench, data, "double");
 
-	bl::print(); bl::print("----- reverse -", g_testSize, "elements -----");
-	runTest("std", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){std::sort(a2, a2 + s2);});});
-	runTest("bubble", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::bubble_sort(a2, s2);});});
-	runTest("cocktail", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::cocktail_sort(a2, s2);});});
-	runTest("insertion", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::insertion_sort(a2, s2);});});
-	runTest("insertion binary", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary(a2, s2);});});
-	runTest("insertion binary move", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary_move(a2, s2);});});
-	runTest("shell", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::shell_sort(a2, s2);});});
-	runTest("quick", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::quick_sort(a2, 0, s2-1);});});
-	runTest("heap", g_arrayInt, g_testSize, [](int* a1, int s1){return testReverseOrdered(a1, s1, [](int* a2, int s2){bl::heap_sort(a2, s2);});});
-
-	bl::print(); bl::print("----- near disorder -", g_testSize, "elements -----");
-	runTest("std", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){std::sort(a2, a2 + s2);});});
-	runTest("bubble", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::bubble_sort(a2, s2);});});
-	runTest("cocktail", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::cocktail_sort(a2, s2);});});
-	runTest("insertion", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::insertion_sort(a2, s2);});});
-	runTest("insertion binary", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary(a2, s2);});});
-	runTest("insertion binary move", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary_move(a2, s2);});});
-	runTest("shell", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::shell_sort(a2, s2);});});
-	runTest("quick", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::quick_sort(a2, 0, s2-1);});});
-	runTest("heap", g_arrayInt, g_testSize, [](int* a1, int s1){return testNearDisorder(a1, s1, [](int* a2, int s2){bl::heap_sort(a2, s2);});});
-
-	bl::print(); bl::print("----- far disorder -", g_testSize, "elements -----");
-	runTest("std", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){std::sort(a2, a2 + s2);});});
-	runTest("bubble", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::bubble_sort(a2, s2);});});
-	runTest("cocktail", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::cocktail_sort(a2, s2);});});
-	runTest("insertion", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::insertion_sort(a2, s2);});});
-	runTest("insertion binary", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary(a2, s2);});});
-	runTest("insertion binary move", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary_move(a2, s2);});});
-	runTest("shell", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::shell_sort(a2, s2);});});
-	runTest("quick", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::quick_sort(a2, 0, s2-1);});});
-	runTest("heap", g_arrayInt, g_testSize, [](int* a1, int s1){return testFarDisorder(a1, s1, [](int* a2, int s2){bl::heap_sort(a2, s2);});});
-
-	bl::print(); bl::print("----- random duplicate -", g_testSize, "elements -----");
-	runTest("std", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){std::sort(a2, a2 + s2);});});
-	runTest("bubble", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::bubble_sort(a2, s2);});});
-	runTest("cocktail", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::cocktail_sort(a2, s2);});});
-	runTest("insertion", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::insertion_sort(a2, s2);});});
-	runTest("insertion binary", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary(a2, s2);});});
-	runTest("insertion binary move", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary_move(a2, s2);});});
-	runTest("shell", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::shell_sort(a2, s2);});});
-	runTest("quick", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::quick_sort(a2, 0, s2-1);});});
-	runTest("heap", g_arrayInt, g_testSize, [](int* a1, int s1){return testRandomDuplicate(a1, s1, [](int* a2, int s2){bl::heap_sort(a2, s2);});});
-
-	bl::print(); bl::print("----- contiguous -", g_testSize, "elements -----");
-	runTest("std", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){std::sort(a2, a2 + s2);});});
-	runTest("bubble", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::bubble_sort(a2, s2);});});
-	runTest("cocktail", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::cocktail_sort(a2, s2);});});
-	runTest("insertion", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::insertion_sort(a2, s2);});});
-	runTest("insertion binary", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary(a2, s2);});});
-	runTest("insertion binary move", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::insertion_sort_binary_move(a2, s2);});});
-	runTest("shell", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::shell_sort(a2, s2);});});
-	runTest("quick", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::quick_sort(a2, 0, s2-1);});});
-	runTest("heap", g_arrayInt, g_testSize, [](int* a1, int s1){return testContiguous(a1, s1, [](int* a2, int s2){bl::heap_sort(a2, s2);});});
+	if(!g_jsonPath.empty())
+	{
+		std::ofstream out(g_jsonPath);
+		bench.write_json(out);
+	}
+	if(!g_csvPath.empty())
+	{
+		std::ofstream out(g_csvPath);
+		bench.write_csv(out);
+	}
+	if(!g_saveBaselinePath.empty())
+	{
+		std::ofstream out(g_saveBaselinePath);
+		bench.write_baseline(out);
+	}
 
-	return 0;
+	// exit code 2 flags a regression against the baseline, 1 any other failure
+	return g_baselinePath.empty() ? 0 : compareBaseline(bench);
 }